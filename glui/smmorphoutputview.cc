@@ -32,6 +32,7 @@ MorphOutputView::MorphOutputView (Widget *parent, MorphOutput *morph_output, Mor
 
   add_property_view (MorphOutput::P_SINES, op_layout);
   add_property_view (MorphOutput::P_NOISE, op_layout);
+  add_property_view (MorphOutput::P_LOW_LATENCY, op_layout);
 
   // Unison
   pv_unison        = add_property_view (MorphOutput::P_UNISON, op_layout);
@@ -64,6 +65,7 @@ MorphOutputView::MorphOutputView (Widget *parent, MorphOutput *morph_output, Mor
   pv_filter_resonance = add_property_view (MorphOutput::P_FILTER_RESONANCE, op_layout);
   pv_filter_drive = add_property_view (MorphOutput::P_FILTER_DRIVE, op_layout);
   pv_filter_mix = add_property_view (MorphOutput::P_FILTER_MIX, op_layout);
+  pv_filter_spectral = add_property_view (MorphOutput::P_FILTER_SPECTRAL, op_layout);
 
   // Portamento (Mono): on/off
   pv_portamento = add_property_view (MorphOutput::P_PORTAMENTO, op_layout);
@@ -128,6 +130,7 @@ MorphOutputView::update_visible()
   pv_filter_resonance->set_visible (filter);
   pv_filter_drive->set_visible (filter);
   pv_filter_mix->set_visible (filter);
+  pv_filter_spectral->set_visible (filter);
 
   bool portamento = pv_portamento->property()->get_bool();
   pv_portamento_glide->set_visible (portamento);
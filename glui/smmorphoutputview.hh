@@ -44,6 +44,7 @@ class MorphOutputView : public MorphOperatorView
   PropertyView               *pv_filter_resonance;
   PropertyView               *pv_filter_drive;
   PropertyView               *pv_filter_mix;
+  PropertyView               *pv_filter_spectral;
 
   PropertyView               *pv_portamento;
   PropertyView               *pv_portamento_glide;
@@ -5,6 +5,7 @@
 #include "smlabel.hh"
 #include "smtimer.hh"
 #include "smproject.hh"
+#include "smwavsetrepo.hh"
 
 using namespace SpectMorph;
 
@@ -43,6 +44,11 @@ MorphPlanControl::MorphPlanControl (Widget *parent, MorphPlan *plan) :
   inst_status = new Label (this, "");
   grid.add_widget (inst_status, 2, voffset, 40, 2);
 
+  voffset += 2;
+
+  repo_status = new Label (this, "");
+  grid.add_widget (repo_status, 2, voffset, 40, 2);
+
   voffset += 2;
   m_view_height = voffset + 1;
 
@@ -54,8 +60,13 @@ MorphPlanControl::MorphPlanControl (Widget *parent, MorphPlan *plan) :
   connect (led_timer->signal_timeout, this, &MorphPlanControl::on_update_led);
   led_timer->start (0);
 
+  /* --- update wav set repo statistics once per second: --- */
+  Timer *repo_timer = new Timer (this);
+  connect (repo_timer->signal_timeout, this, &MorphPlanControl::on_update_repo_status);
+  repo_timer->start (1000);
 
   on_index_changed();
+  on_update_repo_status();
 }
 
 void
@@ -94,6 +105,17 @@ MorphPlanControl::on_update_led()
   midi_led->set_on (morph_plan->project()->voices_active());
 }
 
+void
+MorphPlanControl::on_update_repo_status()
+{
+  WavSetRepo::Stats stats = WavSetRepo::the()->stats();
+
+  repo_status->set_text (string_locale_printf ("Wav Sets: %zd (%.1f MB), Hits: %lu, Misses: %lu, Evictions: %lu",
+                                               stats.wav_sets, stats.resident_bytes / (1024. * 1024.),
+                                               (unsigned long) stats.hits, (unsigned long) stats.misses,
+                                               (unsigned long) stats.evictions));
+}
+
 void
 MorphPlanControl::on_index_changed()
 {
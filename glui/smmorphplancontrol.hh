@@ -21,6 +21,7 @@ class MorphPlanControl : public Frame
   Slider      *volume_slider = nullptr;
   Led         *midi_led = nullptr;
   Label       *inst_status = nullptr;
+  Label       *repo_status = nullptr;
   double       m_view_height;
 
   void update_volume_label (double volume);
@@ -36,6 +37,7 @@ public:
   void on_project_volume_changed (double new_volume);
   void on_index_changed();
   void on_update_led();
+  void on_update_repo_status();
 };
 
 }
@@ -2,6 +2,7 @@
 
 #include "smadsrenvelope.hh"
 #include "smmath.hh"
+#include "smblockutils.hh"
 #include <assert.h>
 #include <stdio.h>
 #include <algorithm>
@@ -128,23 +129,15 @@ ADSREnvelope::process_params (size_t n_values, float *values)
 {
   n_values = min<int> (n_values, params.len);
 
+  /* compute envelope in closed form (vectorized), then apply it */
+  float env[n_values];
   if (params.linear)
-    {
-      for (size_t i = 0; i < n_values; i++)
-        {
-          // params.factor == 1 -> avoid multiplication for linear case
-          level     += params.delta;
-          values[i] *= level;
-        }
-    }
+    level = Block::linear_ramp (n_values, env, level, params.delta);
   else
-    {
-      for (size_t i = 0; i < n_values; i++)
-        {
-          level = level * params.factor + params.delta;
-          values[i] *= level;
-        }
-    }
+    level = Block::exp_ramp (n_values, env, level, params.factor, params.delta);
+
+  Block::mul (n_values, values, env);
+
   params.len -= n_values;
 
   if (!params.len)
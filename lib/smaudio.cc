@@ -11,6 +11,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 
 using std::string;
@@ -20,6 +21,56 @@ using namespace SpectMorph;
 
 static LeakDebugger leak_debugger ("SpectMorph::Audio");
 
+namespace
+{
+
+/* version 15 files store each frame parameter (like freqs) for all frames as one
+ * contiguous block; the per frame counts are used to split the data into frames
+ */
+bool
+unpack_frame_data (vector<AudioBlock>& contents, vector<uint16_t> AudioBlock::*member,
+                   const vector<uint16_t>& counts, const unsigned char *mem, size_t n_values)
+{
+  if (counts.size() != contents.size())
+    return false;
+
+  size_t offset = 0;
+  for (size_t f = 0; f < contents.size(); f++)
+    {
+      const size_t count = counts[f];
+      if (offset + count > n_values)
+        return false;
+
+      vector<uint16_t>& values = contents[f].*member;
+      values.resize (count);
+      if (count)
+        memcpy (&values[0], mem + offset * 2, count * 2);
+
+      offset += count;
+    }
+  return offset == n_values;
+}
+
+bool
+check_freqs_sorted (const vector<uint16_t>& freqs)
+{
+  // ensure that freqs are sorted (we need that for LiveDecoder)
+  int old_freq = -1;
+
+  for (size_t i = 0; i < freqs.size(); i++)
+    {
+      if (freqs[i] < old_freq)
+        {
+          printf ("frequency data is not sorted, can't play file\n");
+          return false;
+        }
+      old_freq = freqs[i];
+    }
+  return true;
+}
+
+}
+
 /**
  * This function loads a SM-File.
  *
@@ -50,20 +101,27 @@ SpectMorph::Audio::load (GenericIn *file, AudioLoadOptions load_options)
   string section;
   size_t contents_pos = 0; /* init to get rid of gcc warning */
 
+  /* packed frame data (version 15) */
+  vector<uint16_t> noise_counts, partial_counts, phase_counts;
+  size_t original_fft_pos = 0, debug_samples_pos = 0;
+
   if (!ifile.open_ok())
     return Error::Code::FILE_NOT_FOUND;
 
   if (ifile.file_type() != "SpectMorph::Audio")
     return Error::Code::FORMAT_INVALID;
 
-  if (ifile.file_version() != SPECTMORPH_BINARY_FILE_VERSION)
+  if (ifile.file_version() < SPECTMORPH_BINARY_FILE_VERSION_MIN ||
+      ifile.file_version() > SPECTMORPH_BINARY_FILE_VERSION)
     return Error::Code::FORMAT_INVALID;
 
-  if (load_options == AUDIO_SKIP_DEBUG)
+  if (load_options == AUDIO_SKIP_DEBUG || load_options == AUDIO_SKIP_FRAMES)
     {
       ifile.add_skip_event ("original_fft");
       ifile.add_skip_event ("debug_samples");
     }
+  if (load_options == AUDIO_SKIP_FRAMES)
+    ifile.add_skip_event ("original_samples");
 
   while (ifile.event() != InFile::END_OF_FILE)
     {
@@ -89,6 +147,8 @@ SpectMorph::Audio::load (GenericIn *file, AudioLoadOptions load_options)
               contents_pos++;
               audio_block = NULL;
             }
+          if (section == "header" && load_options == AUDIO_SKIP_FRAMES)
+            return Error::Code::NONE;
 
           assert (section != "");
           section = "";
@@ -114,7 +174,8 @@ SpectMorph::Audio::load (GenericIn *file, AudioLoadOptions load_options)
                   int frame_count = ifile.event_int();
 
                   contents.clear();
-                  contents.resize (frame_count);
+                  if (load_options != AUDIO_SKIP_FRAMES)
+                    contents.resize (frame_count);
                   contents_pos = 0;
                 }
               else
@@ -160,6 +221,21 @@ SpectMorph::Audio::load (GenericIn *file, AudioLoadOptions load_options)
               else
                 printf ("unhandled float block %s  %s\n", section.c_str(), ifile.event_name().c_str());
             }
+          else if (section == "debug_frames")
+            {
+              if (ifile.event_name() == "original_fft" && original_fft_pos < contents.size())
+                {
+                  contents[original_fft_pos++].original_fft = fb;
+                }
+              else if (ifile.event_name() == "debug_samples" && debug_samples_pos < contents.size())
+                {
+                  contents[debug_samples_pos++].debug_samples = fb;
+                }
+              else
+                {
+                  return Error::Code::PARSE_ERROR;
+                }
+            }
           else
             {
               assert (audio_block != NULL);
@@ -178,6 +254,39 @@ SpectMorph::Audio::load (GenericIn *file, AudioLoadOptions load_options)
                 }
             }
         }
+      else if (ifile.event() == InFile::UINT16_BLOCK && section == "frames")
+        {
+          const string name = ifile.event_name();
+
+          size_t n_values;
+          const unsigned char *mem = ifile.event_uint16_block_mem (n_values);
+
+          bool ok = true;
+          if (name == "noise_counts")
+            noise_counts = ifile.event_uint16_block();
+          else if (name == "partial_counts")
+            partial_counts = ifile.event_uint16_block();
+          else if (name == "phase_counts")
+            phase_counts = ifile.event_uint16_block();
+          else if (name == "noise")
+            ok = unpack_frame_data (contents, &AudioBlock::noise, noise_counts, mem, n_values);
+          else if (name == "freqs")
+            {
+              ok = unpack_frame_data (contents, &AudioBlock::freqs, partial_counts, mem, n_values);
+
+              for (size_t f = 0; ok && f < contents.size(); f++)
+                ok = check_freqs_sorted (contents[f].freqs);
+            }
+          else if (name == "mags")
+            ok = unpack_frame_data (contents, &AudioBlock::mags, partial_counts, mem, n_values);
+          else if (name == "phases")
+            ok = unpack_frame_data (contents, &AudioBlock::phases, phase_counts, mem, n_values);
+          else
+            printf ("unhandled int16 block %s %s\n", section.c_str(), name.c_str());
+
+          if (!ok)
+            return Error::Code::PARSE_ERROR;
+        }
       else if (ifile.event() == InFile::UINT16_BLOCK)
         {
           const vector<uint16_t>& ib = ifile.event_uint16_block();
@@ -185,18 +294,8 @@ SpectMorph::Audio::load (GenericIn *file, AudioLoadOptions load_options)
             {
               audio_block->freqs = ib;
 
-              // ensure that freqs are sorted (we need that for LiveDecoder)
-              int old_freq = -1;
-
-              for (size_t i = 0; i < ib.size(); i++)
-                {
-                  if (ib[i] < old_freq)
-                    {
-                      printf ("frequency data is not sorted, can't play file\n");
-                      return Error::Code::PARSE_ERROR;
-                    }
-                  old_freq = ib[i];
-                }
+              if (!check_freqs_sorted (ib))
+                return Error::Code::PARSE_ERROR;
             }
           else if (ifile.event_name() == "mags")
             {
@@ -284,24 +383,59 @@ SpectMorph::Audio::save (GenericOut *file) const
   of.write_float_block ("original_samples", original_samples);
   of.end_section();
 
+  /* store frame data in packed form: one contiguous block per parameter, and per
+   * frame counts which allow splitting the blocks into frames during load
+   */
+  vector<uint16_t> noise_counts, partial_counts, phase_counts;
+  vector<uint16_t> noise, freqs, mags, phases;
+  bool             have_debug_data = false;
+
   for (size_t i = 0; i < contents.size(); i++)
     {
+      const AudioBlock& block = contents[i];
+
       // ensure that freqs are sorted (we need that for LiveDecoder)
       int old_freq = -1;
 
-      for (size_t f = 0; f < contents[i].freqs.size(); f++)
+      for (size_t f = 0; f < block.freqs.size(); f++)
         {
-          assert (contents[i].freqs[f] >= old_freq);
-          old_freq = contents[i].freqs[f];
+          assert (block.freqs[f] >= old_freq);
+          old_freq = block.freqs[f];
         }
+      assert (block.mags.size() == block.freqs.size());
+      assert (block.freqs.size() <= 65535 && block.noise.size() <= 65535 && block.phases.size() <= 65535);
+
+      noise_counts.push_back (block.noise.size());
+      partial_counts.push_back (block.freqs.size());
+      phase_counts.push_back (block.phases.size());
+
+      noise.insert (noise.end(), block.noise.begin(), block.noise.end());
+      freqs.insert (freqs.end(), block.freqs.begin(), block.freqs.end());
+      mags.insert (mags.end(), block.mags.begin(), block.mags.end());
+      phases.insert (phases.end(), block.phases.begin(), block.phases.end());
 
-      of.begin_section ("frame");
-      of.write_uint16_block ("noise", contents[i].noise);
-      of.write_uint16_block ("freqs", contents[i].freqs);
-      of.write_uint16_block ("mags", contents[i].mags);
-      of.write_uint16_block ("phases", contents[i].phases);
-      of.write_float_block ("original_fft", contents[i].original_fft);
-      of.write_float_block ("debug_samples", contents[i].debug_samples);
+      if (!block.original_fft.empty() || !block.debug_samples.empty())
+        have_debug_data = true;
+    }
+
+  of.begin_section ("frames");
+  of.write_uint16_block ("noise_counts", noise_counts);
+  of.write_uint16_block ("partial_counts", partial_counts);
+  of.write_uint16_block ("phase_counts", phase_counts);
+  of.write_uint16_block ("noise", noise);
+  of.write_uint16_block ("freqs", freqs);
+  of.write_uint16_block ("mags", mags);
+  of.write_uint16_block ("phases", phases);
+  of.end_section();
+
+  if (have_debug_data)
+    {
+      of.begin_section ("debug_frames");
+      for (size_t i = 0; i < contents.size(); i++)
+        {
+          of.write_float_block ("original_fft", contents[i].original_fft);
+          of.write_float_block ("debug_samples", contents[i].debug_samples);
+        }
       of.end_section();
     }
   return Error::Code::NONE;
@@ -10,8 +10,9 @@
 #include "smmath.hh"
 #include "smutils.hh"
 
-#define SPECTMORPH_BINARY_FILE_VERSION   14
-#define SPECTMORPH_SUPPORT_MULTI_CHANNEL 0
+#define SPECTMORPH_BINARY_FILE_VERSION     15
+#define SPECTMORPH_BINARY_FILE_VERSION_MIN 14 // oldest file version we can still read
+#define SPECTMORPH_SUPPORT_MULTI_CHANNEL   0
 
 namespace SpectMorph
 {
@@ -66,7 +67,8 @@ public:
 enum AudioLoadOptions
 {
   AUDIO_LOAD_DEBUG,
-  AUDIO_SKIP_DEBUG
+  AUDIO_SKIP_DEBUG,
+  AUDIO_SKIP_FRAMES   // header only: no frames, no original samples
 };
 
 /**
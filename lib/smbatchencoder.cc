@@ -0,0 +1,155 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smbatchencoder.hh"
+#include "smencoderoptions.hh"
+#include "smutils.hh"
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+
+#include <stdio.h>
+
+using namespace SpectMorph;
+
+using std::string;
+using std::vector;
+
+/**
+ * This function encodes one job, in the same way smenc would encode it.
+ */
+bool
+BatchEncoder::encode_job (const Job& job, string& error)
+{
+  EncoderOptions options;
+  vector<string> files;
+  if (!options.parse (EncoderOptions::split_args (job.args), files, error))
+    return false;
+  if (!files.empty())
+    {
+      error = "unexpected argument " + files[0];
+      return false;
+    }
+
+  WavData wav_data;
+  if (!wav_data.load (job.input_filename))
+    {
+      error = string_printf ("can't open the input file %s: %s", job.input_filename.c_str(), wav_data.error_blurb());
+      return false;
+    }
+
+  EncoderParams enc_params;
+  if (!options.setup_params (enc_params, wav_data, error))
+    return false;
+
+  const int n_channels = wav_data.n_channels();
+  for (int channel = 0; channel < n_channels; channel++)
+    {
+      const string sm_file = EncoderOptions::channel_filename (job.output_filename, channel);
+      if (sm_file == job.output_filename && n_channels > 1)
+        {
+          error = "input file '" + job.input_filename + "' has more than one channel, need pattern %c in output file name";
+          return false;
+        }
+
+      Encoder encoder (enc_params);
+      if (!encoder.encode (wav_data, channel, options.optimization_level, options.attack, options.track_sines))
+        {
+          error = "encoding failed";
+          return false;
+        }
+      options.finish (encoder);
+
+      Error save_error = encoder.save (sm_file);
+      if (save_error)
+        {
+          error = string_printf ("can't write %s: %s", sm_file.c_str(), save_error.message());
+          return false;
+        }
+    }
+  return true;
+}
+
+/**
+ * Add a job, which encodes input_filename to output_filename using the smenc
+ * command line options given by args.
+ */
+void
+BatchEncoder::add_job (const string& input_filename, const string& output_filename, const string& args)
+{
+  Job job;
+  job.input_filename  = input_filename;
+  job.output_filename = output_filename;
+  job.args            = args;
+
+  jobs.push_back (job);
+}
+
+/**
+ * Set maximum number of threads used by run(); the default (0) is to use one
+ * thread per CPU core.
+ */
+void
+BatchEncoder::set_max_threads (int new_max_threads)
+{
+  max_threads = new_max_threads;
+}
+
+/**
+ * Set a function to be called after each finished job. The function is called
+ * from the worker threads, but never by more than one thread at the same time.
+ */
+void
+BatchEncoder::set_progress_function (const std::function<void (const Job&, size_t, size_t)>& new_progress_function)
+{
+  progress_function = new_progress_function;
+}
+
+/**
+ * Run all jobs. Errors are printed to stderr.
+ *
+ * \returns true if all jobs were successful
+ */
+bool
+BatchEncoder::run()
+{
+  /* workers take the next job from a shared index, so a slow job doesn't
+   * keep other threads waiting (the jobs are independent of each other)
+   */
+  std::atomic<size_t> next_index { 0 };
+  std::atomic<bool>   all_ok { true };
+  std::mutex          progress_mutex;
+  size_t              n_done = 0;
+
+  auto worker = [&]() {
+    for (size_t i = next_index++; i < jobs.size(); i = next_index++)
+      {
+        string error;
+        bool   ok = encode_job (jobs[i], error);
+
+        std::lock_guard<std::mutex> lg (progress_mutex);
+        if (!ok)
+          {
+            fprintf (stderr, "BatchEncoder: %s: %s\n", jobs[i].input_filename.c_str(), error.c_str());
+            all_ok = false;
+          }
+        n_done++;
+        if (progress_function)
+          progress_function (jobs[i], n_done, jobs.size());
+      }
+  };
+
+  size_t n_threads = max_threads > 0 ? max_threads : std::max (std::thread::hardware_concurrency(), 1u);
+  n_threads = std::min (n_threads, jobs.size());
+
+  vector<std::thread> threads;
+  for (size_t t = 1; t < n_threads; t++)
+    threads.emplace_back (worker);
+
+  worker();
+
+  for (auto& t : threads)
+    t.join();
+
+  return all_ok;
+}
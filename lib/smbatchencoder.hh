@@ -0,0 +1,49 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#ifndef SPECTMORPH_BATCH_ENCODER_HH
+#define SPECTMORPH_BATCH_ENCODER_HH
+
+#include <string>
+#include <vector>
+#include <functional>
+
+namespace SpectMorph
+{
+
+/**
+ * \brief Encode many audio files in one process
+ *
+ * Each job has the same effect as running smenc with the input filename,
+ * output filename and smenc command line options (like "-m 60 -O1"). The
+ * jobs are processed by a pool of threads, so there is no process startup
+ * overhead per file.
+ */
+class BatchEncoder
+{
+public:
+  struct Job
+  {
+    std::string input_filename;
+    std::string output_filename;
+    std::string args;             //!< smenc command line options
+  };
+
+private:
+  std::vector<Job> jobs;
+  int              max_threads = 0;
+
+  std::function<void (const Job&, size_t, size_t)> progress_function;
+
+  bool encode_job (const Job& job, std::string& error);
+
+public:
+  void add_job (const std::string& input_filename, const std::string& output_filename, const std::string& args);
+  void set_max_threads (int max_threads);
+  void set_progress_function (const std::function<void (const Job& job, size_t n_done, size_t n_jobs)>& progress_function);
+
+  bool run();
+};
+
+}
+
+#endif
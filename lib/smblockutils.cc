@@ -2,6 +2,8 @@
 
 #include "smblockutils.hh"
 
+#include <math.h>
+
 using namespace SpectMorph;
 
 void
@@ -54,3 +56,82 @@ Block::range (guint           n_values,
   min_value = minv;
   max_value = maxv;
 }
+
+/**
+ * Computes n_values of the linear slope
+ *
+ *   value = value + delta
+ *
+ * (without accumulating rounding errors from step to step).
+ *
+ * \param start value before the first step
+ * \returns value after the last step
+ */
+double
+Block::linear_ramp (guint           n_values,
+                    float          *ovalues,
+                    double          start,
+                    double          delta)
+{
+  const float fstart = start;
+  const float fdelta = delta;
+
+  for (guint i = 0; i < n_values; i++)
+    ovalues[i] = fstart + fdelta * float (i + 1);
+
+  return start + delta * n_values;
+}
+
+/**
+ * Computes n_values of the exponential slope
+ *
+ *   value = value * factor + delta
+ *
+ * using the closed form value_k = target + (start - target) * factor^k, where
+ * target = delta / (1 - factor). Unlike the iterative computation, this can be
+ * vectorized.
+ *
+ * \param start value before the first step
+ * \returns value after the last step
+ */
+double
+Block::exp_ramp (guint           n_values,
+                 float          *ovalues,
+                 double          start,
+                 double          factor,
+                 double          delta)
+{
+  if (factor == 1)
+    return linear_ramp (n_values, ovalues, start, delta);
+
+  const double target = delta / (1 - factor);
+
+  /* powers of factor for one chunk */
+  const guint CHUNK = 8;
+  float chunk_pow[CHUNK];
+
+  double p = 1;
+  for (guint j = 0; j < CHUNK; j++)
+    {
+      p *= factor;
+      chunk_pow[j] = p;
+    }
+  const double chunk_factor = p;
+  const float  ftarget = target;
+
+  double offset = start - target;   // offset from target before current chunk
+  guint i = 0;
+  while (i + CHUNK <= n_values)
+    {
+      const float foffset = offset;
+      for (guint j = 0; j < CHUNK; j++)
+        ovalues[i + j] = ftarget + foffset * chunk_pow[j];
+
+      offset *= chunk_factor;
+      i += CHUNK;
+    }
+  for (guint j = 0; i < n_values; i++, j++)
+    ovalues[i] = ftarget + float (offset) * chunk_pow[j];
+
+  return target + (start - target) * pow (factor, n_values);
+}
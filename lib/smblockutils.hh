@@ -23,6 +23,15 @@ public:
                        const float    *ivalues,
                        float&          min_value,
                        float&          max_value);
+  static double linear_ramp (guint        n_values,
+                             float       *ovalues,
+                             double       start,
+                             double       delta);
+  static double exp_ramp    (guint        n_values,
+                             float       *ovalues,
+                             double       start,
+                             double       factor,
+                             double       delta);
 };
 
 }
@@ -42,6 +42,14 @@ Config::Config()
         {
           m_font_bold = s;
         }
+      else if (cfg_parser.command ("demand_load", i))
+        {
+          m_demand_load = i;
+        }
+      else if (cfg_parser.command ("wav_set_memory_mb", i))
+        {
+          m_wav_set_memory_mb = i;
+        }
       else
         {
           //cfg.die_if_unknown();
@@ -79,6 +87,18 @@ Config::font_bold() const
   return m_font_bold;
 }
 
+bool
+Config::demand_load() const
+{
+  return m_demand_load;
+}
+
+int
+Config::wav_set_memory_mb() const
+{
+  return m_wav_set_memory_mb;
+}
+
 void
 Config::store()
 {
@@ -100,5 +120,11 @@ Config::store()
   if (m_font_bold != "")
     fprintf (file, "font_bold \"%s\"", m_font_bold.c_str());
 
+  if (m_demand_load)
+    fprintf (file, "demand_load 1\n");
+
+  if (m_wav_set_memory_mb > 0)
+    fprintf (file, "wav_set_memory_mb %d\n", m_wav_set_memory_mb);
+
   fclose (file);
 }
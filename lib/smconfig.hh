@@ -16,6 +16,8 @@ class Config
   std::vector<std::string> m_debug;
   std::string              m_font;
   std::string              m_font_bold;
+  bool                     m_demand_load = false;
+  int                      m_wav_set_memory_mb = 0;
 
   std::string get_config_filename();
 public:
@@ -29,6 +31,9 @@ public:
   std::string font() const;
   std::string font_bold() const;
 
+  bool  demand_load() const;
+  int   wav_set_memory_mb() const;
+
   void store();
 };
 
@@ -135,6 +135,11 @@ EffectDecoder::EffectDecoder (MorphOutputModule *output_module, LiveDecoderSourc
     filter_resonance_smooth.set (this->output_module->filter_resonance_mod() * 0.01, filter_smooth_first);
     filter_mix_smooth.set (this->output_module->filter_mix_mod() * 0.01, filter_smooth_first);
 
+    if (filter_spectral && filter_smooth_first && chain_decoder->spectral_filter_supported())
+      {
+        /* first frame: process() didn't compute the spectral filter parameters yet */
+        spectral_filter.set_params (filter_cutoff_smooth.get_next(), filter_resonance_smooth.get_next(), filter_mix_smooth.get_next());
+      }
     filter_smooth_first = false;
   };
 
@@ -205,6 +210,7 @@ EffectDecoder::set_config (const MorphOutput::Config *cfg, float mix_freq)
 
   chain_decoder->enable_noise (cfg->noise);
   chain_decoder->enable_sines (cfg->sines);
+  chain_decoder->enable_low_latency (cfg->low_latency);
 
   if (cfg->unison) // unison?
     chain_decoder->set_unison_voices (cfg->unison_voices, cfg->unison_detune);
@@ -241,24 +247,33 @@ EffectDecoder::set_config (const MorphOutput::Config *cfg, float mix_freq)
 
   filter_key_tracking = cfg->filter_key_tracking;
   filter.set_drive (cfg->filter_drive);
+  spectral_filter.set_drive (cfg->filter_drive);
+  spectral_filter.set_mix_freq (mix_freq);
 
   switch (cfg->filter_type)
     {
       case MorphOutput::FILTER_LP1:
         filter.set_mode (LadderVCFMode::LP1);
+        spectral_filter.set_mode (LadderVCFMode::LP1);
         break;
       case MorphOutput::FILTER_LP2:
         filter.set_mode (LadderVCFMode::LP2);
+        spectral_filter.set_mode (LadderVCFMode::LP2);
         break;
       case MorphOutput::FILTER_LP3:
         filter.set_mode (LadderVCFMode::LP3);
+        spectral_filter.set_mode (LadderVCFMode::LP3);
         break;
       case MorphOutput::FILTER_LP4:
         filter.set_mode (LadderVCFMode::LP4);
+        spectral_filter.set_mode (LadderVCFMode::LP4);
         break;
     }
 
   filter_enabled = cfg->filter;
+  filter_spectral = cfg->filter_spectral;
+
+  chain_decoder->set_spectral_filter ((filter_enabled && filter_spectral) ? &spectral_filter : nullptr);
 }
 
 static float
@@ -289,6 +304,26 @@ void
 EffectDecoder::process (size_t       n_values,
                         const float *freq_in,
                         float       *audio_out)
+{
+  float filter_params[3 * n_values];
+  LadderVCFNonLinearBank::Lane filter_lane;
+
+  if (process_unfiltered (n_values, freq_in, audio_out, filter_params, filter_lane))
+    LadderVCFNonLinearBank::run_block (n_values, &filter_lane, 1);
+}
+
+/* compute decoder output without running the filter; if the filter is enabled,
+ * filter_lane is set up for LadderVCFNonLinearBank::run_block (which allows
+ * MidiSynth to filter many voices in parallel)
+ *
+ * filter_params needs to have space for 3 * n_values floats
+ */
+bool
+EffectDecoder::process_unfiltered (size_t                        n_values,
+                                   const float                  *freq_in,
+                                   float                        *audio_out,
+                                   float                        *filter_params,
+                                   LadderVCFNonLinearBank::Lane& filter_lane)
 {
   g_assert (chain_decoder);
 
@@ -299,23 +334,38 @@ EffectDecoder::process (size_t       n_values,
   else
     simple_envelope->process (n_values, audio_out);
 
-  if (filter_enabled)
-    {
-      float junk[n_values];
-      const float *inputs[2] = { audio_out, junk };
-      float *outputs[2] = { audio_out, junk };
+  if (!filter_enabled)
+    return false;
 
-      float freq[n_values], reso[n_values], mix[n_values];
-      for (uint i = 0; i < n_values; i++)
-        {
-          freq[i] = filter_cutoff_smooth.get_next() * exp2f (filter_envelope.get_next() * filter_depth_octaves);
-          reso[i] = filter_resonance_smooth.get_next();
-          mix[i]  = filter_mix_smooth.get_next();
-        }
-      filter.set_mix_in (mix);
+  float *freq = filter_params;
+  float *reso = filter_params + n_values;
+  float *mix  = filter_params + 2 * n_values;
+  float  env[n_values];
 
-      filter.run_block (n_values, /* const cutoff */ 0, /* const reso */ 0, inputs, outputs, true, false, freq, reso);
+  filter_cutoff_smooth.get_block (n_values, freq);
+  filter_envelope.get_block (n_values, env);
+  filter_resonance_smooth.get_block (n_values, reso);
+  filter_mix_smooth.get_block (n_values, mix);
+
+  for (uint i = 0; i < n_values; i++)
+    freq[i] *= sm_exp2f_fast (env[i] * filter_depth_octaves);
+
+  if (filter_spectral && chain_decoder->spectral_filter_supported())
+    {
+      /* the spectral filter is applied by the LiveDecoder, so here we only
+       * compute the filter parameters for the next frames; otherwise fall
+       * back to the ladder filter
+       */
+      if (n_values)
+        spectral_filter.set_params (freq[n_values - 1], reso[n_values - 1], mix[n_values - 1]);
+      return false;
     }
+  filter_lane.voice   = &filter;
+  filter_lane.values  = audio_out;
+  filter_lane.freq_in = freq;
+  filter_lane.reso_in = reso;
+  filter_lane.mix_in  = mix;
+  return true;
 }
 
 void
@@ -8,7 +8,7 @@
 #include "smmorphoutput.hh"
 #include "smadsrenvelope.hh"
 #include "smfilterenvelope.hh"
-#include "smladdervcf.hh"
+#include "smladdervcfbank.hh"
 #include "smlinearsmooth.hh"
 
 #include <memory>
@@ -40,7 +40,9 @@ class EffectDecoder
   LinearSmooth                          filter_resonance_smooth;
   LinearSmooth                          filter_mix_smooth;
   float                                 filter_depth_octaves;
-  LadderVCFNonLinear                    filter;
+  LadderVCFNonLinearBank::Voice         filter;
+  bool                                  filter_spectral = false;
+  SpectralFilter                        spectral_filter;
 
 public:
   EffectDecoder (MorphOutputModule *output_module, LiveDecoderSource *source);
@@ -52,6 +54,11 @@ public:
   void process (size_t       n_values,
                 const float *freq_in,
                 float       *audio_out);
+  bool process_unfiltered (size_t                        n_values,
+                           const float                  *freq_in,
+                           float                        *audio_out,
+                           float                        *filter_params,
+                           LadderVCFNonLinearBank::Lane& filter_lane);
   void release();
   bool done();
 
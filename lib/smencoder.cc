@@ -9,6 +9,7 @@
 #include "smblockutils.hh"
 #include "smalignedarray.hh"
 #include "smrandom.hh"
+#include "smpandaresampler.hh"
 
 #include <math.h>
 #include <stdio.h>
@@ -18,6 +19,8 @@
 #include <map>
 #include <algorithm>
 #include <memory>
+#include <thread>
+#include <atomic>
 #include <cinttypes>
 
 using namespace SpectMorph;
@@ -27,8 +30,13 @@ using std::map;
 using std::max;
 using std::complex;
 
+using PandaResampler::Resampler2;
+
+/* number of frames at the start of the sample used to find the attack envelope */
+static const size_t attack_frames = 20;
+
 static double
-magnitude (vector<float>::iterator i)
+magnitude (vector<float>::const_iterator i)
 {
   return sqrt (*i * *i + *(i+1) * *(i+1));
 }
@@ -46,7 +54,7 @@ normalize_phase (double phase)
 #define debug(...) SpectMorph::Debug::debug ("encoder", __VA_ARGS__)
 
 EncoderParams::EncoderParams() :
-  param_name_d ({"peak-width", "min-frame-periods", "min-frame-size"}),
+  param_name_d ({"peak-width", "min-frame-periods", "min-frame-size", "downsample-threshold"}),
   param_name_s ({"window"})
 {
 }
@@ -259,83 +267,161 @@ Encoder::Encoder (const EncoderParams& enc_params)
   loop_type = Audio::LOOP_NONE;
   optimal_attack.attack_start_ms = 0;
   optimal_attack.attack_end_ms = 0;
+
+  setup_refine_window();
+
+  profile_start_time = get_time();
+  profile_stage_time = profile_start_time;
 }
 
 /**
- * This function computes the short-time-fourier-transform (STFT) of the input
- * signal using a window to cut the individual frames out of the sample.
+ * Run func (start_frame, end_frame) for all frames. If enc_params.max_threads
+ * is larger than one, ranges of frames are processed by multiple threads. Each
+ * frame is processed by the same code in both cases, so the results do not
+ * depend on the number of threads; func must only modify per-frame data.
+ */
+void
+Encoder::parallel_frames (size_t n_frames, const std::function<void (size_t, size_t)>& func)
+{
+  const size_t chunk_size = 16;
+  const size_t n_chunks   = (n_frames + chunk_size - 1) / chunk_size;
+  const size_t n_threads  = std::min<size_t> (std::max (enc_params.max_threads, 1), n_chunks);
+
+  if (n_threads <= 1)
+    {
+      func (0, n_frames);
+      return;
+    }
+
+  std::atomic<size_t> next_chunk { 0 };
+
+  auto worker = [&]() {
+    for (size_t chunk = next_chunk++; chunk < n_chunks; chunk = next_chunk++)
+      {
+        if (killed ("_parallel"))
+          return;
+
+        func (chunk * chunk_size, std::min ((chunk + 1) * chunk_size, n_frames));
+      }
+  };
+
+  vector<std::thread> threads;
+  for (size_t t = 1; t < n_threads; t++)
+    threads.emplace_back (worker);
+
+  worker();
+
+  for (auto& t : threads)
+    t.join();
+}
+
+/**
+ * This function extracts the channel to be encoded from the input signal, and
+ * prepends zero values so that the first frame is centered around the start
+ * of the sample.
  */
 void
-Encoder::compute_stft (const WavData& multi_channel_wav_data, int channel)
+Encoder::setup_signal (const WavData& multi_channel_wav_data, int channel)
 {
   /* deinterleave multi channel signal */
-  vector<float> single_channel_signal;
+  original_samples.clear();
 
   const size_t n_channels = multi_channel_wav_data.n_channels();
   for (size_t i = channel; i < multi_channel_wav_data.n_values(); i += n_channels)
-    single_channel_signal.push_back (multi_channel_wav_data[i]);
+    original_samples.push_back (multi_channel_wav_data[i]);
+
+  zero_values_at_start = enc_params.frame_size - enc_params.frame_step / 2;
 
-  original_samples = single_channel_signal;
+  analysis_signal.assign (zero_values_at_start, 0);
+  analysis_signal.insert (analysis_signal.end(), original_samples.begin(), original_samples.end());
 
-  WavData wav_data (single_channel_signal, 1, multi_channel_wav_data.mix_freq(), multi_channel_wav_data.bit_depth());
+  sample_count = analysis_signal.size();
 
-  /* encode single channel */
-  zero_values_at_start = enc_params.frame_size - enc_params.frame_step / 2;
-  vector<float> zero_values (zero_values_at_start);
+  audio_blocks.clear();
+  audio_blocks.resize ((sample_count + enc_params.frame_step - 1) / enc_params.frame_step);
+}
+
+/**
+ * This function extracts the block_size samples of one frame from the analysis signal.
+ */
+void
+Encoder::frame_samples (size_t frame, vector<float>& block)
+{
+  const uint64 pos = frame * enc_params.frame_step;
 
-  wav_data.prepend (zero_values);
+  /* start with zero block, so the incomplete blocks at end are zeropadded */
+  block.assign (enc_params.block_size, 0);
+
+  for (size_t offset = 0; offset < block.size(); offset++)
+    {
+      if (pos + offset < analysis_signal.size())
+        block[offset] = analysis_signal[pos + offset];
+    }
+}
 
-  const uint64 n_values   = wav_data.n_values();
+/**
+ * This function computes the spectrum of one frame, storing it in audio_block.noise
+ * (and in audio_block.original_fft if debug data should be kept). The unwindowed
+ * samples of the frame are stored in audio_block.debug_samples.
+ *
+ * \param fft_in scratch buffer with block_size * zeropad entries
+ * \param fft_out scratch buffer with block_size * zeropad entries
+ */
+void
+Encoder::compute_frame_fft (size_t frame, EncoderBlock& audio_block, float *fft_in, float *fft_out)
+{
   const size_t frame_size = enc_params.frame_size;
   const size_t block_size = enc_params.block_size;
-  const int    zeropad    = enc_params.zeropad;
-  const auto&  window     = enc_params.window;
-
-  sample_count = n_values;
+  const size_t fft_size   = block_size * enc_params.zeropad;
 
-  vector<double> in (block_size * zeropad), out (block_size * zeropad + 2);
+  vector<float> block;
+  frame_samples (frame, block);
 
-  float *fft_in = FFT::new_array_float (in.size());
-  float *fft_out = FFT::new_array_float (in.size());
+  audio_block.debug_samples.assign (block.begin(), block.begin() + frame_size);
+  Block::mul (block_size, &block[0], &enc_params.window[0]);
 
-  for (uint64 pos = 0; pos < n_values; pos += enc_params.frame_step)
-    {
-      EncoderBlock audio_block;
+  std::fill (fft_in, fft_in + fft_size, 0);
 
-      /* start with zero block, so the incomplete blocks at end are zeropadded */
-      vector<float> block (block_size);
+  size_t j = fft_size - frame_size / 2;
+  for (vector<float>::const_iterator i = block.begin(); i != block.end(); i++)
+    fft_in[(j++) % fft_size] = *i;
 
-      for (size_t offset = 0; offset < block.size(); offset++)
-        {
-          if (pos + offset < wav_data.n_values())
-            block[offset] = wav_data[pos + offset];
-        }
-      vector<float> debug_samples (block.begin(), block.end());
-      Block::mul (enc_params.block_size, &block[0], &window[0]);
+  FFT::fftar_float (fft_size, fft_in, fft_out);
 
-      int j = in.size() - enc_params.frame_size / 2;
-      for (vector<float>::const_iterator i = block.begin(); i != block.end(); i++)
-        in[(j++) % in.size()] = *i;
+  audio_block.noise.assign (fft_out, fft_out + fft_size); // <- will be overwritten by noise spectrum later on
+  audio_block.noise.resize (fft_size + 2);
+  audio_block.noise[fft_size] = audio_block.noise[1];
+  audio_block.noise[fft_size + 1] = 0;
+  audio_block.noise[1] = 0;
 
-      std::copy (in.begin(), in.end(), fft_in);
-      FFT::fftar_float (in.size(), fft_in, fft_out);
-      std::copy (fft_out, fft_out + in.size(), out.begin());
+  if (enc_params.keep_debug_data)
+    audio_block.original_fft = audio_block.noise;
+}
 
-      out[block_size * zeropad] = out[1];
-      out[block_size * zeropad + 1] = 0;
-      out[1] = 0;
+/**
+ * This function computes the short-time-fourier-transform (STFT) of the input
+ * signal using a window to cut the individual frames out of the sample.
+ */
+void
+Encoder::compute_stft()
+{
+  const size_t fft_size = enc_params.block_size * enc_params.zeropad;
 
-      audio_block.noise.assign (out.begin(), out.end()); // <- will be overwritten by noise spectrum later on
-      audio_block.original_fft.assign (out.begin(), out.end());
-      audio_block.debug_samples.assign (debug_samples.begin(), debug_samples.begin() + frame_size);
+  parallel_frames (audio_blocks.size(), [&] (size_t start_frame, size_t end_frame)
+    {
+      float *fft_in = FFT::new_array_float (fft_size);
+      float *fft_out = FFT::new_array_float (fft_size);
 
-      audio_blocks.push_back (audio_block);
+      for (size_t frame = start_frame; frame < end_frame; frame++)
+        {
+          compute_frame_fft (frame, audio_blocks[frame], fft_in, fft_out);
 
-      if (killed ("_stft", audio_blocks.size() & 63))
-        break; // break to avoid leaking fft_in, fft_out
-    }
-  FFT::free_array_float (fft_in);
-  FFT::free_array_float (fft_out);
+          if (killed ("_stft", (frame + 1) & 63))
+            break; // break to avoid leaking fft_in, fft_out
+        }
+      FFT::free_array_float (fft_in);
+      FFT::free_array_float (fft_out);
+    });
 }
 
 namespace
@@ -367,10 +453,24 @@ public:
 }
 
 /**
- * This function searches for peaks in the frame ffts. These are stored in frame_tracksels.
+ * This function returns the maximum magnitude of a frame spectrum.
+ */
+static double
+max_magnitude (const vector<float>& spectrum)
+{
+  double max_mag = 0;
+  for (size_t d = 2; d + 2 < spectrum.size(); d += 2)
+    max_mag = max (max_mag, magnitude (spectrum.begin() + d));
+  return max_mag;
+}
+
+/**
+ * This function searches for peaks in the spectrum of frame n, storing them
+ * in frame_tracksels[n]. The peak magnitudes in dB are computed relative to
+ * max_mag, the maximum magnitude of all frames.
  */
 void
-Encoder::search_local_maxima()
+Encoder::search_frame_maxima (size_t n, const vector<float>& spectrum, double max_mag)
 {
   const size_t block_size = enc_params.block_size;
   const size_t frame_size = enc_params.frame_size;
@@ -384,135 +484,148 @@ Encoder::search_local_maxima()
     window_weight += window[i];
   const double window_scale = 2.0 / window_weight;
 
-  // initialize tracksel structure
-  frame_tracksels.clear();
-  frame_tracksels.resize (audio_blocks.size());
-
-  // find maximum of all values
-  double max_mag = 0;
-  for (size_t n = 0; n < audio_blocks.size(); n++)
-    {
-      for (size_t d = 2; d < block_size * zeropad; d += 2)
-	{
-	  max_mag = max (max_mag, magnitude (audio_blocks[n].noise.begin() + d));
-	}
-    }
+  vector<double> mag_values (spectrum.size() / 2);
+  for (size_t d = 0; d < block_size * zeropad; d += 2)
+    mag_values[d / 2] = magnitude (spectrum.begin() + d);
 
-  for (size_t n = 0; n < audio_blocks.size(); n++)
+  for (size_t d = 2; d < block_size * zeropad; d += 2)
     {
-      vector<double> mag_values (audio_blocks[n].noise.size() / 2);
-      for (size_t d = 0; d < block_size * zeropad; d += 2)
-        mag_values[d / 2] = magnitude (audio_blocks[n].noise.begin() + d);
-
-      for (size_t d = 2; d < block_size * zeropad; d += 2)
-	{
 #if 0
-	  double phase = atan2 (*(audio_blocks[n]->noise.begin() + d),
-	                        *(audio_blocks[n]->noise.begin() + d + 1)) / 2 / M_PI;  /* range [-0.5 .. 0.5] */
+      double phase = atan2 (*(audio_blocks[n]->noise.begin() + d),
+                            *(audio_blocks[n]->noise.begin() + d + 1)) / 2 / M_PI;  /* range [-0.5 .. 0.5] */
 #endif
-          enum { PEAK_NONE, PEAK_SINGLE, PEAK_DOUBLE } peak_type = PEAK_NONE;
+      enum { PEAK_NONE, PEAK_SINGLE, PEAK_DOUBLE } peak_type = PEAK_NONE;
 
-          if (mag_values[d/2] > mag_values[d/2-1] && mag_values[d/2] > mag_values[d/2+1])   /* search for peaks in fft magnitudes */
+      if (mag_values[d/2] > mag_values[d/2-1] && mag_values[d/2] > mag_values[d/2+1])   /* search for peaks in fft magnitudes */
+        {
+          /* single peak is the common case, where the magnitude of the middle value is
+           * larger than the magnitude of the left and right neighbour
+           */
+          peak_type = PEAK_SINGLE;
+        }
+      else
+        {
+          double epsilon_fact = 1.0 + 1e-8;
+          if (mag_values[d/2] < mag_values[d/2+1] * epsilon_fact && mag_values[d/2] * epsilon_fact > mag_values[d/2 + 1]
+          &&  mag_values[d/2] > mag_values[d/2-1] && mag_values[d/2] > mag_values[d/2+2])
             {
-              /* single peak is the common case, where the magnitude of the middle value is
-               * larger than the magnitude of the left and right neighbour
+              /* double peak is a special case, where two values in the spectrum have (almost) equal magnitude
+               * in this case, this magnitude must be larger than the value left and right of the _two_
+               * maximal values in the spectrum
                */
-              peak_type = PEAK_SINGLE;
-            }
-          else
-            {
-              double epsilon_fact = 1.0 + 1e-8;
-              if (mag_values[d/2] < mag_values[d/2+1] * epsilon_fact && mag_values[d/2] * epsilon_fact > mag_values[d/2 + 1]
-              &&  mag_values[d/2] > mag_values[d/2-1] && mag_values[d/2] > mag_values[d/2+2])
-                {
-                  /* double peak is a special case, where two values in the spectrum have (almost) equal magnitude
-                   * in this case, this magnitude must be larger than the value left and right of the _two_
-                   * maximal values in the spectrum
-                   */
-                  peak_type = PEAK_DOUBLE;
-                }
+              peak_type = PEAK_DOUBLE;
             }
+        }
 
-          const double mag2 = db_from_factor (mag_values[d / 2] / max_mag, -100);
-          debug ("dbspectrum:%zd %f\n", n, mag2);
+      const double mag2 = db_from_factor (mag_values[d / 2] / max_mag, -100);
+      debug ("dbspectrum:%zd %f\n", n, mag2);
 
-          if (peak_type != PEAK_NONE)
+      if (peak_type != PEAK_NONE)
+        {
+          if (mag2 > -90)
             {
-              if (mag2 > -90)
-                {
-                  size_t ds, de;
-                  for (ds = d / 2 - 1; ds > 0 && mag_values[ds] < mag_values[ds + 1]; ds--);
-                  for (de = d / 2 + 1; de < (mag_values.size() - 1) && mag_values[de] > mag_values[de + 1]; de++);
+              size_t ds, de;
+              for (ds = d / 2 - 1; ds > 0 && mag_values[ds] < mag_values[ds + 1]; ds--);
+              for (de = d / 2 + 1; de < (mag_values.size() - 1) && mag_values[de] > mag_values[de + 1]; de++);
 
-                  const double normalized_peak_width = (de - ds) * frame_size / double (block_size * zeropad);
+              const double normalized_peak_width = (de - ds) * frame_size / double (block_size * zeropad);
 
-                  bool peak_ok;
-                  double value;
-                  if (enc_params.get_param ("peak-width", value))
-                    peak_ok = normalized_peak_width > value;
-                  else
-                    peak_ok = normalized_peak_width > 2.9;
+              bool peak_ok;
+              double value;
+              if (enc_params.get_param ("peak-width", value))
+                peak_ok = normalized_peak_width > value;
+              else
+                peak_ok = normalized_peak_width > 2.9;
 
-                  if (peak_ok)
+              if (peak_ok)
+                {
+                  const double mag1 = db_from_factor (mag_values[d / 2 - 1] / max_mag, -100);
+                  const double mag3 = db_from_factor (mag_values[d / 2 + 1] / max_mag, -100);
+                  //double freq = d / 2 * mix_freq / (block_size * zeropad); /* bin frequency */
+
+                  QInterpolator mag_interp (mag1, mag2, mag3);
+                  double x_max = mag_interp.x_max();
+                  double tfreq = (d / 2 + x_max) * mix_freq / (block_size * zeropad);
+
+                  double peak_mag_db = mag_interp.eval (x_max);
+                  double peak_mag = db_to_factor (peak_mag_db) * max_mag;
+
+                  // use the interpolation formula for the complex values to find the phase
+                  QInterpolator re_interp (spectrum[d-2], spectrum[d], spectrum[d+2]);
+                  QInterpolator im_interp (spectrum[d-1], spectrum[d+1], spectrum[d+3]);
+/*
+                  if (mag2 > -20)
+                    printf ("%f %f %f %f %f\n", phase, last_phase[d], phase_diff, phase_diff * mix_freq / (block_size * zeropad) * overlap, tfreq);
+*/
+                  Tracksel tracksel;
+                  tracksel.frame = n;
+                  tracksel.d = d;
+                  tracksel.freq = tfreq;
+                  tracksel.mag = peak_mag * window_scale;
+                  tracksel.mag2 = mag2;
+                  tracksel.next = 0;
+                  tracksel.prev = 0;
+
+                  const double re_mag = re_interp.eval (x_max);
+                  const double im_mag = im_interp.eval (x_max);
+                  double phase = atan2 (im_mag, re_mag) + 0.5 * M_PI;
+                  // correct for the odd-centered analysis
                     {
-                      const double mag1 = db_from_factor (mag_values[d / 2 - 1] / max_mag, -100);
-                      const double mag3 = db_from_factor (mag_values[d / 2 + 1] / max_mag, -100);
-                      //double freq = d / 2 * mix_freq / (block_size * zeropad); /* bin frequency */
-
-                      QInterpolator mag_interp (mag1, mag2, mag3);
-                      double x_max = mag_interp.x_max();
-                      double tfreq = (d / 2 + x_max) * mix_freq / (block_size * zeropad);
-
-                      double peak_mag_db = mag_interp.eval (x_max);
-                      double peak_mag = db_to_factor (peak_mag_db) * max_mag;
-
-                      // use the interpolation formula for the complex values to find the phase
-                      QInterpolator re_interp (audio_blocks[n].noise[d-2], audio_blocks[n].noise[d], audio_blocks[n].noise[d+2]);
-                      QInterpolator im_interp (audio_blocks[n].noise[d-1], audio_blocks[n].noise[d+1], audio_blocks[n].noise[d+3]);
-    /*
-                      if (mag2 > -20)
-                        printf ("%f %f %f %f %f\n", phase, last_phase[d], phase_diff, phase_diff * mix_freq / (block_size * zeropad) * overlap, tfreq);
-    */
-                      Tracksel tracksel;
-                      tracksel.frame = n;
-                      tracksel.d = d;
-                      tracksel.freq = tfreq;
-                      tracksel.mag = peak_mag * window_scale;
-                      tracksel.mag2 = mag2;
-                      tracksel.next = 0;
-                      tracksel.prev = 0;
-
-                      const double re_mag = re_interp.eval (x_max);
-                      const double im_mag = im_interp.eval (x_max);
-                      double phase = atan2 (im_mag, re_mag) + 0.5 * M_PI;
-                      // correct for the odd-centered analysis
-                        {
-                          phase -= (frame_size - 1) / 2.0 / mix_freq * tracksel.freq * 2 * M_PI;
-                          phase = normalize_phase (phase);
-                        }
-                      tracksel.phase = phase;
-
-                      // FIXME: need a different criterion here
-                      // mag2 > -30 doesn't track all partials
-                      // mag2 > -60 tracks lots of junk, too
-                      if (mag2 > -90 && tracksel.freq > 10)
-                        frame_tracksels[n].push_back (tracksel);
-
-                      if (peak_type == PEAK_DOUBLE)
-                        d += 2;
+                      phase -= (frame_size - 1) / 2.0 / mix_freq * tracksel.freq * 2 * M_PI;
+                      phase = normalize_phase (phase);
                     }
+                  tracksel.phase = phase;
+
+                  // FIXME: need a different criterion here
+                  // mag2 > -30 doesn't track all partials
+                  // mag2 > -60 tracks lots of junk, too
+                  if (mag2 > -90 && tracksel.freq > 10)
+                    frame_tracksels[n].push_back (tracksel);
+
+                  if (peak_type == PEAK_DOUBLE)
+                    d += 2;
                 }
+            }
 #if 0
-              last_phase[d] = phase;
+          last_phase[d] = phase;
 #endif
-            }
-	}
-
-      if (killed ("_maxima", n & 15))
-        return;
+        }
     }
 }
 
+/**
+ * This function searches for peaks in the frame ffts. These are stored in frame_tracksels.
+ */
+void
+Encoder::search_local_maxima()
+{
+  // initialize tracksel structure
+  frame_tracksels.clear();
+  frame_tracksels.resize (audio_blocks.size());
+
+  // find maximum of all values
+  vector<double> frame_max_mag (audio_blocks.size());
+  parallel_frames (audio_blocks.size(), [&] (size_t start_frame, size_t end_frame)
+    {
+      for (size_t n = start_frame; n < end_frame; n++)
+        frame_max_mag[n] = max_magnitude (audio_blocks[n].noise);
+    });
+  double max_mag = 0;
+  for (auto m : frame_max_mag)
+    max_mag = max (max_mag, m);
+
+  parallel_frames (audio_blocks.size(), [&] (size_t start_frame, size_t end_frame)
+    {
+      for (size_t n = start_frame; n < end_frame; n++)
+        {
+          search_frame_maxima (n, audio_blocks[n].noise, max_mag);
+
+          if (killed ("_maxima", n & 15))
+            return;
+        }
+    });
+}
+
 /// @cond
 struct
 PeakIndex
@@ -652,77 +765,94 @@ Encoder::validate_partials()
 }
 
 /**
- * This function subtracts the partials from the audio signal, to get the
- * residue (remaining energy not corresponding to sine frequencies).
+ * This function subtracts the partials of one frame from its spectrum.
+ *
+ * \param fft_in scratch buffer with block_size * zeropad entries
+ * \param fft_out scratch buffer with block_size * zeropad entries
  */
 void
-Encoder::spectral_subtract()
+Encoder::subtract_frame (size_t frame, EncoderBlock& audio_block, float *fft_in, float *fft_out)
 {
   const size_t block_size = enc_params.block_size;
   const size_t frame_size = enc_params.frame_size;
   const size_t zeropad    = enc_params.zeropad;
   const auto&  window     = enc_params.window;
 
-  float *fft_in = FFT::new_array_float (block_size * zeropad);
-  float *fft_out = FFT::new_array_float (block_size * zeropad);
+  AlignedArray<float,16> signal (frame_size);
+  for (size_t i = 0; i < audio_block.freqs.size(); i++)
+    {
+      const double freq = audio_block.freqs[i];
+      const double mag = audio_block.mags[i];
+      const double phase = audio_block.phases[i];
 
-  for (uint64 frame = 0; frame < audio_blocks.size(); frame++)
+      VectorSinParams params;
+      params.mix_freq = enc_params.mix_freq;
+      params.freq = freq;
+      params.phase = phase;
+      params.mag = mag;
+      params.mode = VectorSinParams::ADD;
+
+      fast_vector_sinf (params, &signal[0], &signal[frame_size]);
+    }
+  vector<double> out (block_size * zeropad + 2);
+  // apply window
+  std::fill (fft_in, fft_in + block_size * zeropad, 0);
+  for (size_t k = 0; k < frame_size; k++)
+    fft_in[k] = window[k] * signal[k];
+  // FFT
+  FFT::fftar_float (block_size * zeropad, fft_in, fft_out);
+  std::copy (fft_out, fft_out + block_size * zeropad, out.begin());
+  out[block_size * zeropad] = out[1];
+  out[block_size * zeropad + 1] = 0;
+  out[1] = 0;
+
+  // subtract spectrum from audio spectrum
+  for (size_t d = 0; d < block_size * zeropad; d += 2)
     {
-      AlignedArray<float,16> signal (frame_size);
-      for (size_t i = 0; i < audio_blocks[frame].freqs.size(); i++)
-	{
-          const double freq = audio_blocks[frame].freqs[i];
-	  const double mag = audio_blocks[frame].mags[i];
-	  const double phase = audio_blocks[frame].phases[i];
+      double re = out[d], im = out[d + 1];
+      double sub_mag = sqrt (re * re + im * im);
+      debug ("subspectrum:%zd %g\n", frame, sub_mag);
 
-          VectorSinParams params;
-          params.mix_freq = enc_params.mix_freq;
-          params.freq = freq;
-          params.phase = phase;
-          params.mag = mag;
-          params.mode = VectorSinParams::ADD;
+      double mag = magnitude (audio_block.noise.begin() + d);
+      debug ("spectrum:%zd %g\n", frame, mag);
+      if (mag > 0)
+        {
+          audio_block.noise[d] /= mag;
+          audio_block.noise[d + 1] /= mag;
+          mag -= sub_mag;
+          if (mag < 0)
+            mag = 0;
+          audio_block.noise[d] *= mag;
+          audio_block.noise[d + 1] *= mag;
+        }
+      debug ("finalspectrum:%zd %g\n", frame, mag);
+    }
+}
 
-          fast_vector_sinf (params, &signal[0], &signal[frame_size]);
-	}
-      vector<double> out (block_size * zeropad + 2);
-      // apply window
-      std::fill (fft_in, fft_in + block_size * zeropad, 0);
-      for (size_t k = 0; k < frame_size; k++)
-        fft_in[k] = window[k] * signal[k];
-      // FFT
-      FFT::fftar_float (block_size * zeropad, fft_in, fft_out);
-      std::copy (fft_out, fft_out + block_size * zeropad, out.begin());
-      out[block_size * zeropad] = out[1];
-      out[block_size * zeropad + 1] = 0;
-      out[1] = 0;
-
-      // subtract spectrum from audio spectrum
-      for (size_t d = 0; d < block_size * zeropad; d += 2)
-	{
-	  double re = out[d], im = out[d + 1];
-	  double sub_mag = sqrt (re * re + im * im);
-	  debug ("subspectrum:%" PRId64 " %g\n", frame, sub_mag);
+/**
+ * This function subtracts the partials from the audio signal, to get the
+ * residue (remaining energy not corresponding to sine frequencies).
+ */
+void
+Encoder::spectral_subtract()
+{
+  const size_t fft_size = enc_params.block_size * enc_params.zeropad;
 
-	  double mag = magnitude (audio_blocks[frame].noise.begin() + d);
-	  debug ("spectrum:%" PRId64 " %g\n", frame, mag);
-	  if (mag > 0)
-	    {
-	      audio_blocks[frame].noise[d] /= mag;
-	      audio_blocks[frame].noise[d + 1] /= mag;
-	      mag -= sub_mag;
-	      if (mag < 0)
-		mag = 0;
-	      audio_blocks[frame].noise[d] *= mag;
-	      audio_blocks[frame].noise[d + 1] *= mag;
-	    }
-	  debug ("finalspectrum:%" PRId64 " %g\n", frame, mag);
-	}
+  parallel_frames (audio_blocks.size(), [&] (size_t start_frame, size_t end_frame)
+    {
+      float *fft_in = FFT::new_array_float (fft_size);
+      float *fft_out = FFT::new_array_float (fft_size);
 
-      if (killed ("_subtract", frame & 7))
-        return;
-    }
-  FFT::free_array_float (fft_in);
-  FFT::free_array_float (fft_out);
+      for (size_t frame = start_frame; frame < end_frame; frame++)
+        {
+          subtract_frame (frame, audio_blocks[frame], fft_in, fft_out);
+
+          if (killed ("_subtract", frame & 7))
+            break; // break to avoid leaking fft_in, fft_out
+        }
+      FFT::free_array_float (fft_in);
+      FFT::free_array_float (fft_out);
+    });
 }
 
 template<class AIter, class BIter>
@@ -738,25 +868,64 @@ float_vector_delta (AIter ai, AIter aend, BIter bi)
   return d;
 }
 
-static void
-refine_sine_params_fast (EncoderBlock& audio_block, double mix_freq, int frame, const vector<float>& window)
+/**
+ * Precompute window data used by refine_sine_params().
+ *
+ * Since the analysis window is symmetric around the frame center c, the
+ * refinement only needs the window folded around c (w[c] at t = 0, and
+ * w[c + t] + w[c - t] for t > 0) and the sum of all window values.
+ */
+void
+Encoder::setup_refine_window()
+{
+  const size_t frame_size = enc_params.frame_size;
+  const size_t center     = (frame_size - 1) / 2;
+  const auto&  window     = enc_params.window;
+
+  refine_window.window_weight = 0;
+  for (size_t i = 0; i < frame_size; i++)
+    refine_window.window_weight += window[i];
+
+  refine_window.folded_window.resize (center + 1);
+  refine_window.folded_window[0] = window[center];
+  for (size_t t = 1; t <= center; t++)
+    refine_window.folded_window[t] = window[center + t] + window[center - t];
+}
+
+/**
+ * Re-estimate magnitude and phase of the partials of one frame (this requires
+ * the debug_samples of the frame). Partials are processed from loudest to
+ * quietest; for each partial the original signal minus all other partials is
+ * projected onto a windowed sine/cosine at the partial frequency.
+ *
+ * The window is symmetric, so the projection can be computed on the frame
+ * folded around its center, with half the number of sin/cos values. The
+ * contribution of the partial itself is computed analytically from the window
+ * sums, as the residual (signal minus all partials) is the same for all
+ * partials of the frame.
+ */
+void
+Encoder::refine_sine_params (EncoderBlock& audio_block)
 {
+  const double mix_freq   = enc_params.mix_freq;
   const size_t frame_size = audio_block.debug_samples.size();
+  const size_t center     = (frame_size - 1) / 2;
+  const size_t half_size  = center + 1;
+  const auto&  window     = enc_params.window;
+
+  assert (frame_size == enc_params.frame_size && frame_size % 2 == 1);
+  assert (refine_window.folded_window.size() == half_size);
 
-  AlignedArray<float, 16> sin_vec (frame_size);
-  AlignedArray<float, 16> cos_vec (frame_size);
-  AlignedArray<float, 16> sines (frame_size);
   AlignedArray<float, 16> all_sines (frame_size);
+  AlignedArray<float, 16> sin_vec (half_size);
+  AlignedArray<float, 16> cos_vec (half_size);
+  vector<float> res_even (half_size);
+  vector<float> res_odd (half_size);
 
   vector<float> good_freqs;
   vector<float> good_mags;
   vector<float> good_phases;
 
-  // figure out normalization for window
-  double window_weight = 0;
-  for (size_t i = 0; i < frame_size; i++)
-    window_weight += window[i];
-
   for (size_t i = 0; i < audio_block.freqs.size(); i++)
     {
       VectorSinParams params;
@@ -770,6 +939,24 @@ refine_sine_params_fast (EncoderBlock& audio_block, double mix_freq, int frame,
       fast_vector_sinf (params, &all_sines[0], &all_sines[frame_size]);
     }
 
+  // windowed residual, folded around the center into even and odd part
+  auto residual = [&] (size_t n) -> double {
+    return (audio_block.debug_samples[n] - all_sines[n]) * window[n];
+  };
+  res_even[0] = residual (center);
+  res_odd[0]  = 0;
+  for (size_t t = 1; t <= center; t++)
+    {
+      const double r_right = residual (center + t);
+      const double r_left  = residual (center - t);
+
+      res_even[t] = r_right + r_left;
+      res_odd[t]  = r_right - r_left;
+    }
+
+  const double window_weight = refine_window.window_weight;
+  const float *folded_window = refine_window.folded_window.data();
+
   double max_mag;
   size_t partial = 0;
   do
@@ -790,74 +977,76 @@ refine_sine_params_fast (EncoderBlock& audio_block, double mix_freq, int frame,
       if (max_mag > 0)
         {
           // remove partial, so we only do each partial once
-          double f = audio_block.freqs[partial];
+          const double f = audio_block.freqs[partial];
+          const double omega = f / mix_freq * 2.0 * M_PI;
 
           audio_block.mags[partial] = 0;
 
-          double phase;
-          // determine "perfect" phase and magnitude instead of using interpolated fft phase
-          double x_re = 0;
-          double x_im = 0;
-
+          // sin (omega * t), cos (omega * t) relative to the frame center
           VectorSinParams params;
 
           params.mix_freq = mix_freq;
           params.freq = f;
           params.mag = 1;
-          params.phase = -((frame_size - 1) / 2.0) * f / mix_freq * 2.0 * M_PI;
-          params.phase = normalize_phase (params.phase);
+          params.phase = 0;
           params.mode = VectorSinParams::REPLACE;
 
-          fast_vector_sincosf (params, &sin_vec[0], &sin_vec[frame_size], &cos_vec[0]);
-
-          params.freq  = f;
-          params.mag   = max_mag;
-          params.phase = audio_block.phases[partial];
-          params.mode  = VectorSinParams::REPLACE;
-
-          fast_vector_sinf (params, &sines[0], &sines[frame_size]);
-
-          for (size_t n = 0; n < frame_size; n++)
+          fast_vector_sincosf (params, &sin_vec[0], &sin_vec[half_size], &cos_vec[0]);
+
+          /* multiply windowed residual with complex exp function from fourier transform:
+           *
+           *   v * exp (-j * x) = v * (cos (x) - j * sin (x))
+           *
+           * cos is even and sin is odd around the center, so only the even/odd
+           * part of the residual contributes; the mirrored window (caused by negative
+           * frequency component) is w2omega = sum (w (t) * cos (2 * omega * t)), with
+           * cos (2x) = 2 * cos (x)^2 - 1
+           */
+          double re[4] = { 0, 0, 0, 0 };
+          double im[4] = { 0, 0, 0, 0 };
+          double w2[4] = { 0, 0, 0, 0 };
+
+          size_t t = 0;
+          for (; t + 4 <= half_size; t += 4)
             {
-              double v = audio_block.debug_samples[n] - all_sines[n] + sines[n];
-              v *= window[n];
-
-              // multiply windowed signal with complex exp function from fourier transform:
-              //
-              //   v * exp (-j * x) = v * (cos (x) - j * sin (x))
-              x_re += v * cos_vec[n];
-              x_im -= v * sin_vec[n];
-            }
-
-          // correct influence of mirrored window (caused by negative frequency component)
-          params.mix_freq = mix_freq;
-          params.freq = 2 * f;
-          params.mag = 1;
-          params.phase = -((frame_size - 1) / 2.0) * (2 * f) / mix_freq * 2.0 * M_PI + 0.5 * M_PI;
-          params.phase = normalize_phase (params.phase);
-          params.mode = VectorSinParams::REPLACE;
-          fast_vector_sinf (params, &cos_vec[0], &cos_vec[frame_size]);
+              for (int k = 0; k < 4; k++)
+                {
+                  const double c = cos_vec[t + k];
 
-          double w2omega = 0;
-          for (size_t n = 0; n < frame_size; n++)
-            w2omega += window[n] * cos_vec[n];
+                  re[k] += res_even[t + k] * c;
+                  im[k] -= res_odd[t + k] * sin_vec[t + k];
+                  w2[k] += folded_window[t + k] * (2 * c * c - 1);
+                }
+            }
+          for (; t < half_size; t++)
+            {
+              const double c = cos_vec[t];
 
-          x_re *= 2 / (window_weight + w2omega);
-          x_im *= 2 / (window_weight - w2omega);
+              re[0] += res_even[t] * c;
+              im[0] -= res_odd[t] * sin_vec[t];
+              w2[0] += folded_window[t] * (2 * c * c - 1);
+            }
+          const double x_re_residual = (re[0] + re[1]) + (re[2] + re[3]);
+          const double x_im_residual = (im[0] + im[1]) + (im[2] + im[3]);
+          const double w2omega       = (w2[0] + w2[1]) + (w2[2] + w2[3]);
+
+          /* the partial itself, max_mag * sin (omega * t + center_phase), contributes
+           *
+           *   x_re = max_mag * sin (center_phase) * (window_weight + w2omega) / 2
+           *   x_im = -max_mag * cos (center_phase) * (window_weight - w2omega) / 2
+           *
+           * which cancels exactly with the normalization below
+           */
+          const double center_phase = audio_block.phases[partial] + center * omega;
+          const double x_re = x_re_residual * 2 / (window_weight + w2omega) + max_mag * sin (center_phase);
+          const double x_im = x_im_residual * 2 / (window_weight - w2omega) - max_mag * cos (center_phase);
 
           // compute final magnitude & phase
           double magnitude = sqrt (x_re * x_re + x_im * x_im);
-          phase = atan2 (x_im, x_re) + 0.5 * M_PI;
-          phase -= (frame_size - 1) / 2.0 / mix_freq * f * 2 * M_PI;
+          double phase = atan2 (x_im, x_re) + 0.5 * M_PI;
+          phase -= center * omega;
           phase = normalize_phase (phase);
 
-          // restore partial => sines; keep params.freq & params.mix_freq
-          params.freq = f;
-          params.phase = phase;
-          params.mag = magnitude;
-          params.mode = VectorSinParams::ADD;
-          fast_vector_sinf (params, &sines[0], &sines[frame_size]);
-
           // store refined freq, mag and phase
           good_freqs.push_back (f);
           good_mags.push_back (magnitude);
@@ -926,18 +1115,19 @@ remove_small_partials (EncoderBlock& audio_block)
 void
 Encoder::optimize_partials (int optimization_level)
 {
-  const double mix_freq = enc_params.mix_freq;
-
-  for (uint64 frame = 0; frame < audio_blocks.size(); frame++)
+  parallel_frames (audio_blocks.size(), [&] (size_t start_frame, size_t end_frame)
     {
-      if (optimization_level >= 1) // redo FFT estmates, only better
-        refine_sine_params_fast (audio_blocks[frame], mix_freq, frame, enc_params.window);
+      for (size_t frame = start_frame; frame < end_frame; frame++)
+        {
+          if (optimization_level >= 1) // redo FFT estmates, only better
+            refine_sine_params (audio_blocks[frame]);
 
-      remove_small_partials (audio_blocks[frame]);
+          remove_small_partials (audio_blocks[frame]);
 
-      if (killed ("_optimize"))
-        return;
-    }
+          if (killed ("_optimize"))
+            return;
+        }
+    });
 }
 
 static double
@@ -1066,11 +1256,11 @@ xnoise_envelope_to_spectrum (int frame,
 }
 
 /**
- * This function tries to approximate the residual by a spectral envelope
- * for a noise signal.
+ * This function approximates the residual spectrum of one frame by a noise
+ * envelope, which replaces the spectrum in audio_block.noise.
  */
 void
-Encoder::approx_noise()
+Encoder::approx_frame_noise (size_t frame, EncoderBlock& audio_block)
 {
   const size_t block_size = enc_params.block_size;
   const size_t frame_size = enc_params.frame_size;
@@ -1084,118 +1274,182 @@ Encoder::approx_noise()
   // sum_w2 is the average influence of the window (w[x]^2), multiplied with frame_size
   const double norm = 0.5 * enc_params.mix_freq * sum_w2;
 
-  for (uint64 frame = 0; frame < audio_blocks.size(); frame++)
+  vector<double> noise_envelope (32);
+  vector<double> spectrum (audio_block.noise.begin(), audio_block.noise.end());
+
+  /* A complex FFT would preserve the energy of the input signal exactly; the difference to
+   * our (real) FFT is that every value in the complex spectrum occurs twice, once as "positive"
+   * frequency, once as "negative" frequency - except for two spectrum values: the value
+   * for frequency 0, and the value for frequency mix_freq / 2.
+   *
+   * To make this FFT energy preserving, we scale those values with a factor of sqrt (2) so
+   * that their energy is twice as big (energy == squared value). Then we scale the whole
+   * thing with a factor of 0.5, and we get an energy preserving transformation.
+   */
+  spectrum[0] /= sqrt (2);
+  spectrum[spectrum.size() - 2] /= sqrt (2);
+
+  approximate_noise_spectrum (frame, enc_params.mix_freq, spectrum, noise_envelope, norm);
+
+  /// DEBUG CODE {
+  const size_t fft_size = block_size * zeropad;
+  const double debug_norm = fft_size * 0.5 * sum_w2;
+
+  vector<double> approx_spectrum (fft_size);
+  xnoise_envelope_to_spectrum (frame, enc_params.mix_freq, noise_envelope, approx_spectrum, norm);
+  for (size_t i = 0; i < approx_spectrum.size(); i += 2)
+    debug ("spect_approx:%zd %g\n", frame, approx_spectrum[i]);
+
+  double spect_energy = 0;
+  for (vector<double>::iterator si = approx_spectrum.begin(); si != approx_spectrum.end(); si++)
+    spect_energy += *si * *si / debug_norm;
+
+  double b4_energy = 0;
+  for (vector<double>::iterator si = spectrum.begin(); si != spectrum.end(); si++)
+    b4_energy += *si * *si / debug_norm;
+
+  double r_energy = 0;
+  for (vector<float>::iterator ri = audio_block.debug_samples.begin(); ri != audio_block.debug_samples.end(); ri++)
+    r_energy += *ri * *ri / audio_block.debug_samples.size();
+
+  debug ("noiseenergy:%zd %f %f %f\n", frame, spect_energy, b4_energy, r_energy);
+  /// } DEBUG_CODE
+
+  // assign a new vector (instead of resizing), to free the memory used by the spectrum
+  audio_block.noise = vector<float> (noise_envelope.begin(), noise_envelope.end());
+}
+
+/**
+ * This function tries to approximate the residual by a spectral envelope
+ * for a noise signal.
+ */
+void
+Encoder::approx_noise()
+{
+  parallel_frames (audio_blocks.size(), [&] (size_t start_frame, size_t end_frame)
     {
-      vector<double> noise_envelope (32);
-      vector<double> spectrum (audio_blocks[frame].noise.begin(), audio_blocks[frame].noise.end());
-
-      /* A complex FFT would preserve the energy of the input signal exactly; the difference to
-       * our (real) FFT is that every value in the complex spectrum occurs twice, once as "positive"
-       * frequency, once as "negative" frequency - except for two spectrum values: the value
-       * for frequency 0, and the value for frequency mix_freq / 2.
-       *
-       * To make this FFT energy preserving, we scale those values with a factor of sqrt (2) so
-       * that their energy is twice as big (energy == squared value). Then we scale the whole
-       * thing with a factor of 0.5, and we get an energy preserving transformation.
-       */
-      spectrum[0] /= sqrt (2);
-      spectrum[spectrum.size() - 2] /= sqrt (2);
-
-      approximate_noise_spectrum (frame, enc_params.mix_freq, spectrum, noise_envelope, norm);
-
-      /// DEBUG CODE {
-      const size_t fft_size = block_size * zeropad;
-      const double debug_norm = fft_size * 0.5 * sum_w2;
-
-      vector<double> approx_spectrum (fft_size);
-      xnoise_envelope_to_spectrum (frame, enc_params.mix_freq, noise_envelope, approx_spectrum, norm);
-      for (size_t i = 0; i < approx_spectrum.size(); i += 2)
-        debug ("spect_approx:%" PRId64 " %g\n", frame, approx_spectrum[i]);
-
-      double spect_energy = 0;
-      for (vector<double>::iterator si = approx_spectrum.begin(); si != approx_spectrum.end(); si++)
-        spect_energy += *si * *si / debug_norm;
-
-      double b4_energy = 0;
-      for (vector<double>::iterator si = spectrum.begin(); si != spectrum.end(); si++)
-        b4_energy += *si * *si / debug_norm;
-
-      double r_energy = 0;
-      for (vector<float>::iterator ri = audio_blocks[frame].debug_samples.begin(); ri != audio_blocks[frame].debug_samples.end(); ri++)
-        r_energy += *ri * *ri / audio_blocks[frame].debug_samples.size();
-
-      debug ("noiseenergy:%" PRId64 " %f %f %f\n", frame, spect_energy, b4_energy, r_energy);
-      /// } DEBUG_CODE
-      audio_blocks[frame].noise.assign (noise_envelope.begin(), noise_envelope.end());
-
-      if (killed ("_noise", frame & 7))
-        return;
-    }
+      for (size_t frame = start_frame; frame < end_frame; frame++)
+        {
+          approx_frame_noise (frame, audio_blocks[frame]);
+
+          if (killed ("_noise", frame & 7))
+            return;
+        }
+    });
 }
 
+/**
+ * This function computes the error between the original signal and the
+ * decoded signal for the first frames, using the attack envelope given by
+ * attack.
+ *
+ * Only frames that start before the end of the attack depend on the attack
+ * envelope. The decoded signal after the last of these frames is the same
+ * for all attack candidates, so the error for this part is taken from
+ * signal.tail_error.
+ */
 double
-Encoder::attack_error (const vector< vector<double> >& unscaled_signal, const Attack& attack, vector<double>& out_scale)
+Encoder::attack_error (AttackSignal& signal, const Attack& attack, vector<double>& out_scale)
 {
-  const size_t frames = unscaled_signal.size();
-  double total_error = 0;
-  vector<double> decoded_signal (enc_params.frame_size + enc_params.frame_step * frames);
-  vector<double> orig_signal (decoded_signal.size());
+  const size_t frames = signal.unscaled.size();
+  const size_t frame_step = enc_params.frame_step;
+  const double attack_len_ms = attack.attack_end_ms - attack.attack_start_ms;
 
   const auto& window = enc_params.window;
 
+  auto n_ms = [&] (size_t f, size_t n) {
+    return f * enc_params.frame_step_ms + n * 1000.0 / enc_params.mix_freq;
+  };
+  /* n_ms is monotonic, so we can use binary search to find the first sample with n_ms >= ms */
+  auto first_sample = [&] (size_t f, double ms) {
+    size_t lo = 0, hi = signal.unscaled[f].size();
+    while (lo < hi)
+      {
+        const size_t mid = (lo + hi) / 2;
+        if (n_ms (f, mid) < ms)
+          lo = mid + 1;
+        else
+          hi = mid;
+      }
+    return lo;
+  };
+
+  size_t n_attack_frames = 0;
+  while (n_attack_frames < frames && first_sample (n_attack_frames, attack.attack_end_ms) > 0)
+    n_attack_frames++;
+
+  const size_t decoded_len = n_attack_frames ? (n_attack_frames - 1) * frame_step + signal.unscaled[0].size() : 0;
+
+  std::fill (signal.decoded.begin(), signal.decoded.begin() + decoded_len, 0);
+
   for (size_t f = 0; f < frames; f++)
     {
-      const vector<double>& frame_signal = unscaled_signal[f];
-      size_t zero_values = 0;
-      double scale = 1.0;
+      const vector<double>& frame_signal = signal.unscaled[f];
+      const size_t frame_size = frame_signal.size();
+      double *decoded_signal = &signal.decoded[f * frame_step];
 
-      for (size_t n = 0; n < frame_signal.size(); n++)
+      if (f >= n_attack_frames)
         {
-          const double n_ms = f * enc_params.frame_step_ms + n * 1000.0 / enc_params.mix_freq;
-          double env;
-          if (n_ms < attack.attack_start_ms)
-            {
-              env = 0;
-              zero_values++;
+          /* frame after attack: env = 1, scale = 1 */
+          if (f * frame_step >= decoded_len)
+            break;
 
-              size_t samples_in_frame = frame_signal.size() - zero_values;
-              if (samples_in_frame < (frame_signal.size() / 8))
-                {
-                  /* if we have very few samples in frame, the partials will
-                   * not be reliable, so in this case we cancel out the frame
-                   */
-                  scale = 0;
-                }
-              else
-                {
-                  /* based on an incomplete frame, we boost the partials
-                   * to obtain an estimate for one whole frame
-                   */
-                  scale = frame_signal.size() / double (samples_in_frame);
-                }
+          const vector<double>& windowed_signal = signal.windowed[f];
+          const size_t end = std::min (frame_size, decoded_len - f * frame_step);
+          for (size_t n = 0; n < end; n++)
+            decoded_signal[n] += windowed_signal[n];
+
+          continue;
+        }
+      const size_t attack_start = first_sample (f, attack.attack_start_ms);
+      const size_t attack_end   = first_sample (f, attack.attack_end_ms);
+
+      /* the samples before attack_start are zero */
+      const size_t zero_values = attack_start;
+      double scale = 1.0;
+      if (zero_values > 0)
+        {
+          size_t samples_in_frame = frame_size - zero_values;
+          if (samples_in_frame < (frame_size / 8))
+            {
+              /* if we have very few samples in frame, the partials will
+               * not be reliable, so in this case we cancel out the frame
+               */
+              scale = 0;
             }
-          else if (n_ms < attack.attack_end_ms)  // during attack
+          else
             {
-              const double attack_len_ms = attack.attack_end_ms - attack.attack_start_ms;
-
-              env = (n_ms - attack.attack_start_ms) / attack_len_ms;
+              /* based on an incomplete frame, we boost the partials
+               * to obtain an estimate for one whole frame
+               */
+              scale = frame_size / double (samples_in_frame);
             }
-          else // after attack
+        }
+      if (scale != 0)
+        {
+          // during attack
+          for (size_t n = attack_start; n < attack_end; n++)
             {
-              env = 1.0;
+              const double env = (n_ms (f, n) - attack.attack_start_ms) / attack_len_ms;
+
+              decoded_signal[n] += frame_signal[n] * scale * env * window[n];
             }
-          decoded_signal[f * enc_params.frame_step + n] += frame_signal[n] * scale * env * window[n];
-          orig_signal[f * enc_params.frame_step + n] = audio_blocks[f].debug_samples[n];
+          // after attack
+          for (size_t n = attack_end; n < frame_size; n++)
+            decoded_signal[n] += frame_signal[n] * scale * window[n];
         }
       out_scale[f] = scale;
     }
-  for (size_t i = 0; i < decoded_signal.size(); i++)
+  for (size_t f = n_attack_frames; f < frames; f++)
+    out_scale[f] = 1.0;
+
+  double total_error = 0;
+  for (size_t i = 0; i < decoded_len; i++)
     {
-      double error = orig_signal[i] - decoded_signal[i];
-      //printf ("%d %f %f\n", i,orig_signal[i], decoded_signal[i]);
+      double error = signal.original[i] - signal.decoded[i];
       total_error += error * error;
     }
-  return total_error;
+  return total_error + signal.tail_error[decoded_len];
 }
 
 /**
@@ -1209,9 +1463,12 @@ Encoder::compute_attack_params()
 
   const double mix_freq   = enc_params.mix_freq;
   const size_t frame_size = enc_params.frame_size;
-  const size_t frames = MIN (20, audio_blocks.size());
+  const size_t frames = MIN (attack_frames, audio_blocks.size());
+
+  AttackSignal signal;
+  signal.decoded.resize (frame_size + enc_params.frame_step * frames);
+  signal.original.resize (signal.decoded.size());
 
-  vector< vector<double> > unscaled_signal;
   for (size_t f = 0; f < frames; f++)
     {
       const EncoderBlock& audio_block = audio_blocks[f];
@@ -1220,21 +1477,45 @@ Encoder::compute_attack_params()
       for (size_t partial = 0; partial < audio_block.freqs.size(); partial++)
         {
           const double SA = 0.5;
-          double mag   = audio_block.mags[partial] * SA;
-          double f     = audio_block.freqs[partial];
-          double phase = audio_block.phases[partial];
+
+          if (audio_block.mags[partial] <= 0)
+            continue;
 
           // do a phase optimal reconstruction of that partial
-          for (size_t n = 0; n < frame_signal.size(); n++)
-            {
-              frame_signal[n] += sin (phase) * mag;
-              phase += f / mix_freq * 2.0 * M_PI;
-            }
+          VectorSinParams params;
+          params.mix_freq = mix_freq;
+          params.freq     = audio_block.freqs[partial];
+          params.phase    = audio_block.phases[partial];
+          params.mag      = audio_block.mags[partial] * SA;
+          params.mode     = VectorSinParams::ADD;
+
+          fast_vector_sin (params, frame_signal.begin(), frame_signal.end());
 
           if (killed ("__attack", killed_iteration++ & 63))
             return;
         }
-      unscaled_signal.push_back (frame_signal);
+      vector<double> windowed_signal (frame_size);
+      for (size_t n = 0; n < frame_size; n++)
+        {
+          windowed_signal[n] = frame_signal[n] * enc_params.window[n];
+          signal.original[f * enc_params.frame_step + n] = audio_block.debug_samples[n];
+        }
+      signal.unscaled.push_back (std::move (frame_signal));
+      signal.windowed.push_back (std::move (windowed_signal));
+    }
+
+  /* error without attack envelope, summed from sample i to the end */
+  vector<double> decoded_signal (signal.decoded.size());
+  for (size_t f = 0; f < frames; f++)
+    {
+      for (size_t n = 0; n < frame_size; n++)
+        decoded_signal[f * enc_params.frame_step + n] += signal.windowed[f][n];
+    }
+  signal.tail_error.resize (decoded_signal.size() + 1);
+  for (size_t i = decoded_signal.size(); i > 0; i--)
+    {
+      double error = signal.original[i - 1] - decoded_signal[i - 1];
+      signal.tail_error[i - 1] = signal.tail_error[i] + error * error;
     }
 
   /* make attack envelope deterministically return the same result for the same input every time */
@@ -1276,7 +1557,7 @@ Encoder::compute_attack_params()
           new_attack.attack_start_ms >= zero_values_at_start_ms &&
           new_attack.attack_end_ms < 200)
         {
-          const double new_error = attack_error (unscaled_signal, new_attack, scale);
+          const double new_error = attack_error (signal, new_attack, scale);
 #if 0
           printf ("attack=<%f, %f> error=%.17g new_attack=<%f, %f> new_arror=%.17g\n", attack.attack_start_ms, attack.attack_end_ms, error,
                                                                                        new_attack.attack_start_ms, new_attack.attack_end_ms, new_error);
@@ -1302,6 +1583,53 @@ Encoder::compute_attack_params()
         audio_blocks[f].mags[i] *= scale[f];
     }
   optimal_attack = attack;
+
+  attack_to_frame_cache (scale);
+}
+
+/**
+ * The attack optimization only depends on the first frames. So if the signal
+ * start didn't change since the last encoder run, and the frames used for
+ * the attack optimization are not affected by the end of the signal, the
+ * attack parameters can be kept in the frame cache.
+ */
+bool
+Encoder::attack_in_frame_cache()
+{
+  const size_t attack_samples = enc_params.frame_step * (attack_frames - 1) + enc_params.frame_size;
+
+  return updated_frame_cache && attack_samples <= sample_count;
+}
+
+bool
+Encoder::attack_from_frame_cache()
+{
+  if (!attack_in_frame_cache() || updated_frame_cache->attack_signal_start != frame_cache_signal_start)
+    return false;
+
+  const vector<double>& scale = updated_frame_cache->attack_scale;
+  assert (scale.size() == attack_frames && audio_blocks.size() >= attack_frames);
+
+  for (size_t f = 0; f < attack_frames; f++)
+    {
+      for (size_t i = 0; i < audio_blocks[f].mags.size(); i++)
+        audio_blocks[f].mags[i] *= scale[f];
+    }
+  optimal_attack.attack_start_ms = updated_frame_cache->attack_start_ms;
+  optimal_attack.attack_end_ms   = updated_frame_cache->attack_end_ms;
+  return true;
+}
+
+void
+Encoder::attack_to_frame_cache (const vector<double>& scale)
+{
+  if (!attack_in_frame_cache())
+    return;
+
+  updated_frame_cache->attack_signal_start = frame_cache_signal_start;
+  updated_frame_cache->attack_start_ms     = optimal_attack.attack_start_ms;
+  updated_frame_cache->attack_end_ms       = optimal_attack.attack_end_ms;
+  updated_frame_cache->attack_scale        = scale;
 }
 
 struct PartialData
@@ -1354,59 +1682,739 @@ Encoder::sort_freqs()
 }
 
 /**
- * This function calls all steps necessary for encoding in the right order.
+ * This function finds the spectral peaks of all frames and links them to
+ * partials in streaming mode (see encode_frames_streaming()). The validated
+ * partials are stored in audio_blocks.
+ */
+bool
+Encoder::track_peaks_streaming()
+{
+  const size_t fft_size = enc_params.block_size * enc_params.zeropad;
+
+  frame_tracksels.clear();
+  frame_tracksels.resize (audio_blocks.size());
+
+  // find maximum of all values
+  vector<double> frame_max_mag (audio_blocks.size());
+  parallel_frames (audio_blocks.size(), [&] (size_t start_frame, size_t end_frame)
+    {
+      EncoderBlock block;
+      float *fft_in = FFT::new_array_float (fft_size);
+      float *fft_out = FFT::new_array_float (fft_size);
+
+      for (size_t frame = start_frame; frame < end_frame; frame++)
+        {
+          compute_frame_fft (frame, block, fft_in, fft_out);
+          frame_max_mag[frame] = max_magnitude (block.noise);
+
+          if (killed ("_stft", (frame + 1) & 63))
+            break; // break to avoid leaking fft_in, fft_out
+        }
+      FFT::free_array_float (fft_in);
+      FFT::free_array_float (fft_out);
+    });
+  profile_stage ("stft");
+  if (killed ("stft"))
+    return false;
+
+  double max_mag = 0;
+  for (auto m : frame_max_mag)
+    max_mag = max (max_mag, m);
+
+  parallel_frames (audio_blocks.size(), [&] (size_t start_frame, size_t end_frame)
+    {
+      EncoderBlock block;
+      float *fft_in = FFT::new_array_float (fft_size);
+      float *fft_out = FFT::new_array_float (fft_size);
+
+      for (size_t frame = start_frame; frame < end_frame; frame++)
+        {
+          compute_frame_fft (frame, block, fft_in, fft_out);
+          search_frame_maxima (frame, block.noise, max_mag);
+
+          if (killed ("_maxima", frame & 15))
+            break; // break to avoid leaking fft_in, fft_out
+        }
+      FFT::free_array_float (fft_in);
+      FFT::free_array_float (fft_out);
+    });
+  profile_stage ("maxima");
+  if (killed ("maxima"))
+    return false;
+
+  link_partials();
+  profile_stage ("link");
+  if (killed ("link"))
+    return false;
+
+  validate_partials();
+  profile_stage ("validate");
+  if (killed ("validate"))
+    return false;
+
+  frame_tracksels = vector< vector<Tracksel> >(); // free memory
+  return true;
+}
+
+/**
+ * This function runs the encoder steps which depend on more than one frame in
+ * streaming mode. Instead of keeping the spectrum of every frame in memory, the
+ * frames are processed one at a time, and only the data needed by later steps
+ * is kept: the spectral peaks, and later the partials and noise envelope of
+ * each frame.
  *
- * \param dhandle a data handle containing the signal to be encoded
- * \param optimization_level determines if fast (0), medium (1), or very slow (2) algorithm is used
- * \param attack whether to find the optimal attack parameters
+ * Peak detection needs the maximum magnitude of all frames, and partials can
+ * only be validated after the peaks of all frames have been linked, so the
+ * spectrum of each frame is computed up to three times. The result is the
+ * same as in non-streaming mode.
+ *
+ * \param find_partials if false, the partials in audio_blocks have already been
+ * computed (see find_partials_downsampled()) and are only subtracted
  */
 bool
-Encoder::encode (const WavData& wav_data, int channel, int optimization_level,
-                 bool attack, bool track_sines)
+Encoder::encode_frames_streaming (int optimization_level, bool track_sines, bool find_partials)
+{
+  const size_t fft_size = enc_params.block_size * enc_params.zeropad;
+
+  if (track_sines && find_partials && !track_peaks_streaming())
+    return false;
+
+  parallel_frames (audio_blocks.size(), [&] (size_t start_frame, size_t end_frame)
+    {
+      float *fft_in = FFT::new_array_float (fft_size);
+      float *fft_out = FFT::new_array_float (fft_size);
+
+      for (size_t frame = start_frame; frame < end_frame; frame++)
+        {
+          EncoderBlock& audio_block = audio_blocks[frame];
+
+          compute_frame_fft (frame, audio_block, fft_in, fft_out);
+          if (track_sines)
+            {
+              if (find_partials)
+                {
+                  if (optimization_level >= 1) // redo FFT estmates, only better
+                    refine_sine_params (audio_block);
+
+                  remove_small_partials (audio_block);
+                }
+              subtract_frame (frame, audio_block, fft_in, fft_out);
+            }
+          approx_frame_noise (frame, audio_block);
+
+          /* the samples of the first frames are needed by compute_attack_params() */
+          if (!enc_params.keep_debug_data && frame >= attack_frames)
+            audio_block.debug_samples = vector<float>();
+
+          if (killed ("_frames", frame & 7))
+            break; // break to avoid leaking fft_in, fft_out
+        }
+      FFT::free_array_float (fft_in);
+      FFT::free_array_float (fft_out);
+    });
+  profile_stage ("frames"); // optimize, subtract and noise for each frame
+  if (killed ("frames"))
+    return false;
+
+  return true;
+}
+
+/**
+ * This function finds the partials of all frames, using the spectrum computed
+ * by compute_stft().
+ */
+bool
+Encoder::track_partials (int optimization_level)
 {
-  compute_stft (wav_data, channel);
+  search_local_maxima();
+  profile_stage ("maxima");
+  if (killed ("maxima"))
+    return false;
+
+  link_partials();
+  profile_stage ("link");
+  if (killed ("link"))
+    return false;
+
+  validate_partials();
+  profile_stage ("validate");
+  if (killed ("validate"))
+    return false;
+
+  optimize_partials (optimization_level);
+  profile_stage ("optimize");
+  if (killed ("optimize"))
+    return false;
+
+  return true;
+}
+
+/**
+ * This function runs the encoder steps which depend on more than one frame
+ * with the spectrum of all frames in memory.
+ *
+ * \param find_partials if false, the partials in audio_blocks have already been
+ * computed (see find_partials_downsampled()) and are only subtracted
+ */
+bool
+Encoder::encode_frames (int optimization_level, bool track_sines, bool find_partials)
+{
+  compute_stft();
+  profile_stage ("stft");
   if (killed ("stft"))
     return false;
 
   if (track_sines)
     {
-      search_local_maxima();
+      if (find_partials && !track_partials (optimization_level))
+        return false;
+
+      spectral_subtract();
+      profile_stage ("subtract");
+      if (killed ("subtract"))
+        return false;
+    }
+  approx_noise();
+  profile_stage ("noise");
+  if (killed ("noise"))
+    return false;
+
+  return true;
+}
+
+/**
+ * This function runs all encoder steps for the frames which are not available
+ * from the frame cache, see EncoderFrameCache. Frames that contain zero padding
+ * (at the start and end of the signal) are always analyzed. If the maximum
+ * magnitude of all frames differs from the one used for the cached frames, the
+ * cache is not used.
+ *
+ * The frames that only contain samples of the signal are stored in
+ * updated_frame_cache, together with the still valid frames of the old cache.
+ */
+bool
+Encoder::encode_frames_cached (int optimization_level, bool track_sines)
+{
+  const size_t n_frames = audio_blocks.size();
+  const size_t fft_size = enc_params.block_size * enc_params.zeropad;
+
+  /* frame start in the source signal, or -1 if the frame contains zero padding */
+  auto frame_source_pos = [&] (size_t frame) -> int64 {
+    const size_t pos = frame * enc_params.frame_step;
+
+    if (pos < zero_values_at_start || pos + enc_params.frame_size > sample_count)
+      return -1;
+    return frame_cache_signal_start + int64 (pos - zero_values_at_start);
+  };
+
+  vector<const EncoderFrameCache::Frame *> cached (n_frames);
+  vector<double>                           frame_max_mag (n_frames);
+  vector<char>                             have_fft (n_frames);
+
+  for (size_t frame = 0; frame < n_frames; frame++)
+    {
+      const int64 pos = frame_source_pos (frame);
+
+      auto it = frame_cache->frames.find (pos);
+      if (pos >= 0 && it != frame_cache->frames.end())
+        {
+          cached[frame]        = &it->second;
+          frame_max_mag[frame] = it->second.max_mag;
+        }
+    }
+
+  auto compute_missing_ffts = [&]()
+    {
+      parallel_frames (n_frames, [&] (size_t start_frame, size_t end_frame)
+        {
+          float *fft_in = FFT::new_array_float (fft_size);
+          float *fft_out = FFT::new_array_float (fft_size);
+
+          for (size_t frame = start_frame; frame < end_frame; frame++)
+            {
+              if (!cached[frame] && !have_fft[frame])
+                {
+                  compute_frame_fft (frame, audio_blocks[frame], fft_in, fft_out);
+                  frame_max_mag[frame] = max_magnitude (audio_blocks[frame].noise);
+                  have_fft[frame] = true;
+                }
+            }
+          FFT::free_array_float (fft_in);
+          FFT::free_array_float (fft_out);
+        });
+    };
+  compute_missing_ffts();
+  profile_stage ("stft");
+  if (killed ("stft"))
+    return false;
+
+  double max_mag = 0;
+  for (auto m : frame_max_mag)
+    max_mag = max (max_mag, m);
+
+  const bool cache_valid = (max_mag == frame_cache->max_mag);
+  if (!cache_valid)
+    {
+      /* peak search thresholds depend on max_mag, so cached frames can't be used */
+      std::fill (cached.begin(), cached.end(), nullptr);
+
+      compute_missing_ffts();
+      profile_stage ("stft");
+      if (killed ("stft"))
+        return false;
+    }
+
+  if (track_sines)
+    {
+      frame_tracksels.clear();
+      frame_tracksels.resize (n_frames);
+
+      parallel_frames (n_frames, [&] (size_t start_frame, size_t end_frame)
+        {
+          for (size_t frame = start_frame; frame < end_frame; frame++)
+            {
+              if (!cached[frame])
+                search_frame_maxima (frame, audio_blocks[frame].noise, max_mag);
+            }
+        });
+      profile_stage ("maxima");
       if (killed ("maxima"))
         return false;
 
       link_partials();
-      if (killed ("link"))
-        return false;
+      profile_stage ("link");
 
       validate_partials();
+      profile_stage ("validate");
       if (killed ("validate"))
         return false;
 
-      optimize_partials (optimization_level);
+      frame_tracksels.clear();
+    }
+
+  parallel_frames (n_frames, [&] (size_t start_frame, size_t end_frame)
+    {
+      float *fft_in = FFT::new_array_float (fft_size);
+      float *fft_out = FFT::new_array_float (fft_size);
+      vector<float> block;
+
+      for (size_t frame = start_frame; frame < end_frame; frame++)
+        {
+          EncoderBlock& audio_block = audio_blocks[frame];
+
+          if (cached[frame])
+            {
+              audio_block = cached[frame]->block;
+
+              /* the attack optimization needs the samples of the first frames */
+              frame_samples (frame, block);
+              audio_block.debug_samples.assign (block.begin(), block.begin() + enc_params.frame_size);
+              continue;
+            }
+          if (track_sines)
+            {
+              if (optimization_level >= 1) // redo FFT estmates, only better
+                refine_sine_params (audio_block);
+
+              remove_small_partials (audio_block);
+              subtract_frame (frame, audio_block, fft_in, fft_out);
+            }
+          approx_frame_noise (frame, audio_block);
+
+          if (killed ("_frames", frame & 7))
+            break; // break to avoid leaking fft_in, fft_out
+        }
+      FFT::free_array_float (fft_in);
+      FFT::free_array_float (fft_out);
+    });
+  profile_stage ("frames"); // optimize, subtract and noise for frames not in cache
+  if (killed ("frames"))
+    return false;
+
+  updated_frame_cache = std::make_shared<EncoderFrameCache>();
+  updated_frame_cache->max_mag = max_mag;
+  if (cache_valid)
+    {
+      updated_frame_cache->frames              = frame_cache->frames;
+      updated_frame_cache->attack_signal_start = frame_cache->attack_signal_start;
+      updated_frame_cache->attack_start_ms     = frame_cache->attack_start_ms;
+      updated_frame_cache->attack_end_ms       = frame_cache->attack_end_ms;
+      updated_frame_cache->attack_scale        = frame_cache->attack_scale;
+    }
+
+  for (size_t frame = 0; frame < n_frames; frame++)
+    {
+      const int64 pos = frame_source_pos (frame);
+
+      if (pos >= 0 && !cached[frame])
+        {
+          EncoderFrameCache::Frame& cache_frame = updated_frame_cache->frames[pos];
+
+          cache_frame.max_mag = frame_max_mag[frame];
+          cache_frame.block   = audio_blocks[frame];
+          cache_frame.block.debug_samples = vector<float>();
+        }
+    }
+  return true;
+}
+
+/**
+ * This function checks whether all significant content of the signal is
+ * within a small part of the spectrum (which is typical for low notes).
+ * The level of spectral content that can be ignored is given by the
+ * "downsample-threshold" parameter (in dB, relative to the maximum).
+ *
+ * \returns the factor (1, 2, 4 or 8) by which the signal can be downsampled for sine analysis
+ */
+int
+Encoder::find_downsample_factor()
+{
+  double threshold_db;
+  if (!enc_params.get_param ("downsample-threshold", threshold_db))
+    return 1;
+
+  /* compute average energy for each frequency, using frames with 50% overlap */
+  const size_t block_size = enc_params.block_size;
+  const size_t step       = max<size_t> (enc_params.frame_size / 2, 1);
+
+  vector<double> bin_energy (block_size / 2 + 1);
+
+  float *fft_in = FFT::new_array_float (block_size);
+  float *fft_out = FFT::new_array_float (block_size);
+
+  for (size_t pos = 0; pos < analysis_signal.size(); pos += step)
+    {
+      for (size_t i = 0; i < block_size; i++)
+        fft_in[i] = pos + i < analysis_signal.size() ? analysis_signal[pos + i] * enc_params.window[i] : 0;
+
+      FFT::fftar_float (block_size, fft_in, fft_out);
+
+      bin_energy[0] += fft_out[0] * fft_out[0];
+      bin_energy[block_size / 2] += fft_out[1] * fft_out[1];
+      for (size_t d = 2; d < block_size; d += 2)
+        bin_energy[d / 2] += fft_out[d] * fft_out[d] + fft_out[d + 1] * fft_out[d + 1];
+    }
+  FFT::free_array_float (fft_in);
+  FFT::free_array_float (fft_out);
+
+  double max_energy = 0;
+  for (auto e : bin_energy)
+    max_energy = max (max_energy, e);
+
+  if (max_energy == 0)
+    return 1;
+
+  /* find highest frequency with significant energy */
+  const double threshold = max_energy * db_to_factor (threshold_db) * db_to_factor (threshold_db);
+
+  size_t max_bin = 0;
+  for (size_t b = 0; b < bin_energy.size(); b++)
+    {
+      if (bin_energy[b] > threshold)
+        max_bin = b;
+    }
+  const double max_freq = (max_bin + 1) * enc_params.mix_freq / block_size;
+
+  /* the halfband filter used for downsampling has a passband of about 0.4 * output sample rate */
+  int factor = 1;
+  while (factor < 8 && max_freq < 0.4 * enc_params.mix_freq / (factor * 2) && enc_params.frame_step % (factor * 2) == 0)
+    factor *= 2;
+
+  return factor;
+}
+
+/**
+ * This function downsamples a signal by factor (a power of two), so that sample k
+ * of the result corresponds to sample k * factor + offset of the input signal.
+ */
+static vector<float>
+downsample_signal (const vector<float>& signal, int factor, size_t offset)
+{
+  vector<std::unique_ptr<Resampler2>> stages;
+  for (int f = 1; f < factor; f *= 2)
+    stages.emplace_back (new Resampler2 (Resampler2::DOWN, 2, Resampler2::PREC_96DB));
+
+  /* each stage maps input sample 2 * (k - delay) to output sample k, so after all
+   * stages, input sample (factor * k - delay_in) corresponds to output sample k
+   */
+  const size_t delay_in = lrint (stages[0]->delay() * 2 * (factor - 1));
+
+  /* prepend zeros, so that the result can start at the right input sample */
+  const size_t skip = (delay_in + offset + factor - 1) / factor;
+  const size_t pad  = skip * factor - delay_in - offset;
+
+  const size_t out_len = skip + (signal.size() + offset) / factor + 2;
+
+  vector<float> in (out_len * factor);
+  std::copy (signal.begin(), signal.end(), in.begin() + pad);
+
+  for (auto& stage : stages)
+    {
+      vector<float> out (in.size() / 2);
+      stage->process_block (&in[0], in.size(), &out[0]);
+      in.swap (out);
+    }
+  return vector<float> (in.begin() + skip, in.end());
+}
+
+/**
+ * This function finds the partials using a downsampled version of the signal,
+ * which is a lot faster for band limited signals than analyzing the signal at
+ * the original sample rate. The frames are placed such that they have the same
+ * center as the frames at the original rate, so the resulting frequencies,
+ * magnitudes and phases can be used directly.
+ */
+bool
+Encoder::find_partials_downsampled (int optimization_level, int factor)
+{
+  EncoderParams sine_params = enc_params;
+
+  /* choose odd frame size for the downsampled signal, with frame center at full rate frame center */
+  const size_t frame_size = make_odd ((enc_params.frame_size - 1) / factor + 1);
+  const size_t offset     = (enc_params.frame_size - 1) / 2 - factor * (frame_size - 1) / 2;
+
+  sine_params.mix_freq   = enc_params.mix_freq / factor;
+  sine_params.frame_size = frame_size;
+  sine_params.frame_step = enc_params.frame_step / factor;
+  sine_params.keep_debug_data = false;
+
+  sine_params.block_size = 1;
+  while (sine_params.block_size < frame_size)
+    sine_params.block_size *= 2;
+
+  sine_params.window.assign (sine_params.block_size, 0);
+  for (size_t i = 0; i < frame_size; i++)
+    sine_params.window[i] = enc_params.window[i * factor + offset];
+
+  Encoder sine_encoder (sine_params);
+  sine_encoder.analysis_signal = downsample_signal (analysis_signal, factor, offset);
+  sine_encoder.audio_blocks.resize (audio_blocks.size());
+
+  if (enc_params.streaming)
+    {
+      if (!sine_encoder.track_peaks_streaming())
+        return false;
+
+      parallel_frames (audio_blocks.size(), [&] (size_t start_frame, size_t end_frame)
+        {
+          vector<float> block;
+
+          for (size_t frame = start_frame; frame < end_frame; frame++)
+            {
+              EncoderBlock& audio_block = sine_encoder.audio_blocks[frame];
+
+              sine_encoder.frame_samples (frame, block);
+              audio_block.debug_samples.assign (block.begin(), block.begin() + frame_size);
+
+              if (optimization_level >= 1) // redo FFT estmates, only better
+                sine_encoder.refine_sine_params (audio_block);
+
+              remove_small_partials (audio_block);
+              audio_block.debug_samples = vector<float>();
+
+              if (killed ("_optimize"))
+                return;
+            }
+        });
       if (killed ("optimize"))
         return false;
+    }
+  else
+    {
+      sine_encoder.compute_stft();
+      if (killed ("stft"))
+        return false;
 
-      spectral_subtract();
-      if (killed ("subtract"))
+      if (!sine_encoder.track_partials (optimization_level))
         return false;
     }
-  approx_noise();
-  if (killed ("noise"))
+
+  for (size_t frame = 0; frame < audio_blocks.size(); frame++)
+    {
+      audio_blocks[frame].freqs  = sine_encoder.audio_blocks[frame].freqs;
+      audio_blocks[frame].mags   = sine_encoder.audio_blocks[frame].mags;
+      audio_blocks[frame].phases = sine_encoder.audio_blocks[frame].phases;
+    }
+  debug ("sine analysis downsampled by factor %d\n", factor);
+  return true;
+}
+
+/**
+ * This function calls all steps necessary for encoding in the right order.
+ *
+ * \param dhandle a data handle containing the signal to be encoded
+ * \param optimization_level determines if fast (0), medium (1), or very slow (2) algorithm is used
+ * \param attack whether to find the optimal attack parameters
+ */
+bool
+Encoder::encode (const WavData& wav_data, int channel, int optimization_level,
+                 bool attack, bool track_sines)
+{
+  profile_start();
+
+  setup_signal (wav_data, channel);
+  profile_stage ("setup");
+
+  bool find_partials = true;
+  if (track_sines)
+    {
+      const int factor = find_downsample_factor();
+
+      if (factor > 1)
+        {
+          if (!find_partials_downsampled (optimization_level, factor))
+            return false;
+
+          find_partials = false;
+        }
+      profile_stage ("downsample");
+    }
+
+  /* the frame cache is only used for the common case (InstEncoder) */
+  const bool use_frame_cache = frame_cache && find_partials && !enc_params.streaming && !enc_params.keep_debug_data;
+
+  updated_frame_cache.reset();
+
+  bool ok;
+  if (use_frame_cache)
+    ok = encode_frames_cached (optimization_level, track_sines);
+  else if (enc_params.streaming)
+    ok = encode_frames_streaming (optimization_level, track_sines, find_partials);
+  else
+    ok = encode_frames (optimization_level, track_sines, find_partials);
+
+  analysis_signal = vector<float>(); // free memory
+  if (!ok)
     return false;
 
-  if (attack)
+  if (attack && !attack_from_frame_cache())
     compute_attack_params();
 
+  profile_stage ("attack");
   if (killed ("attack"))
     return false;
 
+  if (!enc_params.keep_debug_data)
+    {
+      for (auto& audio_block : audio_blocks)
+        audio_block.debug_samples = vector<float>();
+    }
+
   sort_freqs();
+  profile_stage ("sort");
   if (killed ("sort"))
     return false;
 
+  m_profile.total_ms = (get_time() - profile_start_time) * 1000;
   return true;
 }
 
+void
+Encoder::profile_start()
+{
+  m_profile = EncoderProfile();
+
+  profile_start_time = get_time();
+  profile_stage_time = profile_start_time;
+}
+
+/**
+ * This function records wall time and data size of one encoder stage, which
+ * started at the end of the previous stage. If the same stage runs more than
+ * once, the values are accumulated.
+ */
+void
+Encoder::profile_stage (const char *name)
+{
+  const double now = get_time();
+
+  size_t partials = 0;
+  size_t memory = (analysis_signal.capacity() + original_samples.capacity()) * sizeof (float);
+  for (const auto& block : audio_blocks)
+    {
+      partials += block.freqs.size();
+      memory += (block.noise.capacity() + block.freqs.capacity() + block.mags.capacity() + block.phases.capacity() +
+                 block.original_fft.capacity() + block.debug_samples.capacity()) * sizeof (float);
+    }
+  size_t peaks = 0;
+  for (const auto& tracksels : frame_tracksels)
+    {
+      peaks += tracksels.size();
+      memory += tracksels.capacity() * sizeof (Tracksel);
+    }
+
+  EncoderProfile::Stage *stage = nullptr;
+  for (auto& s : m_profile.stages)
+    if (s.name == name)
+      stage = &s;
+
+  if (!stage)
+    {
+      m_profile.stages.emplace_back();
+
+      stage = &m_profile.stages.back();
+      stage->name = name;
+    }
+  stage->time_ms += (now - profile_stage_time) * 1000;
+  stage->frames   = audio_blocks.size();
+  stage->peaks    = peaks;
+  stage->partials = partials;
+  stage->memory   = memory;
+
+  profile_stage_time = now;
+}
+
+/**
+ * \returns time and data size for each stage of the last encode() run
+ */
+const EncoderProfile&
+Encoder::profile() const
+{
+  return m_profile;
+}
+
+/**
+ * \returns the profile as JSON object, for instance for tracking encoder performance across releases
+ */
+string
+EncoderProfile::to_json() const
+{
+  string json = string_printf ("{\n  \"total_ms\": %.3f,\n  \"stages\": [", total_ms);
+  for (size_t i = 0; i < stages.size(); i++)
+    {
+      const Stage& stage = stages[i];
+
+      json += i ? ",\n" : "\n";
+      json += string_printf ("    { \"name\": \"%s\", \"time_ms\": %.3f, \"frames\": %zd, \"peaks\": %zd, \"partials\": %zd, \"memory\": %zd }",
+                             stage.name.c_str(), stage.time_ms, stage.frames, stage.peaks, stage.partials, stage.memory);
+    }
+  json += "\n  ]\n}";
+  return json;
+}
+
+/**
+ * Use analysis results of a previous encoder run for the same source signal
+ * (see EncoderFrameCache). An empty frame cache can be used for the first
+ * run. After encode(), get_frame_cache() returns the updated cache.
+ *
+ * \param signal_start position of the first sample of the encoded signal in the source signal
+ */
+void
+Encoder::set_frame_cache (const std::shared_ptr<const EncoderFrameCache>& new_frame_cache, int64 signal_start)
+{
+  frame_cache              = new_frame_cache;
+  frame_cache_signal_start = signal_start;
+}
+
+/**
+ * \returns the frame cache updated by encode(), or nullptr if no frame cache was used
+ */
+std::shared_ptr<EncoderFrameCache>
+Encoder::get_frame_cache() const
+{
+  return updated_frame_cache;
+}
+
 void
 Encoder::set_loop (Audio::LoopType loop_type, int loop_start, int loop_end)
 {
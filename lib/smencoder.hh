@@ -7,6 +7,8 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <functional>
+#include <memory>
 
 #include "smaudio.hh"
 #include "smwavdata.hh"
@@ -61,6 +63,16 @@ public:
   /** allow termination during encode() */
   std::function<bool()> kill_function;
 
+  /** maximum number of threads used to process frames in parallel (1: no threads) */
+  int     max_threads = 1;
+
+  /** process frames one at a time, to keep memory usage bounded for long inputs */
+  bool    streaming = false;
+
+  /** keep debug data (EncoderBlock::original_fft and EncoderBlock::debug_samples) in the result
+   *  (smenc disables this for streaming unless --keep-debug-data is given) */
+  bool    keep_debug_data = true;
+
   bool add_config_entry (const std::string& param, const std::string& value);
 
   bool load_config (const std::string& filename);
@@ -98,6 +110,53 @@ public:
   std::vector<float> debug_samples;  //!< original audio samples for this frame - for debugging only
 };
 
+/**
+ * \brief Wall time and data size of the encoder stages (see Encoder::profile())
+ */
+class EncoderProfile
+{
+public:
+  struct Stage
+  {
+    std::string name;         //!< stage name (stft, maxima, link, validate, optimize, subtract, noise, attack, sort, ...)
+    double      time_ms = 0;  //!< wall time used by this stage
+    size_t      frames = 0;   //!< number of frames
+    size_t      peaks = 0;    //!< number of spectral peaks after this stage
+    size_t      partials = 0; //!< number of partials after this stage
+    size_t      memory = 0;   //!< memory used by encoder data after this stage (in bytes)
+  };
+  std::vector<Stage> stages;
+  double             total_ms = 0; //!< wall time used by encode()
+
+  std::string to_json() const;
+};
+
+/**
+ * \brief Analysis results of individual frames, to speed up re-encoding
+ *
+ * If the same source signal is encoded again with different clip boundaries,
+ * frames that only contain samples from inside the clip range are the same as
+ * before (as long as the maximum magnitude of all frames doesn't change), so
+ * their analysis results can be reused. The cache must only be used with the
+ * same source signal, encoder parameters and encode() arguments.
+ */
+class EncoderFrameCache
+{
+public:
+  struct Frame
+  {
+    double       max_mag = 0;  //!< maximum magnitude of the frame spectrum
+    EncoderBlock block;        //!< frame analysis result (before attack optimization)
+  };
+  double                  max_mag = 0; //!< maximum magnitude of all frames, used for peak search
+  std::map<int64, Frame>  frames;      //!< frames, indexed by frame start position in the source signal
+
+  int64                   attack_signal_start = -1; //!< signal start used for attack optimization (-1: none)
+  double                  attack_start_ms = 0;      //!< optimal attack start
+  double                  attack_end_ms = 0;        //!< optimal attack end
+  std::vector<double>     attack_scale;             //!< magnitude scaling for the first frames
+};
+
 /**
  * \brief Encoder producing SpectMorph parametric data from sample data
  *
@@ -120,10 +179,46 @@ class Encoder
     double attack_start_ms;
     double attack_end_ms;
   };
-  double attack_error (const std::vector< std::vector<double> >& unscaled_signal, const Attack& attack, std::vector<double>& out_scale);
+  struct AttackSignal
+  {
+    std::vector< std::vector<double> > unscaled;   // sinusoidal reconstruction of each frame
+    std::vector< std::vector<double> > windowed;   // sinusoidal reconstruction multiplied with window
+    std::vector<double>                original;   // original signal
+    std::vector<double>                decoded;    // temporary buffer for decoded signal
+    std::vector<double>                tail_error; // error without attack envelope, from sample i to the end
+  };
+  double attack_error (AttackSignal& signal, const Attack& attack, std::vector<double>& out_scale);
+
+  struct RefineWindow
+  {
+    double             window_weight = 0; // sum of all window values
+    std::vector<float> folded_window;     // window folded around the frame center
+  };
+  RefineWindow refine_window;
+  void setup_refine_window();
+
+  void parallel_frames (size_t n_frames, const std::function<void (size_t, size_t)>& func);
+
+  // per frame steps:
+  void compute_frame_fft (size_t frame, EncoderBlock& audio_block, float *fft_in, float *fft_out);
+  void search_frame_maxima (size_t n, const std::vector<float>& spectrum, double max_mag);
+  void subtract_frame (size_t frame, EncoderBlock& audio_block, float *fft_in, float *fft_out);
+  void approx_frame_noise (size_t frame, EncoderBlock& audio_block);
+
+  void frame_samples (size_t frame, std::vector<float>& block);
+
+  bool track_partials (int optimization_level);
+  bool track_peaks_streaming();
+  bool encode_frames (int optimization_level, bool track_sines, bool find_partials);
+  bool encode_frames_streaming (int optimization_level, bool track_sines, bool find_partials);
+  bool encode_frames_cached (int optimization_level, bool track_sines);
+
+  int  find_downsample_factor();
+  bool find_partials_downsampled (int optimization_level, int factor);
 
   // single encoder steps:
-  void compute_stft (const WavData& wav_data, int channel);
+  void setup_signal (const WavData& wav_data, int channel);
+  void compute_stft();
   void search_local_maxima();
   void link_partials();
   void validate_partials();
@@ -131,8 +226,18 @@ class Encoder
   void spectral_subtract();
   void approx_noise();
   void compute_attack_params();
+  bool attack_in_frame_cache();
+  bool attack_from_frame_cache();
+  void attack_to_frame_cache (const std::vector<double>& scale);
   void sort_freqs();
 
+  EncoderProfile m_profile;
+  double         profile_start_time = 0;
+  double         profile_stage_time = 0;
+
+  void profile_start();
+  void profile_stage (const char *name);
+
   inline bool
   killed (const char *where, uint64_t z = 0)
   {
@@ -147,6 +252,11 @@ class Encoder
   Attack                               optimal_attack;
   size_t                               zero_values_at_start;
   size_t                               sample_count;
+  std::vector<float>                   analysis_signal; //!< channel to be encoded, including zero values at start
+
+  std::shared_ptr<const EncoderFrameCache> frame_cache;
+  std::shared_ptr<EncoderFrameCache>       updated_frame_cache;
+  int64                                    frame_cache_signal_start = 0;
 
 public:
   std::vector<EncoderBlock>            audio_blocks;    //!< current state, and end result of the encoding algorithm
@@ -156,10 +266,17 @@ public:
 
   void debug_decode (const std::string& filename);
 
+  void refine_sine_params (EncoderBlock& audio_block);
+
   // all-in-one encoding function:
   bool encode (const WavData& wav_data, int channel, int optimization_level,
                bool attack, bool track_sines);
 
+  void set_frame_cache (const std::shared_ptr<const EncoderFrameCache>& frame_cache, int64 signal_start);
+  std::shared_ptr<EncoderFrameCache> get_frame_cache() const;
+
+  const EncoderProfile& profile() const;
+
   void set_loop (Audio::LoopType loop_type, int loop_start, int loop_end);
   void set_loop_seconds (Audio::LoopType loop_type, double loop_start, double loop_end);
 
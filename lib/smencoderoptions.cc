@@ -0,0 +1,322 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smencoderoptions.hh"
+#include "smmath.hh"
+#include "smutils.hh"
+
+#include <math.h>
+#include <ctype.h>
+
+using namespace SpectMorph;
+
+using std::string;
+using std::vector;
+
+/**
+ * Parse encoder options. Arguments which are not options (like input and
+ * output filename) are returned in files.
+ *
+ * \returns true if all options could be parsed and are consistent, false otherwise (with error set)
+ */
+bool
+EncoderOptions::parse (const vector<string>& args, vector<string>& files, string& error)
+{
+  for (size_t i = 0; i < args.size(); i++)
+    {
+      string opt = args[i];
+      string opt_arg;
+      bool   have_arg = false;
+
+      /* --foo=bar */
+      size_t eq_pos = opt.find ('=');
+      if (opt.compare (0, 2, "--") == 0 && eq_pos != string::npos)
+        {
+          opt_arg  = opt.substr (eq_pos + 1);
+          opt      = opt.substr (0, eq_pos);
+          have_arg = true;
+        }
+      auto need_arg = [&]() -> bool {
+        if (!have_arg)
+          {
+            if (i + 1 >= args.size())
+              {
+                error = "option " + opt + " needs an argument";
+                return false;
+              }
+            opt_arg  = args[++i];
+            have_arg = true;
+          }
+        return true;
+      };
+
+      if (opt == "-f")
+        {
+          if (!need_arg())
+            return false;
+          fundamental_freq = sm_atof (opt_arg.c_str());
+        }
+      else if (opt == "-m")
+        {
+          if (!need_arg())
+            return false;
+          fundamental_freq = 440 * exp (log (2) * (atoi (opt_arg.c_str()) - 69) / 12.0);
+        }
+      else if (opt == "-O0" || opt == "-O1" || opt == "-O2")
+        {
+          optimization_level = opt[2] - '0';
+        }
+      else if (opt == "-O")
+        {
+          if (!need_arg())
+            return false;
+          optimization_level = atoi (opt_arg.c_str());
+        }
+      else if (opt == "-s")
+        {
+          strip_models = true;
+        }
+      else if (opt == "--keep-samples")
+        {
+          keep_samples = true;
+        }
+      else if (opt == "--no-attack")
+        {
+          attack = false;
+        }
+      else if (opt == "--no-sines")
+        {
+          track_sines = false;
+        }
+      else if (opt == "--loop-start")
+        {
+          if (!need_arg())
+            return false;
+          loop_start = sm_atof (opt_arg.c_str());
+        }
+      else if (opt == "--loop-end")
+        {
+          if (!need_arg())
+            return false;
+          loop_end = sm_atof (opt_arg.c_str());
+        }
+      else if (opt == "--loop-type")
+        {
+          if (!need_arg())
+            return false;
+          if (!Audio::string_to_loop_type (opt_arg, loop_type))
+            {
+              error = "unsupported loop type " + opt_arg;
+              return false;
+            }
+        }
+      else if (opt == "--loop-unit")
+        {
+          if (!need_arg())
+            return false;
+          if (opt_arg != "seconds")
+            {
+              error = "unsupported loop unit " + opt_arg;
+              return false;
+            }
+          loop_unit_seconds = true;
+        }
+      else if (opt == "--config")
+        {
+          if (!need_arg())
+            return false;
+          config_filename = opt_arg;
+        }
+      else if (opt == "-j")
+        {
+          if (!need_arg())
+            return false;
+          max_threads = atoi (opt_arg.c_str());
+        }
+      else if (opt == "--stream")
+        {
+          streaming = true;
+        }
+      else if (opt == "--keep-debug-data")
+        {
+          keep_debug_data = true;
+        }
+      else if (opt.size() > 1 && opt[0] == '-')
+        {
+          error = "unsupported option " + opt;
+          return false;
+        }
+      else
+        {
+          files.push_back (args[i]);
+        }
+    }
+  /* the encoder can't compute frame sizes without fundamental frequency */
+  if (fundamental_freq <= 0)
+    {
+      error = "need fundamental frequency (use -f or -m)";
+      return false;
+    }
+  if (loop_type != Audio::LOOP_NONE || loop_start != -1 || loop_end != -1)
+    {
+      if (loop_type == Audio::LOOP_NONE || loop_start < 0 || loop_end < loop_start)
+        {
+          error = "bad loop parameters (need --loop-type, --loop-start and --loop-end)";
+          return false;
+        }
+    }
+  return true;
+}
+
+/**
+ * Setup encoder parameters for wav_data: load config file, compute frame
+ * sizes and analysis window.
+ *
+ * \returns true on success, false otherwise (with error set)
+ */
+bool
+EncoderOptions::setup_params (EncoderParams& enc_params, const WavData& wav_data, string& error) const
+{
+  if (config_filename != "")
+    {
+      if (!enc_params.load_config (config_filename))
+        {
+          error = "can't open config file '" + config_filename + "'";
+          return false;
+        }
+    }
+  enc_params.setup_params (wav_data, fundamental_freq);
+  enc_params.max_threads = max_threads;
+  enc_params.streaming = streaming;
+
+  /* streaming mode should keep memory usage bounded, so debug data is only kept on request */
+  enc_params.keep_debug_data = !strip_models && (!streaming || keep_debug_data);
+
+  /* use defaults, but customize window */
+  string window_type;
+  if (!enc_params.get_param ("window", window_type))
+    window_type = "hann";
+
+  const size_t frame_size = enc_params.frame_size;
+  for (size_t i = 0; i < frame_size; i++)
+    {
+      const double x = 2.0 * i / (frame_size - 1) - 1.0;
+
+      if (window_type == "hann")
+        {
+          enc_params.window[i] = window_cos (x);
+        }
+      else if (window_type == "hamming")
+        {
+          /* probably never a good idea, since the sidelobes of the spectrum
+           * do not roll off fast (as with the hann window)
+           */
+          enc_params.window[i] = window_hamming (x);
+        }
+      else if (window_type == "blackman")
+        {
+          enc_params.window[i] = window_blackman (x);
+        }
+      else
+        {
+          error = "unsupported window type in config";
+          return false;
+        }
+    }
+  return true;
+}
+
+/**
+ * Apply options that affect the encoder result after encoding (strip models, loop).
+ */
+void
+EncoderOptions::finish (Encoder& encoder) const
+{
+  if (strip_models)
+    {
+      vector<EncoderBlock>& audio_blocks = encoder.audio_blocks;
+
+      for (size_t i = 0; i < audio_blocks.size(); i++)
+        {
+          audio_blocks[i].debug_samples.clear();
+          audio_blocks[i].original_fft.clear();
+        }
+      if (!keep_samples)
+        {
+          encoder.original_samples.clear();
+        }
+    }
+  if (loop_type != Audio::LOOP_NONE)
+    {
+      if (loop_unit_seconds)
+        encoder.set_loop_seconds (loop_type, loop_start, loop_end);
+      else
+        encoder.set_loop (loop_type, loop_start, loop_end);
+    }
+}
+
+/**
+ * Split command line options into words, double or single quotes can be used
+ * for words with spaces.
+ */
+vector<string>
+EncoderOptions::split_args (const string& args)
+{
+  vector<string> words;
+  string         word;
+  bool           have_word = false;
+  char           quote = 0;
+
+  for (auto c : args)
+    {
+      if (quote)
+        {
+          if (c == quote)
+            quote = 0;
+          else
+            word += c;
+        }
+      else if (c == '"' || c == '\'')
+        {
+          quote = c;
+          have_word = true;
+        }
+      else if (isspace (c))
+        {
+          if (have_word)
+            words.push_back (word);
+
+          word.clear();
+          have_word = false;
+        }
+      else
+        {
+          word += c;
+          have_word = true;
+        }
+    }
+  if (have_word)
+    words.push_back (word);
+
+  return words;
+}
+
+/**
+ * Replace %c in output filename pattern with channel (other % sequences are kept).
+ */
+string
+EncoderOptions::channel_filename (const string& pattern, int channel)
+{
+  string result;
+
+  for (size_t i = 0; i < pattern.size(); i++)
+    {
+      if (pattern[i] == '%' && i + 1 < pattern.size() && pattern[i + 1] == 'c')
+        {
+          result += string_printf ("%d", channel);
+          i++;
+        }
+      else
+        result += pattern[i];
+    }
+  return result;
+}
@@ -0,0 +1,45 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#ifndef SPECTMORPH_ENCODER_OPTIONS_HH
+#define SPECTMORPH_ENCODER_OPTIONS_HH
+
+#include "smencoder.hh"
+
+namespace SpectMorph
+{
+
+/**
+ * \brief Encoder command line options
+ *
+ * This struct contains the options that smenc (and BatchEncoder jobs) use to
+ * configure the encoder, and the code that applies them, so that both encode
+ * files in the same way.
+ */
+struct EncoderOptions
+{
+  double          fundamental_freq = 0;   // required (-f or -m)
+  int             optimization_level = 0;
+  bool            strip_models = false;
+  bool            keep_samples = false;
+  bool            attack = true;          // perform attack time optimization
+  bool            track_sines = true;     // perform peak tracking to find sine components
+  double          loop_start = -1;
+  double          loop_end = -1;
+  Audio::LoopType loop_type = Audio::LOOP_NONE;
+  bool            loop_unit_seconds = false;
+  std::string     config_filename;
+  int             max_threads = 1;
+  bool            streaming = false;
+  bool            keep_debug_data = false;
+
+  bool parse (const std::vector<std::string>& args, std::vector<std::string>& files, std::string& error);
+  bool setup_params (EncoderParams& enc_params, const WavData& wav_data, std::string& error) const;
+  void finish (Encoder& encoder) const;
+
+  static std::vector<std::string> split_args (const std::string& args);
+  static std::string channel_filename (const std::string& pattern, int channel);
+};
+
+}
+
+#endif
@@ -21,6 +21,8 @@
 #ifndef SPECTMORPH_FILTER_ENVELOPE_HH
 #define SPECTMORPH_FILTER_ENVELOPE_HH
 
+#include "smblockutils.hh"
+
 #include <algorithm>
 
 #include <assert.h>
@@ -266,6 +268,40 @@ public:
       }
     return level_;
   }
+  /* same as calling get_next() n_values times, but ramps are computed in closed form */
+  void
+  get_block (uint n_values, float *values)
+  {
+    uint i = 0;
+    while (i < n_values)
+      {
+        if (state_ == State::SUSTAIN || state_ == State::DONE)
+          {
+            std::fill (values + i, values + n_values, level_);
+            return;
+          }
+        const uint n = std::min<uint> (n_values - i, params_.len);
+
+        level_ = Block::exp_ramp (n, values + i, level_, params_.factor, params_.delta);
+        params_.len -= n;
+        i += n;
+
+        if (!params_.len)
+          {
+            level_ = params_.end;
+            values[i - 1] = level_;
+
+            if (state_ == State::RELEASE)
+              {
+                state_ = State::DONE;
+              }
+            else
+              {
+                next_state();
+              }
+          }
+      }
+  }
 };
 
 }
@@ -33,6 +33,8 @@ class IFFTSynth
 
   static std::vector<float> sin_table;
 
+  inline void render_freq256 (int freq256, float nmag, uint32_t iphase);
+
 public:
   enum WindowType { WIN_BLACKMAN_HARRIS_92, WIN_HANNING };
   enum OutputMode { REPLACE, ADD };
@@ -53,6 +55,8 @@ public:
   }
 
   inline void render_partial (double freq, double mag, double phase);
+  inline void render_partial_iphase (double freq, double mag, uint32_t iphase);
+  inline void render_partials_iphase (size_t n_partials, const double *freqs, double mag, const uint32_t *iphases);
   void get_samples (float *samples, OutputMode output_mode = REPLACE);
 
   double quantized_freq (double freq);
@@ -67,20 +71,45 @@ struct IFFTSynthTable
 
 inline void
 IFFTSynth::render_partial (double mf_freq, double mag, double phase)
+{
+  render_partial_iphase (mf_freq, mag, sm_phase2iphase (phase));
+}
+
+/* same as render_partial, but with fixed point phase (see sm_phase2iphase) */
+inline void
+IFFTSynth::render_partial_iphase (double mf_freq, double mag, uint32_t iphase)
+{
+  render_freq256 (sm_round_positive (mf_freq * freq256_factor), mag * mag_norm, iphase);
+}
+
+/* render n_partials with the same magnitude at once (for instance unison voices) */
+inline void
+IFFTSynth::render_partials_iphase (size_t n_partials, const double *freqs, double mag, const uint32_t *iphases)
+{
+  int freq256[n_partials];
+
+  for (size_t i = 0; i < n_partials; i++)
+    freq256[i] = sm_round_positive (freqs[i] * freq256_factor);
+
+  const float nmag = mag * mag_norm;
+  for (size_t i = 0; i < n_partials; i++)
+    render_freq256 (freq256[i], nmag, iphases[i]);
+}
+
+inline void
+IFFTSynth::render_freq256 (int freq256, float nmag, uint32_t iphase)
 {
   const int range = 4;
 
-  const int freq256 = sm_round_positive (mf_freq * freq256_factor);
   const int ibin = freq256 >> 8;
   float *sp = fft_in + 2 * (ibin - range);
   const float *wmag_p = &table->win_trans[(freq256 & 0xff) * (range * 2 + 1)];
 
-  const float nmag = mag * mag_norm;
-
   // rotation for initial phase; scaling for magnitude
 
   /* the following block computes sincos (phase + phase_adjust) */
-  int iarg = sm_round_positive (phase * (SIN_TABLE_SIZE / (2 * M_PI)));
+  static_assert (SIN_TABLE_SIZE == 1 << 12, "iphase conversion assumes 12 bit table index");
+  int iarg = uint32_t (iphase + (1 << 19)) >> 20; // rounded to table index
 
   // adjust phase to get the same output like vector sin (smmath.hh)
   // phase_adjust = freq256 * (M_PI / 256.0) - M_PI / 2;
@@ -2,6 +2,7 @@
 
 #include "sminfile.hh"
 #include <assert.h>
+#include <string.h>
 #include <glib.h>
 
 using std::string;
@@ -15,7 +16,9 @@ using SpectMorph::GenericIn;
  * \param filename name of the file
  */
 InFile::InFile (const string& filename) :
-  file_delete (true)
+  file_delete (true),
+  current_event_uint16_mem (nullptr),
+  current_event_uint16_size (0)
 {
   file = GenericIn::open (filename);
   current_event = NONE;
@@ -30,7 +33,9 @@ InFile::InFile (const string& filename) :
  */
 InFile::InFile (GenericIn *file) :
   file (file),
-  file_delete (false)
+  file_delete (false),
+  current_event_uint16_mem (nullptr),
+  current_event_uint16_size (0)
 {
   current_event = NONE;
   read_file_type_and_version();
@@ -314,6 +319,23 @@ InFile::read_raw_uint16_block (vector<uint16_t>& ib)
   if (!read_raw_int (size))
     return false;
 
+  current_event_uint16_mem = nullptr;
+  current_event_uint16_size = size;
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+  size_t remaining;
+  unsigned char *mem = file->mmap_mem (remaining);
+  if (mem) /* fast variant: don't copy, refer to the mmapped data instead */
+    {
+      if (!file->skip (size * 2))
+        return false;
+
+      ib.clear();
+      current_event_uint16_mem = mem;
+      return true;
+    }
+#endif
+
   ib.resize (size);
   if (size > 0)
     {
@@ -325,6 +347,7 @@ InFile::read_raw_uint16_block (vector<uint16_t>& ib)
         ib[x] = GUINT16_FROM_LE (ib[x]);
 #endif
     }
+  current_event_uint16_mem = reinterpret_cast<unsigned char *> (ib.data());
   return true;
 }
 
@@ -360,6 +383,25 @@ InFile::open_blob()
   return file->open_subfile (current_event_blob_pos, current_event_blob_size);
 }
 
+/**
+ * Get position of the blob data in the input file (only for BLOB events); this
+ * can be used to read the blob later without keeping the InFile open.
+ */
+size_t
+InFile::event_blob_pos()
+{
+  return current_event_blob_pos;
+}
+
+/**
+ * Get size of the blob data (only for BLOB events).
+ */
+size_t
+InFile::event_blob_size()
+{
+  return current_event_blob_size;
+}
+
 /**
  * Get name of the current event.
  *
@@ -434,9 +476,35 @@ InFile::event_float_block()
 const vector<uint16_t>&
 InFile::event_uint16_block()
 {
+  if (current_event_uint16_block.size() != current_event_uint16_size)
+    {
+      /* data is still in mmapped memory, copy it on demand */
+      current_event_uint16_block.resize (current_event_uint16_size);
+      if (current_event_uint16_size)
+        memcpy (&current_event_uint16_block[0], current_event_uint16_mem, current_event_uint16_size * 2);
+
+      current_event_uint16_mem = reinterpret_cast<unsigned char *> (current_event_uint16_block.data());
+    }
   return current_event_uint16_block;
 }
 
+/**
+ * Get uint16 block data of the current event (only if the event is UINT16_BLOCK)
+ * without copying it. For memory mapped input files, this points directly to the
+ * file data, so it may be unaligned; use memcpy() to access the values. The data
+ * is only valid until the next event is read.
+ *
+ * \param n_values is set to the number of uint16 values in the block
+ *
+ * \returns pointer to the little endian uint16 data (in host byte order)
+ */
+const unsigned char *
+InFile::event_uint16_block_mem (size_t& n_values)
+{
+  n_values = current_event_uint16_size;
+  return current_event_uint16_mem;
+}
+
 /**
  * Get blob's checksum.  This works for both: BLOB objects and BLOB_REF
  * objects.  During writing files, the first occurence of a BLOB is stored
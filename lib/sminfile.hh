@@ -52,6 +52,8 @@ protected:
   float                 current_event_float;
   std::vector<float>    current_event_float_block;
   std::vector<uint16_t> current_event_uint16_block;
+  const unsigned char  *current_event_uint16_mem;
+  size_t                current_event_uint16_size;
   size_t                current_event_blob_pos;
   size_t                current_event_blob_size;
   std::string           current_event_blob_sum;
@@ -94,6 +96,7 @@ public:
   std::string  event_data();
   const std::vector<float>&     event_float_block();
   const std::vector<uint16_t>&  event_uint16_block();
+  const unsigned char          *event_uint16_block_mem (size_t& n_values);
   std::string  event_blob_sum();
 
   void         next_event();
@@ -102,6 +105,8 @@ public:
   int          file_version();
 
   GenericIn   *open_blob();
+  size_t       event_blob_pos();
+  size_t       event_blob_size();
 };
 
 }
@@ -14,6 +14,7 @@
 #include <regex>
 
 #include <assert.h>
+#include <string.h>
 #include <unistd.h>
 #include <glib/gstdio.h>
 #include <utime.h>
@@ -44,12 +45,124 @@ InstEncCache::CacheData::~CacheData()
   leak_debugger.del (this);
 }
 
+const unsigned char *
+InstEncCache::CacheData::data_ptr() const
+{
+  return mapped_file ? mapped_data : data.data();
+}
+
+size_t
+InstEncCache::CacheData::data_size() const
+{
+  return mapped_file ? mapped_size : data.size();
+}
+
+void
+InstEncCache::CacheData::set_data (vector<unsigned char>&& new_data)
+{
+  data        = std::move (new_data);
+  mapped_file = nullptr;
+  mapped_data = nullptr;
+  mapped_size = 0;
+}
+
+static string
+fast_checksum (const unsigned char *data, size_t size)
+{
+  /* 64-bit FNV-1a variant processing 8 bytes per step; this is a lot cheaper than
+   * sha1, and good enough to detect damaged cache files (which are only used on
+   * the machine that created them, so we don't care about endianness here)
+   */
+  const uint64 prime = 1099511628211ULL;
+  uint64       hash  = 14695981039346656037ULL;
+  size_t       i     = 0;
+
+  for (; i + 8 <= size; i += 8)
+    {
+      uint64 word;
+      memcpy (&word, data + i, 8);
+
+      hash = (hash ^ word) * prime;
+      hash ^= hash >> 32;
+    }
+  for (; i < size; i++)
+    hash = (hash ^ data[i]) * prime;
+
+  return string_printf ("fnv64:%016" PRIx64, hash);
+}
+
+static bool
+check_data_hash (const unsigned char *data, size_t size, const string& data_hash)
+{
+  /* older cache files use sha1 */
+  if (data_hash.compare (0, 6, "fnv64:") == 0)
+    return fast_checksum (data, size) == data_hash;
+  else
+    return sha1_hash (data, size) == data_hash;
+}
+
 InstEncCache::InstEncCache() :
   cache_file_re ("inst_enc_[0-9a-f]{8}_[0-9a-f]{8}_[0-9]+_[0-9a-f]{40}$")
 {
+#ifdef SM_OS_WINDOWS
+  /* files can not be deleted while they are mapped on windows */
+  cache_mapped = false;
+#endif
+
+  /* if the index is not available, we fall back to scanning the cache directory */
+  cache_index.open (cache_filename ("inst_enc_index"), [this]() { return scan_cache_files(); });
+
   delete_old_files();
 }
 
+bool
+InstEncCache::is_cache_file (const string& filename)
+{
+  /* using a regexp here avoids deleting unrelated files; even if something is
+   * misconfigured this should make calling unlink() relatively safe */
+  return regex_search (filename, cache_file_re);
+}
+
+/* list cache files (sorted by mtime, oldest first) to build the cache index */
+vector<InstEncIndex::Entry>
+InstEncCache::scan_cache_files()
+{
+  struct FileEntry
+  {
+    InstEncIndex::Entry entry;
+    uint64              mtime = 0;
+  };
+  vector<FileEntry> file_entries;
+  vector<string>    files;
+
+  Error error = read_dir (sm_get_user_dir (USER_DIR_CACHE), files);
+  for (auto filename : files)
+    {
+      GStatBuf stbuf;
+      if (is_cache_file (filename) && g_stat (cache_filename (filename).c_str(), &stbuf) == 0)
+        {
+          /* filename is <key>_<version>, version is a 40 char sha1 hash */
+          FileEntry fe;
+          fe.entry.key     = filename.substr (0, filename.size() - 41);
+          fe.entry.version = filename.substr (filename.size() - 40);
+          fe.entry.size    = stbuf.st_size;
+          fe.mtime         = stbuf.st_mtime;
+          file_entries.push_back (fe);
+        }
+    }
+  std::sort (file_entries.begin(), file_entries.end(),
+    [](const FileEntry& fe1, const FileEntry& fe2)
+      {
+        return fe1.mtime < fe2.mtime;
+      });
+
+  vector<InstEncIndex::Entry> entries;
+  for (const auto& fe : file_entries)
+    entries.push_back (fe.entry);
+
+  return entries;
+}
+
 InstEncCache*
 InstEncCache::the()
 {
@@ -65,33 +178,68 @@ InstEncCache::cache_save_L (const string& key)
 
   buffer.write_start ("SpectMorphCache");
   buffer.write_string (cache_data.version.c_str());
-  buffer.write_int (cache_data.data.size());
-  buffer.write_string (sha1_hash (&cache_data.data[0], cache_data.data.size()).c_str());
+  buffer.write_int (cache_data.data_size());
+  buffer.write_string (fast_checksum (cache_data.data_ptr(), cache_data.data_size()).c_str());
   buffer.write_end();
 
-  vector<string> files;
-  Error error = read_dir (sm_get_user_dir (USER_DIR_CACHE), files);
-  for (auto filename : files)
+  /* the cache file may be mapped by other instances/processes (see set_mapped), so it must
+   * not be truncated: write a new file and atomically replace the old file with it
+   *
+   * the temporary filename doesn't match cache_file_re, so it is never used as cache file
+   */
+  const string out_filename = cache_filename (key) + "_" + cache_data.version;
+  const string tmp_filename = string_printf ("%s.new.%d", out_filename.c_str(), getpid());
+
+  FILE *outf = fopen (tmp_filename.c_str(), "wb");
+  if (!outf)
+    return;
+
+  for (auto ch : buffer.to_string())
+    fputc (ch, outf);
+  fputc (0, outf);
+  fwrite (cache_data.data_ptr(), 1, cache_data.data_size(), outf);
+
+  InstEncIndex::Entry entry;
+  entry.key     = key;
+  entry.version = cache_data.version;
+  entry.size    = ftell (outf);
+
+  bool write_ok = !ferror (outf);
+  if (fclose (outf) != 0)
+    write_ok = false;
+
+  if (!write_ok || g_rename (tmp_filename.c_str(), out_filename.c_str()) != 0)
+    {
+      unlink (tmp_filename.c_str());
+      return;
+    }
+
+  /* only remove old versions after the new version is in place */
+  if (cache_index.is_open())
     {
-      if (regex_search (filename, cache_file_re)) /* avoid unlink on something that we shouldn't delete */
+      /* index knows older versions for the same key, which are no longer needed */
+      for (const auto& old_entry : cache_index.insert (entry))
         {
-          if (filename.size() > key.size() && filename.compare (0, key.size(), key) == 0)
-            {
-              unlink (cache_filename (filename).c_str());
-            }
+          string old_filename = old_entry.key + "_" + old_entry.version;
+          if (is_cache_file (old_filename))
+            unlink (cache_filename (old_filename).c_str());
         }
     }
-
-  string out_filename = cache_filename (key) + "_" + cache_data.version;
-  FILE *outf = fopen (out_filename.c_str(), "wb");
-  if (outf)
+  else
     {
-      for (auto ch : buffer.to_string())
-        fputc (ch, outf);
-      fputc (0, outf);
-      const unsigned char *ptr = cache_data.data.data();
-      fwrite (ptr, 1, cache_data.data.size(), outf);
-      fclose (outf);
+      vector<string> files;
+      Error error = read_dir (sm_get_user_dir (USER_DIR_CACHE), files);
+      for (auto filename : files)
+        {
+          if (is_cache_file (filename)) /* avoid unlink on something that we shouldn't delete */
+            {
+              if (filename.size() > key.size() && filename.compare (0, key.size(), key) == 0 &&
+                  cache_filename (filename) != out_filename)
+                {
+                  unlink (cache_filename (filename).c_str());
+                }
+            }
+        }
     }
 }
 
@@ -110,18 +258,32 @@ InstEncCache::cache_try_load_L (const string& cache_key, const string& need_vers
   GenericIn *in_file = nullptr;
   string     abs_filename;
 
-  vector<string> files;
-  Error error = read_dir (sm_get_user_dir (USER_DIR_CACHE), files);
-  for (auto filename : files)
+  if (cache_index.is_open())
     {
-      if (regex_search (filename, cache_file_re))
+      string key;
+      if (cache_index.lookup (need_version, key))
         {
-          if (ends_with (filename, need_version))
+          abs_filename = cache_filename (key + "_" + need_version);
+          in_file = GenericIn::open (abs_filename);
+          if (!in_file) // file was removed without updating the index
+            cache_index.remove (need_version);
+        }
+    }
+  else
+    {
+      vector<string> files;
+      Error error = read_dir (sm_get_user_dir (USER_DIR_CACHE), files);
+      for (auto filename : files)
+        {
+          if (is_cache_file (filename))
             {
-              abs_filename = cache_filename (filename);
-              in_file = GenericIn::open (abs_filename);
-              if (in_file)
-                break;
+              if (ends_with (filename, need_version))
+                {
+                  abs_filename = cache_filename (filename);
+                  in_file = GenericIn::open (abs_filename);
+                  if (in_file)
+                    break;
+                }
             }
         }
     }
@@ -145,25 +307,67 @@ InstEncCache::cache_try_load_L (const string& cache_key, const string& need_vers
 
   if (version == need_version)
     {
-      vector<unsigned char> data (data_size);
-      if (in_file->read (&data[0], data.size()) == data_size)
+      size_t               remaining = 0;
+      const unsigned char *mem = cache_mapped ? in_file->mmap_mem (remaining) : nullptr;
+      bool                 load_ok = false;
+
+      if (mem && data_size >= 0 && remaining >= size_t (data_size))
         {
-          string load_data_hash = sha1_hash (&data[0], data.size());
-          if (load_data_hash == data_hash)
+          /* mapped: keep file mapping and use the data without copying */
+          if (check_data_hash (mem, data_size, data_hash))
+            {
+              CacheData& cache_data = cache[cache_key];
+
+              cache_data.set_data ({});
+              cache_data.version     = version;
+              cache_data.mapped_file = std::shared_ptr<GenericIn> (in_file);
+              cache_data.mapped_data = mem;
+              cache_data.mapped_size = data_size;
+
+              in_file = nullptr;
+              load_ok = true;
+            }
+        }
+      else
+        {
+          vector<unsigned char> data (data_size);
+          if (in_file->read (&data[0], data.size()) == data_size && check_data_hash (&data[0], data.size(), data_hash))
             {
               cache[cache_key].version = version;
-              cache[cache_key].data    = std::move (data);
+              cache[cache_key].set_data (std::move (data));
 
-              /* bump mtime on successful load; this information is used during
-               * InstEncCache::delete_old_files() to remove the oldest cache files
-               */
-              g_utime (abs_filename.c_str(), nullptr);
+              load_ok = true;
             }
         }
+      if (load_ok)
+        {
+          /* bump mtime on successful load; this information is used during
+           * InstEncCache::delete_old_files() to remove the oldest cache files
+           */
+          g_utime (abs_filename.c_str(), nullptr);
+        }
     }
   delete in_file;
 }
 
+static string
+mk_frame_cache_version (const string& wav_data_hash, int midi_note, Instrument::EncoderConfig& cfg)
+{
+  /* like mk_version, but independent of the clip range */
+  string depends;
+
+  depends += wav_data_hash + "\n";
+  depends += string_printf ("%s\n", PACKAGE_VERSION);
+  depends += string_printf ("%d\n", midi_note);
+  if (cfg.enabled)
+    {
+      for (auto entry : cfg.entries)
+        depends += entry.param + "=" + entry.value + "\n";
+    }
+
+  return sha1_hash (depends);
+}
+
 static string
 mk_version (const string& wav_data_hash, int midi_note, int iclipstart, int iclipend, Instrument::EncoderConfig& cfg)
 {
@@ -219,11 +423,21 @@ InstEncCache::encode (Group *group, const WavData& wav_data, const string& wav_d
 
   WavData wav_data_clipped (clipped_samples, 1, wav_data.mix_freq(), wav_data.bit_depth());
 
+  /* if only the clip range changed since the last encode, most frames can be taken from the frame cache */
+  string frame_cache_version = mk_frame_cache_version (wav_data_hash, midi_note, cfg);
+  auto   frames = frame_cache_lookup (cache_key, frame_cache_version);
+  if (!frames)
+    frames = std::make_shared<EncoderFrameCache>();
+
   InstEncoder enc;
+  enc.set_frame_cache (frames, iclipstart);
   audio = enc.encode (wav_data_clipped, midi_note, cfg, kill_function);
   if (!audio)
     return nullptr;
 
+  if (enc.get_frame_cache())
+    frame_cache_add (cache_key, frame_cache_version, enc.get_frame_cache());
+
   cache_add (cache_key, version, audio);
 
   return audio;
@@ -239,10 +453,11 @@ InstEncCache::cache_lookup (const string& cache_key, const string& version)
     }
   if (cache[cache_key].version == version) // cache hit (in memory)
     {
-      vector<unsigned char>& data = cache[cache_key].data;
-      cache[cache_key].read_stamp = cache_read_stamp++;
+      CacheData& cache_data = cache[cache_key];
+      cache_data.read_stamp = cache_read_stamp++;
 
-      GenericIn *in = MMapIn::open_mem (&data[0], &data[data.size()]);
+      unsigned char *data = const_cast<unsigned char *> (cache_data.data_ptr());
+      GenericIn     *in = MMapIn::open_mem (data, data + cache_data.data_size());
       Audio     *audio = new Audio;
       Error      error = audio->load (in);
 
@@ -268,7 +483,7 @@ InstEncCache::cache_add (const string& cache_key, const string& version, const A
   std::lock_guard<std::mutex> lg (cache_mutex);
 
   cache[cache_key].version    = version;
-  cache[cache_key].data       = data;
+  cache[cache_key].set_data (std::move (data));
   cache[cache_key].read_stamp = cache_read_stamp++;
 
   cache_save_L (cache_key);
@@ -281,12 +496,64 @@ InstEncCache::cache_add (const string& cache_key, const string& version, const A
     }
 }
 
+std::shared_ptr<const EncoderFrameCache>
+InstEncCache::frame_cache_lookup (const string& cache_key, const string& version)
+{
+  std::lock_guard<std::mutex> lg (cache_mutex);
+
+  auto it = frame_cache.find (cache_key);
+  if (it == frame_cache.end() || it->second.version != version)
+    return nullptr;
+
+  it->second.read_stamp = cache_read_stamp++;
+  return it->second.frames;
+}
+
+void
+InstEncCache::frame_cache_add (const string& cache_key, const string& version, const std::shared_ptr<const EncoderFrameCache>& frames)
+{
+  std::lock_guard<std::mutex> lg (cache_mutex);
+
+  FrameCacheEntry& entry = frame_cache[cache_key];
+  entry.version    = version;
+  entry.frames     = frames;
+  entry.read_stamp = cache_read_stamp++;
+
+  /* frame data is only useful while the user is editing a sample, so we keep
+   * only a few entries (the ones that were used most recently)
+   */
+  const size_t max_entries = 16;
+  while (frame_cache.size() > max_entries)
+    {
+      auto oldest = frame_cache.begin();
+      for (auto fi = frame_cache.begin(); fi != frame_cache.end(); fi++)
+        {
+          if (fi->second.read_stamp < oldest->second.read_stamp)
+            oldest = fi;
+        }
+      frame_cache.erase (oldest);
+    }
+}
+
 void
 InstEncCache::clear()
 {
   std::lock_guard<std::mutex> lg (cache_mutex);
 
   cache.clear();
+  frame_cache.clear();
+}
+
+/**
+ * Enable or disable mapped mode (default: enabled). In mapped mode, cache files
+ * loaded from disk are kept memory mapped instead of being copied to memory.
+ */
+void
+InstEncCache::set_mapped (bool mapped)
+{
+  std::lock_guard<std::mutex> lg (cache_mutex);
+
+  cache_mapped = mapped;
 }
 
 InstEncCache::Group *
@@ -301,6 +568,19 @@ InstEncCache::create_group()
 void
 InstEncCache::delete_old_files()
 {
+  const size_t max_total_size = 100 * 1000 * 1000; // 100 MB total cache size
+
+  if (cache_index.is_open())
+    {
+      for (const auto& entry : cache_index.prune (max_total_size))
+        {
+          string filename = entry.key + "_" + entry.version;
+          if (is_cache_file (filename))
+            unlink (cache_filename (filename).c_str());
+        }
+      return;
+    }
+
   struct Status
   {
     string abs_filename;
@@ -333,13 +613,10 @@ InstEncCache::delete_old_files()
         return st1.mtime > st2.mtime;
       });
 
-  const size_t max_total_size = 100 * 1000 * 1000; // 100 MB total cache size
   size_t total_size = 0;
   for (auto status : file_status)
     {
-      /* using a regexp here avoids deleting unrelated files; even if something is
-       * misconfigured this should make calling unlink() relatively safe */
-      if (regex_search (status.abs_filename, cache_file_re))
+      if (is_cache_file (status.abs_filename))
         {
           total_size += status.size;
           if (total_size > max_total_size)
@@ -367,7 +644,7 @@ InstEncCache::delete_old_memory_L()
 
       Status status;
       status.key        = key;
-      status.size       = cache_data.data.size();
+      status.size       = cache_data.data_size();
       status.read_stamp = cache_data.read_stamp;
 
       mem_status.push_back (status);
@@ -6,6 +6,7 @@
 #include "smwavdata.hh"
 #include "smencoder.hh"
 #include "sminstrument.hh"
+#include "sminstencindex.hh"
 
 #include <mutex>
 #include <regex>
@@ -19,23 +20,47 @@ class InstEncCache
   {
     std::string                version;
     std::vector<unsigned char> data;
+    std::shared_ptr<GenericIn> mapped_file;         // mapped cache file (data is empty in this case)
+    const unsigned char       *mapped_data = nullptr;
+    size_t                     mapped_size = 0;
     uint64                     read_stamp = 0;
 
     CacheData();
     ~CacheData();
+
+    const unsigned char *data_ptr() const;
+    size_t               data_size() const;
+    void                 set_data (std::vector<unsigned char>&& new_data);
   };
 
   std::map<std::string, CacheData> cache;
+
+  /* in memory cache for frame analysis results, to re-encode quickly if only the clip range changes */
+  struct FrameCacheEntry
+  {
+    std::string                              version;  // same as CacheData version, but without clip range
+    std::shared_ptr<const EncoderFrameCache> frames;
+    uint64                                   read_stamp = 0;
+  };
+  std::map<std::string, FrameCacheEntry> frame_cache;
   std::mutex                       cache_mutex;
   const std::regex                 cache_file_re;
   uint64                           cache_read_stamp = 0;
+  InstEncIndex                     cache_index;
+  bool                             cache_mapped = true;
 
   void        cache_save_L (const std::string& key);
   void        cache_try_load_L (const std::string& key, const std::string& need_version);
   Audio      *cache_lookup (const std::string& cache_key, const std::string& version);
   void        cache_add (const std::string& cache_key, const std::string& version, const Audio *audio);
 
+  std::shared_ptr<const EncoderFrameCache> frame_cache_lookup (const std::string& cache_key, const std::string& version);
+  void        frame_cache_add (const std::string& cache_key, const std::string& version,
+                               const std::shared_ptr<const EncoderFrameCache>& frames);
+
   void        delete_old_files();
+  bool        is_cache_file (const std::string& filename);
+  std::vector<InstEncIndex::Entry> scan_cache_files();
   void        delete_old_memory_L();
 
 public:
@@ -50,6 +75,7 @@ public:
                       const std::function<bool()>& kill_function);
   void        clear();
   Group      *create_group();
+  void        set_mapped (bool mapped);
 
   InstEncCache();
 
@@ -0,0 +1,556 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "sminstencindex.hh"
+
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+
+#ifndef SM_OS_WINDOWS
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#endif
+
+using namespace SpectMorph;
+
+using std::string;
+using std::vector;
+
+namespace
+{
+
+constexpr char   INDEX_MAGIC[16]  = "SpectMorphIdx01";
+constexpr uint32 MIN_SLOTS        = 1024;
+
+enum { SLOT_EMPTY = 0, SLOT_USED = 1, SLOT_DELETED = 2 };
+
+uint32
+string_hash (const string& str)
+{
+  /* FNV-1a */
+  uint32 hash = 2166136261u;
+  for (unsigned char ch : str)
+    {
+      hash ^= ch;
+      hash *= 16777619u;
+    }
+  return hash;
+}
+
+}
+
+struct InstEncIndex::Header
+{
+  char    magic[16];
+  uint32  n_slots;      // always a power of two
+  uint32  n_used;
+  uint32  n_deleted;
+  uint32  dirty;        // set during updates, index needs to be rebuilt if this is set on open
+  uint64  total_size;   // sum of all entry sizes
+  int32_t lru_head;     // most recently used entry
+  int32_t lru_tail;     // least recently used entry
+};
+
+struct InstEncIndex::Slot
+{
+  uint32  state;
+  int32_t lru_prev;
+  int32_t lru_next;
+  uint32  reserved;
+  uint64  size;
+  char    key[56];
+  char    version[56];
+};
+
+/* locks index file, so that multiple processes can use the index */
+class InstEncIndex::Lock
+{
+  int fd;
+public:
+  Lock (int fd) :
+    fd (fd)
+  {
+#ifndef SM_OS_WINDOWS
+    while (flock (fd, LOCK_EX) != 0 && errno == EINTR)
+      ;
+#endif
+  }
+  ~Lock()
+  {
+#ifndef SM_OS_WINDOWS
+    flock (fd, LOCK_UN);
+#endif
+  }
+};
+
+InstEncIndex::InstEncIndex()
+{
+}
+
+InstEncIndex::~InstEncIndex()
+{
+  close();
+}
+
+InstEncIndex::Header *
+InstEncIndex::header()
+{
+  return reinterpret_cast<Header *> (map_mem);
+}
+
+InstEncIndex::Slot *
+InstEncIndex::slot (int index)
+{
+  return reinterpret_cast<Slot *> (map_mem + sizeof (Header)) + index;
+}
+
+bool
+InstEncIndex::map_file()
+{
+#ifndef SM_OS_WINDOWS
+  struct stat st;
+  if (fstat (fd, &st) != 0 || size_t (st.st_size) < sizeof (Header))
+    return false;
+
+  void *mem = mmap (nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mem == MAP_FAILED)
+    return false;
+
+  map_mem  = static_cast<unsigned char *> (mem);
+  map_size = st.st_size;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void
+InstEncIndex::unmap_file()
+{
+#ifndef SM_OS_WINDOWS
+  if (map_mem)
+    munmap (map_mem, map_size);
+#endif
+  map_mem  = nullptr;
+  map_size = 0;
+}
+
+/* other processes may have resized the index file: update our mapping if necessary */
+bool
+InstEncIndex::sync_map()
+{
+#ifndef SM_OS_WINDOWS
+  struct stat st;
+  if (fstat (fd, &st) != 0)
+    return false;
+
+  if (map_mem && size_t (st.st_size) == map_size)
+    return true;
+
+  unmap_file();
+  return map_file();
+#else
+  return false;
+#endif
+}
+
+bool
+InstEncIndex::valid()
+{
+  if (!map_mem || map_size < sizeof (Header))
+    return false;
+
+  const Header *h = header();
+  if (memcmp (h->magic, INDEX_MAGIC, sizeof (INDEX_MAGIC)) != 0 || h->dirty)
+    return false;
+
+  if (h->n_slots < MIN_SLOTS || (h->n_slots & (h->n_slots - 1)) != 0)
+    return false;
+
+  return map_size == sizeof (Header) + h->n_slots * sizeof (Slot);
+}
+
+bool
+InstEncIndex::init_table (uint32 n_slots, const vector<Entry>& entries)
+{
+#ifndef SM_OS_WINDOWS
+  unmap_file();
+
+  /* truncating to zero first ensures all slots are cleared */
+  const size_t new_size = sizeof (Header) + n_slots * sizeof (Slot);
+  if (ftruncate (fd, 0) != 0 || ftruncate (fd, new_size) != 0)
+    return false;
+
+  if (!map_file())
+    return false;
+
+  Header *h = header();
+  memcpy (h->magic, INDEX_MAGIC, sizeof (INDEX_MAGIC));
+  h->n_slots  = n_slots;
+  h->lru_head = -1;
+  h->lru_tail = -1;
+  h->dirty    = 1;
+
+  /* entries are sorted from least recently used to most recently used */
+  for (const auto& entry : entries)
+    {
+      if (find_slot (entry.version) < 0)
+        insert_slot (entry);
+    }
+  h->dirty = 0;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void
+InstEncIndex::rehash (uint32 n_slots)
+{
+  vector<Entry> entries;
+
+  for (int i = header()->lru_tail; i >= 0; i = slot (i)->lru_prev)
+    entries.push_back (slot_entry (i));
+
+  if (!init_table (n_slots, entries))
+    close();
+}
+
+int
+InstEncIndex::find_slot (const string& version)
+{
+  const uint32 mask = header()->n_slots - 1;
+
+  for (uint32 i = string_hash (version) & mask; slot (i)->state != SLOT_EMPTY; i = (i + 1) & mask)
+    {
+      Slot *s = slot (i);
+
+      if (s->state == SLOT_USED && version == s->version)
+        return i;
+    }
+  return -1;
+}
+
+void
+InstEncIndex::insert_slot (const Entry& entry)
+{
+  Header *h = header();
+  const uint32 mask = h->n_slots - 1;
+
+  uint32 i = string_hash (entry.version) & mask;
+  while (slot (i)->state == SLOT_USED)
+    i = (i + 1) & mask;
+
+  Slot *s = slot (i);
+  if (s->state == SLOT_DELETED)
+    h->n_deleted--;
+
+  s->state = SLOT_USED;
+  s->size  = entry.size;
+  strncpy (s->key, entry.key.c_str(), sizeof (s->key));
+  strncpy (s->version, entry.version.c_str(), sizeof (s->version));
+
+  h->n_used++;
+  h->total_size += entry.size;
+  lru_push_front (i);
+}
+
+void
+InstEncIndex::remove_slot (int index)
+{
+  Header *h = header();
+  Slot   *s = slot (index);
+
+  lru_unlink (index);
+  h->total_size -= s->size;
+  h->n_used--;
+  h->n_deleted++;
+
+  s->state = SLOT_DELETED;
+}
+
+void
+InstEncIndex::lru_unlink (int index)
+{
+  Header *h = header();
+  Slot   *s = slot (index);
+
+  if (s->lru_prev >= 0)
+    slot (s->lru_prev)->lru_next = s->lru_next;
+  else
+    h->lru_head = s->lru_next;
+
+  if (s->lru_next >= 0)
+    slot (s->lru_next)->lru_prev = s->lru_prev;
+  else
+    h->lru_tail = s->lru_prev;
+
+  s->lru_prev = -1;
+  s->lru_next = -1;
+}
+
+void
+InstEncIndex::lru_push_front (int index)
+{
+  Header *h = header();
+  Slot   *s = slot (index);
+
+  s->lru_prev = -1;
+  s->lru_next = h->lru_head;
+
+  if (h->lru_head >= 0)
+    slot (h->lru_head)->lru_prev = index;
+  else
+    h->lru_tail = index;
+
+  h->lru_head = index;
+}
+
+InstEncIndex::Entry
+InstEncIndex::slot_entry (int index)
+{
+  const Slot *s = slot (index);
+
+  Entry entry;
+  entry.key     = string (s->key, strnlen (s->key, sizeof (s->key)));
+  entry.version = string (s->version, strnlen (s->version, sizeof (s->version)));
+  entry.size    = s->size;
+  return entry;
+}
+
+/**
+ * Open (or create) index file. If the index file is new or damaged (for instance
+ * if a process crashed while updating it), the index is rebuilt from the list of
+ * entries returned by scan_files, which should be sorted from least recently used
+ * to most recently used.
+ *
+ * \returns true if the index could be opened
+ */
+bool
+InstEncIndex::open (const string& filename, const std::function<vector<Entry>()>& scan_files)
+{
+#ifndef SM_OS_WINDOWS
+  close();
+
+  fd = ::open (filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return false;
+
+  bool ok;
+  {
+    Lock lock (fd);
+
+    sync_map();
+    ok = valid();
+    if (!ok)
+      {
+        vector<Entry> entries = scan_files();
+        uint32        n_slots = MIN_SLOTS;
+
+        while (entries.size() * 2 > n_slots)
+          n_slots *= 2;
+
+        ok = init_table (n_slots, entries);
+      }
+  }
+  if (!ok)
+    close();
+
+  return ok;
+#else
+  return false;
+#endif
+}
+
+void
+InstEncIndex::close()
+{
+  unmap_file();
+
+#ifndef SM_OS_WINDOWS
+  if (fd >= 0)
+    ::close (fd);
+#endif
+  fd = -1;
+}
+
+bool
+InstEncIndex::is_open() const
+{
+  return fd >= 0;
+}
+
+/**
+ * Lookup entry by version, and mark it as most recently used.
+ *
+ * \returns true if an entry was found
+ */
+bool
+InstEncIndex::lookup (const string& version, string& key)
+{
+  if (!is_open())
+    return false;
+
+  Lock lock (fd);
+  if (!sync_map() || !valid())
+    return false;
+
+  int index = find_slot (version);
+  if (index < 0)
+    return false;
+
+  Header *h = header();
+  h->dirty = 1;
+  lru_unlink (index);
+  lru_push_front (index);
+  h->dirty = 0;
+
+  key = slot_entry (index).key;
+  return true;
+}
+
+/**
+ * Add entry to the index (as most recently used entry). Entries with the same
+ * key and a different version are no longer needed, so they are removed.
+ *
+ * \returns entries that have been removed from the index
+ */
+vector<InstEncIndex::Entry>
+InstEncIndex::insert (const Entry& entry)
+{
+  vector<Entry> removed;
+
+  if (!is_open() || entry.key.size() >= sizeof (Slot::key) || entry.version.size() >= sizeof (Slot::version))
+    return removed;
+
+  Lock lock (fd);
+  if (!sync_map() || !valid())
+    return removed;
+
+  header()->dirty = 1;
+
+  /* remove old versions of the key; the slots are scanned (instead of remembering
+   * versions in memory) so that versions inserted by other processes (or before a
+   * restart) are found, too
+   */
+  for (int i = header()->lru_head; i >= 0;)
+    {
+      const int next = slot (i)->lru_next;
+
+      if (entry.key == slot (i)->key && entry.version != slot (i)->version)
+        {
+          removed.push_back (slot_entry (i));
+          remove_slot (i);
+        }
+      i = next;
+    }
+
+  int index = find_slot (entry.version);
+  if (index >= 0)
+    remove_slot (index);
+
+  /* keep load factor (including deleted slots) below 75% */
+  Header *h = header();
+  if ((h->n_used + h->n_deleted + 1) * 4 > h->n_slots * 3)
+    {
+      uint32 n_slots = h->n_slots;
+      if ((h->n_used + 1) * 2 > n_slots)
+        n_slots *= 2;
+
+      rehash (n_slots);
+      if (!is_open())
+        return removed;
+    }
+
+  insert_slot (entry);
+  header()->dirty = 0;
+
+  return removed;
+}
+
+/**
+ * Remove entry from index (for instance if the corresponding file doesn't exist).
+ */
+void
+InstEncIndex::remove (const string& version)
+{
+  if (!is_open())
+    return;
+
+  Lock lock (fd);
+  if (!sync_map() || !valid())
+    return;
+
+  int index = find_slot (version);
+  if (index >= 0)
+    {
+      header()->dirty = 1;
+      remove_slot (index);
+      header()->dirty = 0;
+    }
+}
+
+/**
+ * Remove least recently used entries until the total size of all entries is
+ * at most max_total_size.
+ *
+ * \returns entries that have been removed from the index
+ */
+vector<InstEncIndex::Entry>
+InstEncIndex::prune (uint64 max_total_size)
+{
+  vector<Entry> removed;
+
+  if (!is_open())
+    return removed;
+
+  Lock lock (fd);
+  if (!sync_map() || !valid())
+    return removed;
+
+  Header *h = header();
+  h->dirty = 1;
+  while (h->total_size > max_total_size && h->lru_tail >= 0)
+    {
+      removed.push_back (slot_entry (h->lru_tail));
+      remove_slot (h->lru_tail);
+    }
+  h->dirty = 0;
+
+  return removed;
+}
+
+/**
+ * \returns number of entries in the index
+ */
+size_t
+InstEncIndex::size()
+{
+  if (!is_open())
+    return 0;
+
+  Lock lock (fd);
+  if (!sync_map() || !valid())
+    return 0;
+
+  return header()->n_used;
+}
+
+/**
+ * \returns sum of the sizes of all entries in the index
+ */
+uint64
+InstEncIndex::total_size()
+{
+  if (!is_open())
+    return 0;
+
+  Lock lock (fd);
+  if (!sync_map() || !valid())
+    return 0;
+
+  return header()->total_size;
+}
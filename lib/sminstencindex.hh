@@ -0,0 +1,79 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#ifndef SPECTMORPH_INSTENCINDEX_HH
+#define SPECTMORPH_INSTENCINDEX_HH
+
+#include "smutils.hh"
+
+#include <string>
+#include <vector>
+#include <functional>
+
+namespace SpectMorph
+{
+
+/**
+ * Persistent index for the InstEncCache disk cache
+ *
+ * The index is a hash table (keyed by version) stored in a memory mapped file,
+ * with a doubly linked list of all entries in least recently used order. This
+ * way lookup, insert and pruning the cache do not need to scan the cache
+ * directory. The index file is locked during each operation, so that it can be
+ * shared between processes.
+ *
+ * This class is not thread safe, the caller needs to serialize calls.
+ */
+class InstEncIndex
+{
+public:
+  struct Entry
+  {
+    std::string key;
+    std::string version;
+    uint64      size = 0;
+  };
+
+private:
+  struct Header;
+  struct Slot;
+  class  Lock;
+
+  int            fd = -1;
+  unsigned char *map_mem = nullptr;
+  size_t         map_size = 0;
+
+  Header  *header();
+  Slot    *slot (int index);
+
+  bool     map_file();
+  void     unmap_file();
+  bool     sync_map();
+  bool     valid();
+  bool     init_table (uint32 n_slots, const std::vector<Entry>& entries);
+  void     rehash (uint32 n_slots);
+  int      find_slot (const std::string& version);
+  void     insert_slot (const Entry& entry);
+  void     remove_slot (int index);
+  void     lru_unlink (int index);
+  void     lru_push_front (int index);
+  Entry    slot_entry (int index);
+public:
+  InstEncIndex();
+  ~InstEncIndex();
+
+  bool                open (const std::string& filename, const std::function<std::vector<Entry>()>& scan_files);
+  void                close();
+  bool                is_open() const;
+
+  bool                lookup (const std::string& version, std::string& key);
+  std::vector<Entry>  insert (const Entry& entry);
+  void                remove (const std::string& version);
+  std::vector<Entry>  prune (uint64 max_total_size);
+
+  size_t              size();
+  uint64              total_size();
+};
+
+}
+
+#endif
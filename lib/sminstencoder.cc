@@ -29,22 +29,33 @@ InstEncoder::encode (const WavData& wav_data, int midi_note, Instrument::Encoder
     }
   enc_params.setup_params (wav_data, freq_from_note (midi_note));
   enc_params.enable_phases = false; // save some space
+  enc_params.keep_debug_data = false;
   enc_params.set_kill_function (kill_function);
 
   Encoder encoder (enc_params);
+  if (frame_cache)
+    encoder.set_frame_cache (frame_cache, frame_cache_signal_start);
 
   if (!encoder.encode (wav_data, /* channel */ 0, /* opt */ 1, /* attack */ true, /* sines */ true))
     return nullptr;
 
-  /* strip stuff we don't need (but keep everything that is needed if loop points are changed) */
-  vector<EncoderBlock>& audio_blocks = encoder.audio_blocks;
+  updated_frame_cache = encoder.get_frame_cache();
 
-  for (size_t i = 0; i < audio_blocks.size(); i++)
-    {
-      audio_blocks[i].debug_samples.clear();
-      audio_blocks[i].original_fft.clear();
-    }
+  /* strip stuff we don't need (but keep everything that is needed if loop points are changed) */
   encoder.original_samples.clear();
 
   return encoder.save_as_audio();
 }
+
+void
+InstEncoder::set_frame_cache (const std::shared_ptr<const EncoderFrameCache>& new_frame_cache, int64 signal_start)
+{
+  frame_cache              = new_frame_cache;
+  frame_cache_signal_start = signal_start;
+}
+
+std::shared_ptr<EncoderFrameCache>
+InstEncoder::get_frame_cache() const
+{
+  return updated_frame_cache;
+}
@@ -15,10 +15,17 @@ class InstEncoder
   EncoderParams      enc_params;
   std::vector<float> window;
 
+  std::shared_ptr<const EncoderFrameCache> frame_cache;
+  std::shared_ptr<EncoderFrameCache>       updated_frame_cache;
+  int64                                    frame_cache_signal_start = 0;
+
   void setup_params (const WavData& wd, int midi_note);
 
 public:
   Audio *encode (const WavData& wd, int midi_note, Instrument::EncoderConfig& cfg, const std::function<bool()>& kill_function);
+
+  void set_frame_cache (const std::shared_ptr<const EncoderFrameCache>& frame_cache, int64 signal_start);
+  std::shared_ptr<EncoderFrameCache> get_frame_cache() const;
 };
 
 }
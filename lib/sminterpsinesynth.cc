@@ -0,0 +1,216 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "sminterpsinesynth.hh"
+#include "smmath.hh"
+
+#include <algorithm>
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+using namespace SpectMorph;
+
+using std::min;
+
+/* four floats, computed with SIMD instructions */
+typedef float Float4 __attribute__ ((vector_size (16)));
+
+static inline Float4
+load_float4 (const float *p)
+{
+  Float4 v;
+  memcpy (&v, p, sizeof (v));
+  return v;
+}
+
+static inline void
+store_float4 (float *p, const Float4& v)
+{
+  memcpy (p, &v, sizeof (v));
+}
+
+/* for x close to 1: returns approximately 1 / sqrt (x) (Newton iteration) */
+static inline Float4
+inv_sqrt_near_one (const Float4& x)
+{
+  return (3 - x) * 0.5f;
+}
+
+InterpSineSynth::InterpSineSynth (double mix_freq, size_t sub_block_size) :
+  mix_freq (mix_freq),
+  sub_block_size (sub_block_size)
+{
+  assert (sub_block_size > 0);
+}
+
+void
+InterpSineSynth::reset()
+{
+  new_partials.clear();
+  tracks.clear();
+}
+
+/*
+ * add partial to the frame that will be rendered by the next render() call
+ * (if the partial doesn't continue an old partial, it starts with phase 0
+ * or with a random phase)
+ */
+void
+InterpSineSynth::add_partial (double freq, double mag, bool random_phase)
+{
+  Partial partial;
+  partial.freq         = freq;
+  partial.mag          = mag;
+  partial.random_phase = random_phase;
+
+  new_partials.push_back (partial);
+}
+
+/*
+ * Renders the transition from the previous frame to the frame given by the
+ * add_partial() calls since the last render() call, the output is added to out
+ */
+void
+InterpSineSynth::render (size_t n_values, float *out)
+{
+  std::sort (new_partials.begin(), new_partials.end(), [] (const Partial& p1, const Partial& p2) { return p1.freq < p2.freq; });
+
+  /* old_tracks: state after the previous frame */
+  old_tracks.swap (tracks);
+  tracks.clear();
+
+  bool old_used[old_tracks.size()];
+  std::fill (old_used, old_used + old_tracks.size(), false);
+
+  size_t old_index = 0;
+  for (const auto& partial : new_partials)
+    {
+      /* find the old partial with the closest frequency */
+      while (old_index + 1 < old_tracks.size() &&
+             fabs (old_tracks[old_index + 1].end_freq - partial.freq) < fabs (old_tracks[old_index].end_freq - partial.freq))
+        {
+          old_index++;
+        }
+
+      Track track;
+      if (old_index < old_tracks.size() && !old_used[old_index] &&
+          partial.freq < old_tracks[old_index].end_freq * 1.05f && partial.freq > old_tracks[old_index].end_freq * 0.95f)
+        {
+          /* continue old partial */
+          const Track& old_track = old_tracks[old_index];
+
+          track.start_freq = old_track.end_freq;
+          track.start_mag  = old_track.end_mag;
+          track.re         = old_track.re;
+          track.im         = old_track.im;
+
+          old_used[old_index] = true;
+        }
+      else
+        {
+          /* fade in new partial */
+          const double phase = partial.random_phase ? random_gen.random_double_range (0, 2 * M_PI) : 0;
+
+          track.start_freq = partial.freq;
+          track.start_mag  = 0;
+          track.re         = cos (phase);
+          track.im         = sin (phase);
+        }
+      track.end_freq = partial.freq;
+      track.end_mag  = partial.mag;
+      tracks.push_back (track);
+    }
+  const size_t n_new_tracks = tracks.size();
+
+  /* fade out old partials which have no successor */
+  for (size_t i = 0; i < old_tracks.size(); i++)
+    {
+      if (!old_used[i])
+        {
+          Track track = old_tracks[i];
+
+          track.start_freq = track.end_freq;
+          track.start_mag  = track.end_mag;
+          track.end_mag    = 0;
+          tracks.push_back (track);
+        }
+    }
+
+  /* render four tracks at once */
+  track_out.assign (n_values * 4, 0);
+  for (size_t t = 0; t < tracks.size(); t += 4)
+    render_tracks (&tracks[t], min<size_t> (tracks.size() - t, 4), n_values);
+
+  for (size_t i = 0; i < n_values; i++)
+    out[i] += track_out[i * 4] + track_out[i * 4 + 1] + track_out[i * 4 + 2] + track_out[i * 4 + 3];
+
+  /* keep only the tracks that continue in the next frame */
+  tracks.resize (n_new_tracks);
+  new_partials.clear();
+}
+
+void
+InterpSineSynth::render_tracks (Track *t, size_t n_tracks, size_t n_values)
+{
+  Float4 re = { 1, 1, 1, 1 }, im = {}, mag = {}, delta_mag = {};
+  Float4 inc_start_re = { 1, 1, 1, 1 }, inc_start_im = {}, inc_end_re = { 1, 1, 1, 1 }, inc_end_im = {};
+
+  for (size_t l = 0; l < n_tracks; l++)
+    {
+      double s, c;
+
+      sm_sincos (t[l].start_freq * 2 * M_PI / mix_freq, &s, &c);
+      inc_start_re[l] = c;
+      inc_start_im[l] = s;
+
+      sm_sincos (t[l].end_freq * 2 * M_PI / mix_freq, &s, &c);
+      inc_end_re[l] = c;
+      inc_end_im[l] = s;
+
+      re[l]        = t[l].re;
+      im[l]        = t[l].im;
+      mag[l]       = t[l].start_mag;
+      delta_mag[l] = (t[l].end_mag - t[l].start_mag) / n_values;
+    }
+
+  float *out = &track_out[0];
+  for (size_t pos = 0; pos < n_values; pos += sub_block_size)
+    {
+      const size_t todo = min (sub_block_size, n_values - pos);
+
+      /* phase increment for this sub-block: interpolate between start and end
+       * (normalized linear interpolation of the rotation)
+       */
+      const float frac = (pos + 0.5 * todo) / n_values;
+
+      Float4 inc_re = inc_start_re + (inc_end_re - inc_start_re) * frac;
+      Float4 inc_im = inc_start_im + (inc_end_im - inc_start_im) * frac;
+
+      Float4 norm = inv_sqrt_near_one (inc_re * inc_re + inc_im * inc_im);
+      norm *= inv_sqrt_near_one (norm * norm * (inc_re * inc_re + inc_im * inc_im));
+      inc_re *= norm;
+      inc_im *= norm;
+
+      for (size_t i = pos; i < pos + todo; i++)
+        {
+          store_float4 (out + i * 4, load_float4 (out + i * 4) + im * mag);
+          mag += delta_mag;
+
+          const Float4 new_re = re * inc_re - im * inc_im;
+          im = re * inc_im + im * inc_re;
+          re = new_re;
+        }
+
+      /* avoid that the magnitude of the oscillator state drifts away from 1 */
+      norm = inv_sqrt_near_one (re * re + im * im);
+      re *= norm;
+      im *= norm;
+    }
+
+  for (size_t l = 0; l < n_tracks; l++)
+    {
+      t[l].re = re[l];
+      t[l].im = im[l];
+    }
+}
@@ -0,0 +1,60 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#ifndef SPECTMORPH_INTERP_SINE_SYNTH_HH
+#define SPECTMORPH_INTERP_SINE_SYNTH_HH
+
+#include <sys/types.h>
+#include <vector>
+
+#include "smrandom.hh"
+
+namespace SpectMorph {
+
+/*
+ * Continuous sine synthesis (alternative to overlap-adding IFFTSynth frames)
+ *
+ * The partials of each new frame are matched against the partials of the
+ * previous frame. Between the two frames, the frequency of each partial is
+ * interpolated per sub-block and the magnitude is interpolated per sample,
+ * while the phase of each partial is continuous. Partials without a match are
+ * faded in/out.
+ */
+class InterpSineSynth
+{
+  struct Partial
+  {
+    float freq;
+    float mag;
+    bool  random_phase;
+  };
+  struct Track
+  {
+    float start_freq;
+    float end_freq;
+    float start_mag;
+    float end_mag;
+    float re;  // phasor (state of the recursive oscillator)
+    float im;
+  };
+  double              mix_freq;
+  size_t              sub_block_size;
+
+  std::vector<Partial> new_partials;
+  std::vector<Track>   tracks;       // first the tracks of the current frame (sorted by freq), then fade-outs
+  std::vector<Track>   old_tracks;
+  std::vector<float>   track_out;    // output of four tracks (interleaved)
+  Random               random_gen;
+
+  void render_tracks (Track *t, size_t n_tracks, size_t n_values);
+
+public:
+  InterpSineSynth (double mix_freq, size_t sub_block_size = 32);
+
+  void reset();
+  void add_partial (double freq, double mag, bool random_phase = false);
+  void render (size_t n_values, float *out);
+};
+
+}
+
+#endif
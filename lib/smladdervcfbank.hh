@@ -0,0 +1,297 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl.html
+#ifndef SPECTMORPH_LADDER_VCF_BANK_HH
+#define SPECTMORPH_LADDER_VCF_BANK_HH
+
+#include "smladdervcf.hh"
+
+#include <algorithm>
+
+namespace SpectMorph {
+
+/*
+ * Voice parallel version of LadderVCF: the same ladder filter is computed for
+ * LANES voices at once (one voice per SIMD lane), with per voice cutoff,
+ * resonance, mix, drive and mode.
+ *
+ * The state of each voice is kept in a Voice object, which is owned by the
+ * caller, so voices can be combined differently for each block.
+ */
+template<bool OVERSAMPLE, bool NON_LINEAR>
+class LadderVCFBank
+{
+public:
+#ifdef __AVX__
+  static constexpr uint LANES = 8;
+#else
+  static constexpr uint LANES = 4;
+#endif
+
+  class Voice
+  {
+    float x1, x2, x3, x4;
+    float y1, y2, y3, y4;
+
+    Resampler2 res_up   { Resampler2::UP,   2, Resampler2::PREC_72DB };
+    Resampler2 res_down { Resampler2::DOWN, 2, Resampler2::PREC_72DB };
+
+    LadderVCFMode mode;
+    float         pre_scale, post_scale;
+    float         rate;
+
+    friend class LadderVCFBank;
+  public:
+    Voice()
+    {
+      reset();
+      set_mode (LadderVCFMode::LP4);
+      set_drive (0);
+      set_rate (48000);
+    }
+    void
+    set_mode (LadderVCFMode new_mode)
+    {
+      mode = new_mode;
+    }
+    void
+    set_drive (double drive_db)
+    {
+      const double drive_delta_db = 36;
+
+      pre_scale = db_to_factor (drive_db - drive_delta_db);
+      post_scale = std::max (1 / pre_scale, 1.0f);
+    }
+    void
+    set_rate (double r)
+    {
+      rate = r;
+    }
+    LadderVCFMode
+    get_mode() const
+    {
+      return mode;
+    }
+    void
+    reset()
+    {
+      x1 = x2 = x3 = x4 = 0;
+      y1 = y2 = y3 = y4 = 0;
+
+      res_up.reset();
+      res_down.reset();
+    }
+  };
+
+  struct Lane
+  {
+    Voice       *voice = nullptr;
+    float       *values = nullptr;    // filter input, replaced by filter output
+    const float *freq_in = nullptr;   // cutoff frequency in Hz (for each sample)
+    const float *reso_in = nullptr;   // resonance in range [0;1] (for each sample)
+    const float *mix_in = nullptr;    // mix in range [0;1] (for each sample)
+  };
+
+private:
+  static constexpr uint BLOCK_SIZE = 64;
+  static constexpr uint OVERSAMPLE_COUNT = OVERSAMPLE ? 2 : 1;
+
+  /* one value per voice, computed with SIMD instructions */
+  typedef float Lanes __attribute__ ((vector_size (LANES * sizeof (float))));
+
+  static inline Lanes
+  distort (Lanes x)
+  {
+    if (NON_LINEAR)
+      {
+        /* shaped somewhat similar to tanh() and others, but faster */
+        const Lanes one = Lanes{} + 1;
+
+        x = x < one ? x : one;
+        x = x > -one ? x : -one;
+
+        return x - x * x * x * (1.0f / 3);
+      }
+    else
+      {
+        return x;
+      }
+  }
+  /*
+   * processes up to LANES voices with the same mode (the ladder filter
+   * algorithm is the same as in LadderVCF::run)
+   */
+  template<LadderVCFMode MODE> static void
+  run_lanes (uint n_samples, const Lane **lanes, uint n_lanes)
+  {
+    Lanes x1{}, x2{}, x3{}, x4{};
+    Lanes y1{}, y2{}, y3{}, y4{};
+    Lanes pre_scale{}, post_scale{};
+
+    for (uint l = 0; l < n_lanes; l++)
+      {
+        const Voice& v = *lanes[l]->voice;
+
+        x1[l] = v.x1; x2[l] = v.x2; x3[l] = v.x3; x4[l] = v.x4;
+        y1[l] = v.y1; y2[l] = v.y2; y3[l] = v.y3; y4[l] = v.y4;
+        pre_scale[l] = v.pre_scale;
+        post_scale[l] = v.post_scale;
+      }
+
+    const float freq_scale = OVERSAMPLE ? 0.5 : 1.0;
+
+    for (uint pos = 0; pos < n_samples; pos += BLOCK_SIZE)
+      {
+        const uint block_len = std::min (BLOCK_SIZE, n_samples - pos);
+
+        Lanes values[BLOCK_SIZE * OVERSAMPLE_COUNT];
+        Lanes fc[BLOCK_SIZE];
+        Lanes res[BLOCK_SIZE];
+        Lanes mix[BLOCK_SIZE];
+        float lane_buffer[BLOCK_SIZE * OVERSAMPLE_COUNT];
+
+        /* gather input and parameters */
+        for (uint l = 0; l < LANES; l++)
+          {
+            if (l < n_lanes)
+              {
+                const Lane& lane = *lanes[l];
+                const float *in = lane.values + pos;
+
+                if (OVERSAMPLE)
+                  {
+                    lane.voice->res_up.process_block (in, block_len, lane_buffer);
+                    in = lane_buffer;
+                  }
+                for (uint i = 0; i < block_len * OVERSAMPLE_COUNT; i++)
+                  values[i][l] = in[i];
+
+                const float nyquist = lane.voice->rate * 0.5f;
+                for (uint i = 0; i < block_len; i++)
+                  {
+                    fc[i][l]  = sm_clamp (lane.freq_in[pos + i] * freq_scale / nyquist, 0.0f, 1.0f);
+                    res[i][l] = sm_clamp (lane.reso_in[pos + i], 0.0f, 1.0f);
+                    mix[i][l] = lane.mix_in[pos + i]; // caller needs to keep this in range [0;1]
+                  }
+              }
+            else
+              {
+                for (uint i = 0; i < block_len * OVERSAMPLE_COUNT; i++)
+                  values[i][l] = 0;
+
+                for (uint i = 0; i < block_len; i++)
+                  fc[i][l] = res[i][l] = mix[i][l] = 0;
+              }
+          }
+
+        for (uint i = 0; i < block_len; i++)
+          {
+            const Lanes f = float (M_PI) * fc[i];
+            const Lanes g = 0.9892f * f - 0.4342f * f * f + 0.1381f * f * f * f - 0.0202f * f * f * f * f;
+            const Lanes r = res[i] * (1.0029f + 0.0526f * f - 0.0926f * f * f + 0.0218f * f * f * f);
+
+            for (uint os = 0; os < OVERSAMPLE_COUNT; os++)
+              {
+                Lanes& v = values[i * OVERSAMPLE_COUNT + os];
+
+                const Lanes x = v * pre_scale;
+                const float g_comp = 0.5f; // passband gain correction
+                const Lanes x0 = distort (x - (y4 - g_comp * x) * r * 4);
+
+                y1 = (x0 * (1 / 1.3f) + x1 * (0.3f / 1.3f) - y1) * g + y1;
+                x1 = x0;
+
+                y2 = (y1 * (1 / 1.3f) + x2 * (0.3f / 1.3f) - y2) * g + y2;
+                x2 = y1;
+
+                y3 = (y2 * (1 / 1.3f) + x3 * (0.3f / 1.3f) - y3) * g + y3;
+                x3 = y2;
+
+                y4 = (y3 * (1 / 1.3f) + x4 * (0.3f / 1.3f) - y4) * g + y4;
+                x4 = y3;
+
+                Lanes out;
+                switch (MODE)
+                  {
+                    case LadderVCFMode::LP1:
+                      out = y1 * post_scale;
+                      break;
+                    case LadderVCFMode::LP2:
+                      out = y2 * post_scale;
+                      break;
+                    case LadderVCFMode::LP3:
+                      out = y3 * post_scale;
+                      break;
+                    case LadderVCFMode::LP4:
+                    default:
+                      out = y4 * post_scale;
+                      break;
+                  }
+                v = out * mix[i] + v * (1 - mix[i]);
+              }
+          }
+
+        /* scatter output */
+        for (uint l = 0; l < n_lanes; l++)
+          {
+            const Lane& lane = *lanes[l];
+
+            for (uint i = 0; i < block_len * OVERSAMPLE_COUNT; i++)
+              lane_buffer[i] = values[i][l];
+
+            if (OVERSAMPLE)
+              lane.voice->res_down.process_block (lane_buffer, block_len * OVERSAMPLE_COUNT, lane.values + pos);
+            else
+              std::copy_n (lane_buffer, block_len, lane.values + pos);
+          }
+      }
+
+    for (uint l = 0; l < n_lanes; l++)
+      {
+        Voice& v = *lanes[l]->voice;
+
+        v.x1 = x1[l]; v.x2 = x2[l]; v.x3 = x3[l]; v.x4 = x4[l];
+        v.y1 = y1[l]; v.y2 = y2[l]; v.y3 = y3[l]; v.y4 = y4[l];
+      }
+  }
+  template<LadderVCFMode MODE> static void
+  run_mode (uint n_samples, const Lane *lanes, uint n_lanes)
+  {
+    const Lane *mode_lanes[LANES];
+    uint        n_mode_lanes = 0;
+
+    for (uint i = 0; i < n_lanes; i++)
+      {
+        if (lanes[i].voice->mode == MODE)
+          {
+            mode_lanes[n_mode_lanes++] = &lanes[i];
+
+            if (n_mode_lanes == LANES)
+              {
+                run_lanes<MODE> (n_samples, mode_lanes, n_mode_lanes);
+                n_mode_lanes = 0;
+              }
+          }
+      }
+    if (n_mode_lanes)
+      run_lanes<MODE> (n_samples, mode_lanes, n_mode_lanes);
+  }
+public:
+  /*
+   * Filter n_samples values for each lane; lanes which use the same filter
+   * mode are processed together, LANES voices at a time.
+   */
+  static void
+  run_block (uint n_samples, const Lane *lanes, uint n_lanes)
+  {
+    run_mode<LadderVCFMode::LP4> (n_samples, lanes, n_lanes);
+    run_mode<LadderVCFMode::LP3> (n_samples, lanes, n_lanes);
+    run_mode<LadderVCFMode::LP2> (n_samples, lanes, n_lanes);
+    run_mode<LadderVCFMode::LP1> (n_samples, lanes, n_lanes);
+  }
+};
+
+// non-linear filter bank (uses oversampling), same model as LadderVCFNonLinear
+typedef LadderVCFBank<true, true> LadderVCFNonLinearBank;
+
+} // SpectMorph
+
+#endif // SPECTMORPH_LADDER_VCF_BANK_HH
@@ -21,6 +21,10 @@
 #ifndef SPECTMORPH_LINEAR_SMOOTH_HH
 #define SPECTMORPH_LINEAR_SMOOTH_HH
 
+#include "smblockutils.hh"
+
+#include <algorithm>
+
 namespace SpectMorph
 {
 
@@ -67,6 +71,20 @@ public:
         return linear_value_;
       }
   }
+  /* same as calling get_next() n_values times */
+  void
+  get_block (uint n_values, float *values)
+  {
+    uint i = 0;
+    if (steps_)
+      {
+        i = std::min (n_values, steps_);
+
+        linear_value_ = Block::linear_ramp (i, values, linear_value_, linear_step_);
+        steps_ -= i;
+      }
+    std::fill (values + i, values + n_values, value_);
+  }
   bool
   is_constant()
   {
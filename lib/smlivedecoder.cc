@@ -3,6 +3,7 @@
 #include "smlivedecoder.hh"
 #include "smmath.hh"
 #include "smleakdebugger.hh"
+#include "smmorphutils.hh"
 #include "smutils.hh"
 
 #include <stdio.h>
@@ -51,6 +52,8 @@ LiveDecoder::LiveDecoder() :
   smset (NULL),
   audio (NULL),
   ifft_synth (NULL),
+  osc_bank_synth (NULL),
+  interp_sine_synth (NULL),
   noise_decoder (NULL),
   source (NULL),
   sines_enabled (true),
@@ -59,6 +62,8 @@ LiveDecoder::LiveDecoder() :
   original_samples_enabled (false),
   loop_enabled (true),
   start_skip_enabled (false),
+  low_latency_enabled (false),
+  interpolated_sines_enabled (false),
   noise_seed (-1),
   sse_samples (NULL),
   vibrato_enabled (false)
@@ -87,6 +92,16 @@ LiveDecoder::~LiveDecoder()
       delete ifft_synth;
       ifft_synth = NULL;
     }
+  if (osc_bank_synth)
+    {
+      delete osc_bank_synth;
+      osc_bank_synth = NULL;
+    }
+  if (interp_sine_synth)
+    {
+      delete interp_sine_synth;
+      interp_sine_synth = NULL;
+    }
   if (noise_decoder)
     {
       delete noise_decoder;
@@ -104,7 +119,6 @@ void
 LiveDecoder::retrigger (int channel, float freq, int midi_velocity, float mix_freq)
 {
   Audio *best_audio = 0;
-  double best_diff = 1e10;
 
   if (source)
     {
@@ -114,27 +128,7 @@ LiveDecoder::retrigger (int channel, float freq, int midi_velocity, float mix_fr
   else
     {
       if (smset)
-        {
-          float note = freq_to_note (freq);
-
-          // find best audio candidate
-          for (vector<WavSetWave>::iterator wi = smset->waves.begin(); wi != smset->waves.end(); wi++)
-            {
-              Audio *audio = wi->audio;
-              if (audio && wi->channel == channel &&
-                           wi->velocity_range_min <= midi_velocity &&
-                           wi->velocity_range_max >= midi_velocity)
-                {
-                  float audio_note = freq_to_note (audio->fundamental_freq);
-
-                  if (fabs (audio_note - note) < best_diff)
-                    {
-                      best_diff = fabs (audio_note - note);
-                      best_audio = audio;
-                    }
-                }
-            }
-        }
+        best_audio = smset->find_audio (channel, freq, midi_velocity);
     }
   audio = best_audio;
 
@@ -147,7 +141,13 @@ LiveDecoder::retrigger (int channel, float freq, int midi_velocity, float mix_fr
       loop_end_scaled = audio->loop_end * mix_freq / audio->mix_freq;
       loop_point = (get_loop_type() == Audio::LOOP_NONE) ? -1 : audio->loop_start;
 
+      const size_t old_block_size = block_size;
+      const float  old_block_mix_freq = block_mix_freq;
+
       block_size = NoiseDecoder::preferred_block_size (mix_freq);
+      if (low_latency_enabled)
+        block_size /= 4; /* 256 samples at 44.1/48 kHz */
+      block_mix_freq = mix_freq;
 
       /* start skip: skip the first half block to avoid fade-in at start
        * this will produce clicks unless an external envelope is applied
@@ -166,9 +166,36 @@ LiveDecoder::retrigger (int channel, float freq, int midi_velocity, float mix_fr
         delete ifft_synth;
       ifft_synth = new IFFTSynth (block_size, mix_freq, IFFTSynth::WIN_HANNING);
 
+      /* osc_bank_synth is kept for the next note unless block size or mix freq change */
+      if (!osc_bank_synth || block_size != old_block_size || block_mix_freq != old_block_mix_freq)
+        {
+          if (osc_bank_synth)
+            delete osc_bank_synth;
+          osc_bank_synth = new OscBankSynth (block_size, mix_freq);
+        }
+
+      /* interpolated sines are enabled/disabled per note, so process_internal doesn't need to allocate */
+      interpolated_sines_active = interpolated_sines_enabled;
+      if (interp_sine_synth && block_mix_freq != old_block_mix_freq)
+        {
+          delete interp_sine_synth;
+          interp_sine_synth = NULL;
+        }
+      if (interp_sine_synth)
+        interp_sine_synth->reset();
+      else if (interpolated_sines_active)
+        interp_sine_synth = new InterpSineSynth (mix_freq);
+
+      /* low latency mode needs short hops, frame interpolation is done per block_size / 2 hop */
+      long_hop = block_size / 2;
+      if (!low_latency_enabled)
+        long_hop = max (long_hop, interpolated_sines_hop);
+
+      synth_hop = block_size / 2;
+
       if (sse_samples)
         delete sse_samples;
-      sse_samples = new AlignedArray<float, 16> (block_size);
+      sse_samples = new AlignedArray<float, 16> (max (block_size, long_hop));
 
       pp_inter = PolyPhaseInter::the(); // do not delete
 
@@ -243,6 +270,79 @@ LiveDecoder::compute_loop_frame_index (size_t frame_idx, Audio *audio)
   return frame_idx;
 }
 
+size_t
+LiveDecoder::compute_frame_idx (double env_pos)
+{
+  size_t frame_idx;
+
+  if (get_loop_type() == Audio::LOOP_TIME_FORWARD)
+    {
+      size_t xenv_pos = env_pos;
+
+      if (xenv_pos > loop_start_scaled)
+        {
+          xenv_pos = (xenv_pos - loop_start_scaled) % (loop_end_scaled - loop_start_scaled);
+          xenv_pos += loop_start_scaled;
+        }
+      frame_idx = xenv_pos / frame_step;
+    }
+  else if (get_loop_type() == Audio::LOOP_FRAME_FORWARD || get_loop_type() == Audio::LOOP_FRAME_PING_PONG)
+    {
+      frame_idx = compute_loop_frame_index (env_pos / frame_step, audio);
+    }
+  else
+    {
+      frame_idx = env_pos / frame_step;
+      if (loop_point != -1 && frame_idx > size_t (loop_point)) /* if in loop mode: loop current frame */
+        frame_idx = loop_point;
+    }
+  return frame_idx;
+}
+
+AudioBlock *
+LiveDecoder::get_audio_block (size_t frame_idx)
+{
+  if (source)
+    return source->audio_block (frame_idx);
+
+  if (frame_idx < audio->contents.size())
+    return &audio->contents[frame_idx];
+
+  return nullptr;
+}
+
+/*
+ * low latency mode: the synthesis hop is shorter than the frame step of the
+ * model data, so instead of using the same frame for a few hops, we interpolate
+ * between the current frame and the next frame
+ */
+AudioBlock *
+LiveDecoder::interpolate_next_frame (AudioBlock *block_ptr)
+{
+  /* position between current and next frame (for time loops, env_pos wraps at the loop end) */
+  double frame_env_pos = env_pos;
+  if (get_loop_type() == Audio::LOOP_TIME_FORWARD && frame_env_pos > loop_start_scaled)
+    frame_env_pos = fmod (frame_env_pos - loop_start_scaled, loop_end_scaled - loop_start_scaled) + loop_start_scaled;
+
+  const double interp = fmod (frame_env_pos, frame_step) / frame_step;
+  const size_t next_frame_idx = compute_frame_idx (env_pos + frame_step);
+
+  if (interp < 0.01 || next_frame_idx == frame_idx)
+    return block_ptr;
+
+  /* copy current frame: a LiveDecoderSource may reuse the block for the next audio_block() call */
+  interp_left_block.freqs = block_ptr->freqs;
+  interp_left_block.mags  = block_ptr->mags;
+  interp_left_block.noise = block_ptr->noise;
+
+  const AudioBlock *next_block = get_audio_block (next_frame_idx);
+  if (!next_block)
+    return &interp_left_block;
+
+  MorphUtils::interp_frames (interp_left_block, *next_block, interp, interp_block);
+  return &interp_block;
+}
+
 void
 LiveDecoder::process_internal (size_t n_values, float *audio_out, float portamento_stretch)
 {
@@ -260,12 +360,10 @@ LiveDecoder::process_internal (size_t n_values, float *audio_out, float portamen
       if (fabs (phase_inc - 1.0) < 1e-6)
         need_resample = false;
 
+      /* compute read positions, wrapped into the loop for LOOP_TIME_FORWARD */
+      double pos[n_values];
       for (unsigned int i = 0; i < n_values; i++)
         {
-          double want_freq = current_freq;
-          double phase_inc = (want_freq / audio->fundamental_freq) *
-                             (audio->mix_freq / current_mix_freq);
-
           int ipos = original_sample_pos;
           float frac = original_sample_pos - ipos;
 
@@ -274,20 +372,29 @@ LiveDecoder::process_internal (size_t n_values, float *audio_out, float portamen
               while (ipos >= (audio->loop_end - audio->zero_values_at_start))
                 ipos -= (audio->loop_end - audio->loop_start);
             }
+          pos[i] = ipos + frac;
 
-          if (need_resample)
-            {
-              audio_out[i] = pp_inter->get_sample (audio->original_samples, ipos + frac) * original_samples_norm_factor;
-            }
-          else
+          original_sample_pos += phase_inc;
+        }
+
+      if (need_resample)
+        {
+          pp_inter->get_samples (audio->original_samples, pos, n_values, audio_out);
+
+          for (unsigned int i = 0; i < n_values; i++)
+            audio_out[i] *= original_samples_norm_factor;
+        }
+      else
+        {
+          for (unsigned int i = 0; i < n_values; i++)
             {
+              const int ipos = pos[i];
+
               if (ipos >= 0 && size_t (ipos) < audio->original_samples.size())
                 audio_out[i] = audio->original_samples[ipos] * original_samples_norm_factor;
               else
                 audio_out[i] = 0;
             }
-
-          original_sample_pos += phase_inc;
         }
       if (original_sample_pos > audio->original_samples.size() && get_loop_type() != Audio::LOOP_TIME_FORWARD)
         {
@@ -305,40 +412,31 @@ LiveDecoder::process_internal (size_t n_values, float *audio_out, float portamen
         {
           double want_freq = current_freq;
 
-          std::copy (&(*sse_samples)[block_size / 2], &(*sse_samples)[block_size], &(*sse_samples)[0]);
-          zero_float_block (block_size / 2, &(*sse_samples)[block_size / 2]);
-
-          if (get_loop_type() == Audio::LOOP_TIME_FORWARD)
-            {
-              size_t xenv_pos = env_pos;
-
-              if (xenv_pos > loop_start_scaled)
-                {
-                  xenv_pos = (xenv_pos - loop_start_scaled) % (loop_end_scaled - loop_start_scaled);
-                  xenv_pos += loop_start_scaled;
-                }
-              frame_idx = xenv_pos / frame_step;
-            }
-          else if (get_loop_type() == Audio::LOOP_FRAME_FORWARD || get_loop_type() == Audio::LOOP_FRAME_PING_PONG)
+          /* interpolated sines without noise don't need overlap-add of IFFTSynth frames,
+           * so the synthesis hop can be longer than block_size / 2
+           */
+          const size_t sse_size = max (block_size, long_hop);
+          if (synth_hop != block_size / 2) /* all samples of the last long hop have been used */
             {
-              frame_idx = compute_loop_frame_index (env_pos / frame_step, audio);
+              zero_float_block (sse_size, &(*sse_samples)[0]);
             }
           else
             {
-              frame_idx = env_pos / frame_step;
-              if (loop_point != -1 && frame_idx > size_t (loop_point)) /* if in loop mode: loop current frame */
-                frame_idx = loop_point;
+              std::copy (&(*sse_samples)[block_size / 2], &(*sse_samples)[block_size], &(*sse_samples)[0]);
+              zero_float_block (sse_size - block_size / 2, &(*sse_samples)[block_size / 2]);
             }
+          if (interpolated_sines_active && !noise_enabled && !debug_fft_perf_enabled)
+            synth_hop = long_hop;
+          else
+            synth_hop = block_size / 2;
+
+          /* frame at the end of the hop, like the center of the frame which is overlap-added at block_size / 2 */
+          frame_idx = compute_frame_idx (env_pos + (synth_hop - block_size / 2) * portamento_env_step);
+
+          AudioBlock *audio_block_ptr = get_audio_block (frame_idx);
+          if (audio_block_ptr && low_latency_enabled)
+            audio_block_ptr = interpolate_next_frame (audio_block_ptr);
 
-          AudioBlock *audio_block_ptr = NULL;
-          if (source)
-            {
-              audio_block_ptr = source->audio_block (frame_idx);
-            }
-          else if (frame_idx < audio->contents.size())
-            {
-              audio_block_ptr = &audio->contents[frame_idx];
-            }
           if (audio_block_ptr)
             {
               if (filter_callback) /* FIXME: FILTER */
@@ -348,14 +446,22 @@ LiveDecoder::process_internal (size_t n_values, float *audio_out, float portamen
 
               assert (audio_block.freqs.size() == audio_block.mags.size());
 
-              ifft_synth->clear_partials();
+              /* for frames with only a few partials (and no noise), the time domain oscillator bank is
+               * faster than IFFTSynth; both produce the same windowed output, so we can choose per frame
+               */
+              const bool use_osc_bank = sines_enabled && !noise_enabled && !debug_fft_perf_enabled && !interpolated_sines_active &&
+                                        OscBankSynth::faster_than_ifft (block_size, audio_block.freqs.size() * unison_voices);
+              if (use_osc_bank)
+                osc_bank_synth->clear_partials();
+              else
+                ifft_synth->clear_partials();
 
               // point n_pstate to pstate[0] and pstate[1] alternately (one holds points to last state and the other points to new state)
               bool lps_zero = (last_pstate == &pstate[0]);
               vector<PartialState>& new_pstate = lps_zero ? pstate[1] : pstate[0];
               const vector<PartialState>& old_pstate = lps_zero ? pstate[0] : pstate[1];
-              vector<float>& unison_new_phases = lps_zero ? unison_phases[1] : unison_phases[0];
-              const vector<float>& unison_old_phases = lps_zero ? unison_phases[0] : unison_phases[1];
+              vector<uint32_t>& unison_new_phases = lps_zero ? unison_phases[1] : unison_phases[0];
+              const vector<uint32_t>& unison_old_phases = lps_zero ? unison_phases[0] : unison_phases[1];
 
               if (unison_voices != 1)
                 {
@@ -367,10 +473,20 @@ LiveDecoder::process_internal (size_t n_values, float *audio_out, float portamen
 
               if (sines_enabled)
                 {
-                  const double phase_factor = block_size * M_PI / current_mix_freq;
+                  /* phase advance per frame for freq = 1, using fixed point phase (full circle = 2^32) */
+                  const double iphase_factor = block_size * 2147483648.0 / current_mix_freq;
                   const double filter_fact = 18000.0 / 44100.0;  // for 44.1 kHz, filter at 18 kHz (higher mix freq => higher filter)
                   const double filter_min_freq = filter_fact * current_mix_freq;
 
+                  /* unison: phase advance per frame and frequency for each voice of one partial */
+                  double unison_iphase_factor[unison_voices];
+                  double unison_freqs[unison_voices];
+                  if (unison_voices != 1)
+                    {
+                      for (int i = 0; i < unison_voices; i++)
+                        unison_iphase_factor[i] = iphase_factor * unison_freq_factor[i];
+                    }
+
                   size_t old_partial = 0;
                   for (size_t partial = 0; partial < audio_block.freqs.size(); partial++)
                     {
@@ -378,7 +494,7 @@ LiveDecoder::process_internal (size_t n_values, float *audio_out, float portamen
 
                       // anti alias filter:
                       double mag         = audio_block.mags_f (partial);
-                      double phase       = 0; //atan2 (smag, cmag); FIXME: Does initial phase matter? I think not.
+                      uint32_t phase     = 0; //atan2 (smag, cmag); FIXME: Does initial phase matter? I think not.
 
                       // portamento:
                       //  - portamento_stretch > 1 means we read out faster
@@ -409,6 +525,24 @@ LiveDecoder::process_internal (size_t n_values, float *audio_out, float portamen
                                 }
                             }
                         }
+                      if (spectral_filter)
+                        mag *= spectral_filter->gain (freq);
+
+                      if (interpolated_sines_active)
+                        {
+                          /* InterpSineSynth matches the partials of consecutive frames itself, so no partial state is needed */
+                          if (unison_voices == 1)
+                            {
+                              interp_sine_synth->add_partial (freq, mag);
+                            }
+                          else
+                            {
+                              /* new unison tracks start with random phases */
+                              for (int i = 0; i < unison_voices; i++)
+                                interp_sine_synth->add_partial (freq * unison_freq_factor[i], mag * unison_gain, true);
+                            }
+                          continue;
+                        }
 
                       /*
                        * increment old_partial as long as there is a better candidate (closer to freq)
@@ -443,39 +577,50 @@ LiveDecoder::process_internal (size_t n_values, float *audio_out, float portamen
                             {
                               // matching freq -> compute new phase
                               const double lfreq = old_pstate[old_partial].freq;
-                              const double lphase = old_pstate[old_partial].phase;
+                              const uint32_t lphase = old_pstate[old_partial].phase;
 
-                              phase = fmod (lphase + lfreq * phase_factor, 2 * M_PI);
+                              /* no wrapping necessary: uint32_t overflow wraps the phase */
+                              phase = lphase + uint32_t (int64_t (lfreq * iphase_factor + 0.5));
 
                               if (DEBUG)
                                 printf ("%d:L %.17g %.17g %.17g\n", int (env_pos), lfreq, freq, mag);
                             }
-                          ifft_synth->render_partial (freq, mag, phase);
+                          if (use_osc_bank)
+                            osc_bank_synth->render_partial_iphase (freq, mag, phase);
+                          else
+                            ifft_synth->render_partial_iphase (freq, mag, phase);
                         }
                       else
                         {
                           mag *= unison_gain;
 
-                          for (int i = 0; i < unison_voices; i++)
-                            {
-                              if (freq_match)
-                                {
-                                  const double lfreq = old_pstate[old_partial].freq;
-                                  const double lphase = unison_old_phases[old_partial * unison_voices + i];
+                          /* the phases of all voices of one partial are stored next to each other */
+                          const size_t voices_start = unison_new_phases.size();
+                          unison_new_phases.resize (voices_start + unison_voices);
 
-                                  phase = fmod (lphase + lfreq * phase_factor * unison_freq_factor[i], 2 * M_PI);
-                                }
-                              else
-                                {
-                                  // randomize start phase for unison
+                          uint32_t *new_phases = &unison_new_phases[voices_start];
+                          if (freq_match)
+                            {
+                              const double lfreq = old_pstate[old_partial].freq;
+                              const uint32_t *old_phases = &unison_old_phases[old_partial * unison_voices];
 
-                                  phase = unison_phase_random_gen.random_double_range (0, 2 * M_PI);
-                                }
+                              for (int i = 0; i < unison_voices; i++)
+                                new_phases[i] = old_phases[i] + uint32_t (int64_t (lfreq * unison_iphase_factor[i] + 0.5));
+                            }
+                          else
+                            {
+                              // randomize start phase for unison
+                              unison_phase_random_gen.random_block (unison_voices, new_phases);
+                            }
+                          for (int i = 0; i < unison_voices; i++)
+                            unison_freqs[i] = freq * unison_freq_factor[i];
 
-                              ifft_synth->render_partial (freq * unison_freq_factor[i], mag, phase);
+                          if (use_osc_bank)
+                            osc_bank_synth->render_partials_iphase (unison_voices, unison_freqs, mag, new_phases);
+                          else
+                            ifft_synth->render_partials_iphase (unison_voices, unison_freqs, mag, new_phases);
 
-                              unison_new_phases.push_back (phase);
-                            }
+                          phase = new_phases[unison_voices - 1];
                         }
 
                       PartialState ps;
@@ -487,9 +632,26 @@ LiveDecoder::process_internal (size_t n_values, float *audio_out, float portamen
               last_pstate = &new_pstate;
 
               if (noise_enabled)
-                noise_decoder->process (audio_block, ifft_synth->fft_buffer(), NoiseDecoder::FFT_SPECTRUM, portamento_stretch);
+                {
+                  if (spectral_filter)
+                    {
+                      float noise_gain[block_size / 2 + 1];
+                      spectral_filter->gain_spectrum (block_size / 2 + 1, current_mix_freq / block_size, noise_gain);
+
+                      noise_decoder->process (audio_block, ifft_synth->fft_buffer(), NoiseDecoder::FFT_SPECTRUM, portamento_stretch, noise_gain);
+                    }
+                  else
+                    {
+                      noise_decoder->process (audio_block, ifft_synth->fft_buffer(), NoiseDecoder::FFT_SPECTRUM, portamento_stretch);
+                    }
+                }
 
-              if (noise_enabled || sines_enabled || debug_fft_perf_enabled)
+              if (use_osc_bank)
+                {
+                  float *samples = &(*sse_samples)[0];
+                  osc_bank_synth->get_samples (samples, IFFTSynth::ADD);
+                }
+              else if (noise_enabled || (sines_enabled && !interpolated_sines_active) || debug_fft_perf_enabled)
                 {
                   float *samples = &(*sse_samples)[0];
                   ifft_synth->get_samples (samples, IFFTSynth::ADD);
@@ -500,8 +662,15 @@ LiveDecoder::process_internal (size_t n_values, float *audio_out, float portamen
               if (done_state == DoneState::ACTIVE)
                 done_state = DoneState::ALMOST_DONE;
             }
+          if (interpolated_sines_active)
+            {
+              /* the first half block goes from the center of the previous frame to the center of
+               * the current frame; without audio block, the partials of the previous frame fade out
+               */
+              interp_sine_synth->render (synth_hop, &(*sse_samples)[0]);
+            }
           pos = 0;
-          have_samples = block_size / 2;
+          have_samples = synth_hop;
         }
 
       g_assert (have_samples > 0);
@@ -622,8 +791,7 @@ LiveDecoder::process_portamento (size_t n_values, const float *freq_in, float *a
       portamento_grow (end_pos, current_step);
 
       /* interpolate from buffer (portamento) */
-      for (size_t i = 0; i < n_values; i++)
-        audio_out[i] = pp_inter->get_sample_no_check (buffer, pos[i]);
+      pp_inter->get_samples_no_check (buffer, pos, n_values, audio_out);
     }
   else
     {
@@ -771,6 +939,39 @@ LiveDecoder::enable_start_skip (bool ess)
   start_skip_enabled = ess;
 }
 
+/*
+ * low latency mode: use a four times shorter synthesis window / hop, and
+ * interpolate between the frames of the model; this reduces the note-on
+ * fade-in (window) and the delay until parameter changes are audible, but
+ * requires more CPU; the new mode is used after the next retrigger()
+ *
+ * the spectrum of the shorter window has fewer bins than the lowest noise
+ * bands need, so NoiseBandPartition adds their energy to the nearest bin
+ */
+void
+LiveDecoder::enable_low_latency (bool ell)
+{
+  low_latency_enabled = ell;
+}
+
+/*
+ * interpolated sines: instead of overlap-adding windowed IFFTSynth frames,
+ * render the sines with InterpSineSynth, which interpolates the partial
+ * frequencies and magnitudes between frames with continuous phase; noise is
+ * still rendered by overlap-adding frames
+ *
+ * without noise, the synthesis hop can be set to a larger value (in samples)
+ * than the default hop (block_size / 2) to save CPU (not in low latency mode)
+ *
+ * both settings are used after the next retrigger()
+ */
+void
+LiveDecoder::enable_interpolated_sines (bool eis, size_t hop)
+{
+  interpolated_sines_enabled = eis;
+  interpolated_sines_hop = hop;
+}
+
 void
 LiveDecoder::precompute_tables (float mix_freq)
 {
@@ -836,17 +1037,17 @@ LiveDecoder::set_unison_voices (int voices, float detune)
   /* resize unison phase array to match pstate */
   const bool lps_zero = (last_pstate == &pstate[0]);
   const vector<PartialState>& old_pstate = lps_zero ? pstate[0] : pstate[1];
-  vector<float>& unison_old_phases = lps_zero ? unison_phases[0] : unison_phases[1];
+  vector<uint32_t>& unison_old_phases = lps_zero ? unison_phases[0] : unison_phases[1];
 
   if (unison_old_phases.size() != old_pstate.size() * unison_voices)
     {
       unison_old_phases.resize (old_pstate.size() * unison_voices);
 
-      for (float& phase : unison_old_phases)
+      for (uint32_t& phase : unison_old_phases)
         {
           /* since the position of the partials changed, randomization is really
            * the best we can do here */
-          phase = unison_phase_random_gen.random_double_range (0, 2 * M_PI);
+          phase = unison_phase_random_gen.random_uint32();
         }
     }
 }
@@ -905,3 +1106,17 @@ LiveDecoder::set_filter_callback (const std::function<void()>& new_filter_callba
 {
   filter_callback = new_filter_callback;
 }
+
+/* filter sines and noise in the frequency domain (before synthesis), nullptr disables the filter */
+void
+LiveDecoder::set_spectral_filter (SpectralFilter *new_spectral_filter)
+{
+  spectral_filter = new_spectral_filter;
+}
+
+/* original samples are played back without spectral model, so they can't be filtered spectrally */
+bool
+LiveDecoder::spectral_filter_supported() const
+{
+  return !original_samples_enabled;
+}
@@ -6,9 +6,12 @@
 #include "smwavset.hh"
 #include "smsinedecoder.hh"
 #include "smnoisedecoder.hh"
+#include "smoscbanksynth.hh"
+#include "sminterpsinesynth.hh"
 #include "smlivedecodersource.hh"
 #include "smpolyphaseinter.hh"
 #include "smalignedarray.hh"
+#include "smspectralfilter.hh"
 #include <vector>
 #include <functional>
 
@@ -18,8 +21,8 @@ class LiveDecoder
 {
   struct PartialState
   {
-    float freq;
-    float phase;
+    float    freq;
+    uint32_t phase; // fixed point, see sm_phase2iphase
   };
   std::vector<PartialState> pstate[2], *last_pstate;
 
@@ -35,6 +38,8 @@ class LiveDecoder
   Audio              *audio;
 
   IFFTSynth          *ifft_synth;
+  OscBankSynth       *osc_bank_synth;
+  InterpSineSynth    *interp_sine_synth;
   NoiseDecoder       *noise_decoder;
   LiveDecoderSource  *source;
   PolyPhaseInter     *pp_inter;
@@ -45,6 +50,10 @@ class LiveDecoder
   bool                original_samples_enabled;
   bool                loop_enabled;
   bool                start_skip_enabled;
+  bool                low_latency_enabled;
+  bool                interpolated_sines_enabled;
+  size_t              interpolated_sines_hop = 0;
+  bool                interpolated_sines_active = false;  // interpolated_sines_enabled during the current note
 
   size_t              frame_size, frame_step;
   size_t              zero_values_at_start_scaled;
@@ -55,7 +64,10 @@ class LiveDecoder
   float               current_mix_freq;
 
   size_t              have_samples;
-  size_t              block_size;
+  size_t              block_size = 0;
+  float               block_mix_freq = 0;   // mix_freq used for block_size dependent objects
+  size_t              synth_hop = 0;        // hop used for the current synthesis block (block_size / 2 unless long_hop)
+  size_t              long_hop = 0;         // hop for interpolated sines without noise
   size_t              pos;
   double              env_pos;
   size_t              frame_idx;
@@ -64,11 +76,15 @@ class LiveDecoder
 
   int                 noise_seed;
 
+  // low latency mode: frame interpolation
+  AudioBlock          interp_left_block;
+  AudioBlock          interp_block;
+
   AlignedArray<float,16> *sse_samples;
 
   // unison
   int                 unison_voices;
-  std::vector<float>  unison_phases[2];
+  std::vector<uint32_t> unison_phases[2];
   std::vector<float>  unison_freq_factor;
   float               unison_gain;
   Random              unison_phase_random_gen;
@@ -83,6 +99,7 @@ class LiveDecoder
 
   // filter
   std::function<void()> filter_callback;
+  SpectralFilter       *spectral_filter = nullptr;
 
   // timing related
   double              start_env_pos = 0;
@@ -98,6 +115,10 @@ class LiveDecoder
 
   Audio::LoopType     get_loop_type();
 
+  size_t      compute_frame_idx (double env_pos);
+  AudioBlock *get_audio_block (size_t frame_idx);
+  AudioBlock *interpolate_next_frame (AudioBlock *block_ptr);
+
   void process_internal (size_t       n_values,
                          float       *audio_out,
                          float        portamento_stretch);
@@ -123,10 +144,14 @@ public:
   void enable_original_samples (bool eos);
   void enable_loop (bool eloop);
   void enable_start_skip (bool ess);
+  void enable_low_latency (bool ell);
+  void enable_interpolated_sines (bool eis, size_t hop = 0);
   void set_noise_seed (int seed);
   void set_unison_voices (int voices, float detune);
   void set_vibrato (bool enable_vibrato, float depth, float frequency, float attack);
   void set_filter_callback (const std::function<void()>& filter_callback);
+  void set_spectral_filter (SpectralFilter *spectral_filter);
+  bool spectral_filter_supported() const;
 
   void precompute_tables (float mix_freq);
   void retrigger (int channel, float freq, int midi_velocity, float mix_freq);
@@ -97,6 +97,9 @@ GlobalData::GlobalData()
   for (auto area : cfg.debug())
     Debug::enable (area);
 
+  wav_set_repo.set_demand_load (cfg.demand_load());
+  wav_set_repo.set_memory_budget (size_t (std::max (cfg.wav_set_memory_mb(), 0)) * 1024 * 1024);
+
   FFT::init();
   int_sincos_init();
   sm_math_init();
@@ -527,6 +527,56 @@ double sm_xparam_inv (double x, double slope);
 double sm_bessel_i0 (double x);
 double velocity_to_gain (double velocity, double vrange_db);
 
+/* fixed point phase representation: the range [0;2*pi) is mapped to the full
+ * range of a 32-bit unsigned integer, so phase wrapping is done implicitly by
+ * integer overflow
+ */
+inline uint32_t
+sm_phase2iphase (double phase)
+{
+  return uint32_t (llrint (phase * (4294967296.0 / (2 * M_PI))));
+}
+
+inline double
+sm_iphase2phase (uint32_t iphase)
+{
+  return iphase * (2 * M_PI / 4294967296.0);
+}
+
+/* fast approximation of exp2f (x) (relative error less than 1e-6, for x in [-126;126])
+ *
+ * uses no branches or tables, so loops calling this function can be vectorized
+ */
+inline float
+sm_exp2f_fast (float x)
+{
+  x = std::min (std::max (x, -126.0f), 126.0f);
+
+  /* split into integer part (without using floor, which may not vectorize)
+   * and fractional part in range [-0.5;0.5]
+   */
+  const int   ix = int (x + 128.5f) - 128;
+  const float fx = x - ix;
+
+  /* polynomial approximation of 2^fx (cephes exp2f coefficients) */
+  float p = 1.535336188319500e-4f;
+  p = p * fx + 1.339887440266574e-3f;
+  p = p * fx + 9.618437357674640e-3f;
+  p = p * fx + 5.550332471162809e-2f;
+  p = p * fx + 2.402264791363012e-1f;
+  p = p * fx + 6.931472028550421e-1f;
+  p = p * fx + 1.0f;
+
+  /* 2^ix: build float exponent bits */
+  union {
+    float    f;
+    uint32_t i;
+  } u;
+  u.i = uint32_t (ix + 127) << 23;
+
+  return p * u.f;
+}
+
 /* FIXME: FILTER: get rid of sm_bound */
 template<typename T>
 inline const T&
@@ -40,6 +40,11 @@ MidiSynth::MidiSynth (double mix_freq, size_t n_voices) :
   voices.clear();
   voices.resize (n_voices);
   active_voices.reserve (n_voices);
+  render_voices.reserve (n_voices);
+  filter_lanes.reserve (n_voices);
+
+  /* each rendered voice needs MAX_RENDER_BLOCK samples + 3 * MAX_RENDER_BLOCK filter parameters */
+  render_buffer.resize (n_voices * 4 * MAX_RENDER_BLOCK);
 
   for (size_t i = 0; i < n_voices; i++)
     {
@@ -361,12 +366,21 @@ MidiSynth::add_midi_event (size_t offset, const unsigned char *midi_data)
 void
 MidiSynth::process_audio (const TimeInfo& time_info, float *output, size_t n_values)
 {
-  if (!n_values)    /* this can happen if multiple midi events occur at the same time */
-    return;
+  /* split into sub-blocks, so render_buffer never needs to be resized in the audio thread */
+  for (size_t offset = 0; offset < n_values; offset += MAX_RENDER_BLOCK)
+    {
+      /* each sub-block starts at audio_time_stamp (as if the host had called process with smaller blocks) */
+      TimeInfo block_time = time_info;
+      block_time.time_ms = audio_time_stamp / m_mix_freq * 1000;
 
+      process_audio_block (block_time, output + offset, min (n_values - offset, size_t (MAX_RENDER_BLOCK)));
+    }
+}
+
+void
+MidiSynth::process_audio_block (const TimeInfo& time_info, float *output, size_t n_values)
+{
   bool  need_free = false;
-  float samples[n_values];
-  float *values[1] = { samples };
 
   zero_float_block (n_values, output);
 
@@ -374,6 +388,13 @@ MidiSynth::process_audio (const TimeInfo& time_info, float *output, size_t n_val
   if (!morph_plan_synth.have_output())
     return;
 
+  /* each rendered voice needs n_values samples + 3 * n_values filter parameters */
+  const size_t voice_buffer_size = 4 * n_values;
+  assert (render_buffer.size() >= active_voices.size() * voice_buffer_size);
+
+  render_voices.clear();
+  filter_lanes.clear();
+
   for (Voice *voice : active_voices)
     {
       voice->mp_voice->set_control_input (0, control[0]);
@@ -381,7 +402,6 @@ MidiSynth::process_audio (const TimeInfo& time_info, float *output, size_t n_val
       voice->mp_voice->set_control_input (2, control[2]);
       voice->mp_voice->set_control_input (3, control[3]);
 
-      const float gain = voice->gain * m_gain;
       const float *freq_in = nullptr;
       float frequencies[n_values];
       if (fabs (voice->pitch_bend_freq - voice->freq) > 1e-3 || voice->pitch_bend_steps > 0)
@@ -401,21 +421,40 @@ MidiSynth::process_audio (const TimeInfo& time_info, float *output, size_t n_val
         {
           /* skip: shadow voices are not rendered */
         }
-      else if (voice->state == Voice::STATE_ON)
+      else if (voice->state == Voice::STATE_ON || voice->state == Voice::STATE_RELEASE)
         {
           MorphOutputModule *output_module = voice->mp_voice->output();
 
-          output_module->process (time_info, n_values, values, 1, freq_in);
-          for (size_t i = 0; i < n_values; i++)
-            output[i] += samples[i] * gain;
+          float *samples = &render_buffer[render_voices.size() * voice_buffer_size];
+          float *filter_params = samples + n_values;
+
+          LadderVCFNonLinearBank::Lane filter_lane;
+          if (output_module->process_unfiltered (time_info, n_values, samples, freq_in, filter_params, filter_lane))
+            filter_lanes.push_back (filter_lane);
+
+          render_voices.push_back (voice);
         }
-      else if (voice->state == Voice::STATE_RELEASE)
+      else
         {
-          MorphOutputModule *output_module = voice->mp_voice->output();
+          g_assert_not_reached();
+        }
+    }
 
-          output_module->process (time_info, n_values, values, 1, freq_in);
-          for (size_t i = 0; i < n_values; i++)
-            output[i] += samples[i] * gain;
+  /* run filter for all voices at once (processes multiple voices in parallel) */
+  LadderVCFNonLinearBank::run_block (n_values, filter_lanes.data(), filter_lanes.size());
+
+  for (size_t v = 0; v < render_voices.size(); v++)
+    {
+      Voice *voice = render_voices[v];
+
+      const float  gain = voice->gain * m_gain;
+      const float *samples = &render_buffer[v * voice_buffer_size];
+      for (size_t i = 0; i < n_values; i++)
+        output[i] += samples[i] * gain;
+
+      if (voice->state == Voice::STATE_RELEASE)
+        {
+          MorphOutputModule *output_module = voice->mp_voice->output();
 
           if (output_module->done())
             {
@@ -426,10 +465,6 @@ MidiSynth::process_audio (const TimeInfo& time_info, float *output, size_t n_val
               need_free = true; // need to recompute active_voices and idle_voices vectors
             }
         }
-      else
-        {
-          g_assert_not_reached();
-        }
     }
   if (need_free)
     free_unused_voices();
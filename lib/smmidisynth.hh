@@ -5,6 +5,7 @@
 
 #include "smmorphplansynth.hh"
 #include "sminsteditsynth.hh"
+#include "smladdervcfbank.hh"
 
 namespace SpectMorph {
 
@@ -55,6 +56,14 @@ class MidiSynth
   std::vector<Voice>    voices;
   std::vector<Voice *>  idle_voices;
   std::vector<Voice *>  active_voices;
+
+  /* voice parallel filtering: voice output and filter parameters of all rendered voices
+   * (preallocated for n_voices, longer blocks are processed in sub-blocks of MAX_RENDER_BLOCK values)
+   */
+  static constexpr size_t                   MAX_RENDER_BLOCK = 256;
+  std::vector<float>                        render_buffer;
+  std::vector<Voice *>                      render_voices;
+  std::vector<LadderVCFNonLinearBank::Lane> filter_lanes;
   double                m_mix_freq;
   double                m_gain = 1;
   double                m_tempo = 120;
@@ -77,6 +86,7 @@ class MidiSynth
 
   void set_mono_enabled (bool new_value);
   void process_audio (const TimeInfo& block_time, float *output, size_t n_values);
+  void process_audio_block (const TimeInfo& block_time, float *output, size_t n_values);
   void process_note_on (const TimeInfo& block_time, int channel, int midi_note, int midi_velocity);
   void process_note_off (int midi_note);
   void process_midi_controller (int controller, int value);
@@ -113,5 +113,8 @@ MMapIn::get_pos()
 GenericIn *
 MMapIn::open_subfile (size_t pos, size_t len)
 {
-  return new MMapIn (mapfile + pos, mapfile + pos + len, nullptr /* no mapped file */);
+  /* the subfile keeps the mapping alive, so it can be used after this file is closed (demand loading) */
+  GMappedFile *gmf = g_mapped_file ? g_mapped_file_ref (g_mapped_file) : nullptr;
+
+  return new MMapIn (mapfile + pos, mapfile + pos + len, gmf);
 }
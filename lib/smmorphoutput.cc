@@ -26,6 +26,7 @@ MorphOutput::MorphOutput (MorphPlan *morph_plan) :
 
   add_property (&m_config.sines, P_SINES, "Enable Sine Synthesis", true);
   add_property (&m_config.noise, P_NOISE, "Enable Noise Synthesis", true);
+  add_property (&m_config.low_latency, P_LOW_LATENCY, "Low Latency (more CPU)", false);
 
   add_property (&m_config.unison, P_UNISON, "Enable Unison Effect", false);
   add_property (&m_config.unison_voices, P_UNISON_VOICES, "Voices", "%d", 2, 2, 7);
@@ -59,6 +60,7 @@ MorphOutput::MorphOutput (MorphPlan *morph_plan) :
 
   add_property (&m_config.filter_drive, P_FILTER_DRIVE, "Drive", "%.1f dB", 0, 0, 60);
   add_property (&m_config.filter_mix_mod, P_FILTER_MIX, "Mix", "%.1f %%", 100, 0, 100);
+  add_property (&m_config.filter_spectral, P_FILTER_SPECTRAL, "Spectral Filter (fast, no drive)", false);
 
   add_property (&m_config.portamento, P_PORTAMENTO, "Enable Portamento (Mono)", false);
   add_property_xparam (&m_config.portamento_glide, P_PORTAMENTO_GLIDE, "Glide", "%.2f ms", 200, 0, 1000, 3);
@@ -33,6 +33,7 @@ public:
 
     bool                          sines;
     bool                          noise;
+    bool                          low_latency;
 
     bool                          unison;
     int                           unison_voices;
@@ -57,6 +58,7 @@ public:
     ModulationData                filter_resonance_mod;
     float                         filter_drive;
     ModulationData                filter_mix_mod;
+    bool                          filter_spectral;
 
     bool                          portamento;
     float                         portamento_glide;
@@ -72,6 +74,7 @@ public:
 
   static constexpr auto P_SINES  = "sines";
   static constexpr auto P_NOISE  = "noise";
+  static constexpr auto P_LOW_LATENCY = "low_latency";
 
   static constexpr auto P_UNISON        = "unison";
   static constexpr auto P_UNISON_VOICES = "unison_voices";
@@ -96,6 +99,7 @@ public:
   static constexpr auto P_FILTER_RESONANCE  = "filter_resonance";
   static constexpr auto P_FILTER_DRIVE      = "filter_drive";
   static constexpr auto P_FILTER_MIX        = "filter_mix";
+  static constexpr auto P_FILTER_SPECTRAL   = "filter_spectral";
 
   static constexpr auto P_PORTAMENTO        = "portamento";
   static constexpr auto P_PORTAMENTO_GLIDE  = "portamento_glide";
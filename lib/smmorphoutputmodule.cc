@@ -134,6 +134,22 @@ MorphOutputModule::process (const TimeInfo& time_info, size_t n_samples, float *
     }
 }
 
+/* like process() for port 0, but the filter needs to be run by the caller (if enabled) */
+bool
+MorphOutputModule::process_unfiltered (const TimeInfo& time_info, size_t n_samples, float *values, const float *freq_in,
+                                       float *filter_params, LadderVCFNonLinearBank::Lane& filter_lane)
+{
+  const bool have_cycle = morph_plan_voice->morph_plan_synth()->have_cycle();
+
+  block_time = time_info;
+
+  if (out_decoders[0] && !have_cycle)
+    return out_decoders[0]->process_unfiltered (n_samples, freq_in, values, filter_params, filter_lane);
+
+  zero_float_block (n_samples, values);
+  return false;
+}
+
 TimeInfo
 MorphOutputModule::compute_time_info() const
 {
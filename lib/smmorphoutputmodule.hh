@@ -22,6 +22,8 @@ public:
 
   void set_config (const MorphOperatorConfig *op_cfg);
   void process (const TimeInfo& time_info, size_t n_samples, float **values, size_t n_ports, const float *freq_in = nullptr);
+  bool process_unfiltered (const TimeInfo& time_info, size_t n_samples, float *values, const float *freq_in,
+                           float *filter_params, LadderVCFNonLinearBank::Lane& filter_lane);
   void retrigger (const TimeInfo& time_info, int channel, float freq, int midi_velocity);
   void release();
   bool done();
@@ -2,7 +2,13 @@
 
 #include "smmorphplansynth.hh"
 #include "smmorphplanvoice.hh"
+#include "smmorphsource.hh"
+#include "smmorphlinear.hh"
+#include "smmorphgrid.hh"
+#include "smwavsetrepo.hh"
 #include "smleakdebugger.hh"
+#include "smutils.hh"
+#include "smdebug.hh"
 
 using namespace SpectMorph;
 
@@ -75,6 +81,26 @@ recursive_cycle_check (MorphOperator *start_op, int depth)
   return false;
 }
 
+static void
+collect_wav_set_paths (const MorphOperatorConfig *config, vector<string>& paths)
+{
+  if (auto source_cfg = dynamic_cast<const MorphSource::Config *> (config))
+    {
+      paths.push_back (source_cfg->path);
+    }
+  else if (auto linear_cfg = dynamic_cast<const MorphLinear::Config *> (config))
+    {
+      paths.push_back (linear_cfg->left_path);
+      paths.push_back (linear_cfg->right_path);
+    }
+  else if (auto grid_cfg = dynamic_cast<const MorphGrid::Config *> (config))
+    {
+      for (const auto& column : grid_cfg->input_node)
+        for (const auto& node : column)
+          paths.push_back (node.path);
+    }
+}
+
 MorphPlanSynth::UpdateP
 MorphPlanSynth::prepare_update (MorphPlanPtr plan) /* main thread */
 {
@@ -102,6 +128,26 @@ MorphPlanSynth::prepare_update (MorphPlanPtr plan) /* main thread */
   sort (update->ops.begin(), update->ops.end(),
         [](const Update::Op& a, const Update::Op& b) { return a.ptr_id < b.ptr_id; });
 
+  /* load all wav sets in parallel here, so that set_config() in the audio thread
+   * only needs to look them up in the repo
+   */
+  vector<string> paths;
+  for (auto config : update->new_configs)
+    collect_wav_set_paths (config.get(), paths);
+  paths.erase (std::remove (paths.begin(), paths.end(), ""), paths.end());
+
+  const double load_start = get_time();
+  update->wav_sets = WavSetRepo::the()->preload (paths);
+  update->wav_set_load_time = get_time() - load_start;
+
+  Debug::debug ("wavset", "preloaded %zd wav sets in %.2f ms\n", update->wav_sets.size(), update->wav_set_load_time * 1000);
+
+  /* demand loaded wav sets: request audio data for the usual playing range (C2..C6) now,
+   * so that the first notes don't play silence or the audio of a different note
+   */
+  for (auto wav_set : update->wav_sets)
+    wav_set->prefetch (36, 84);
+
   vector<string> update_ids = sorted_id_list (plan);
 
   update->cheap = (update_ids == m_last_update_ids) && (plan->id() == m_last_plan_id);
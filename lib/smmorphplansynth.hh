@@ -6,6 +6,7 @@
 #include "smmorphplan.hh"
 #include "smmorphoperator.hh"
 #include "smrandom.hh"
+#include "smwavset.hh"
 #include <map>
 #include <memory>
 
@@ -41,6 +42,9 @@ public:
     std::vector<Op> ops;
     std::vector<MorphOperatorConfigP> new_configs;
     std::vector<MorphOperatorConfigP> old_configs;
+
+    std::vector<std::shared_ptr<WavSet>> wav_sets;        // preloaded wav sets used by the new configs
+    double                               wav_set_load_time = 0; // time for preloading wav sets (seconds)
   };
   typedef std::shared_ptr<Update> UpdateP;
 
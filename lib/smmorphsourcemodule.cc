@@ -15,14 +15,7 @@ using std::max;
 
 static LeakDebugger leak_debugger ("SpectMorph::MorphSourceModule");
 
-static float
-freq_to_note (float freq)
-{
-  return 69 + 12 * log (freq / 440) / log (2);
-}
-
 SimpleWavSetSource::SimpleWavSetSource() :
-  wav_set (NULL),
   active_audio (NULL)
 {
 }
@@ -30,10 +23,14 @@ SimpleWavSetSource::SimpleWavSetSource() :
 void
 SimpleWavSetSource::set_wav_set (const string& path)
 {
-  WavSet *new_wav_set = WavSetRepo::the()->get (path);
+  std::shared_ptr<WavSet> new_wav_set = WavSetRepo::the()->get (path);
   if (new_wav_set != wav_set)
     {
-      wav_set = new_wav_set;
+      /* the LiveDecoder may still play active_audio, so we keep the wav set it belongs to */
+      if (active_audio)
+        old_wav_set = std::move (wav_set);
+
+      wav_set = std::move (new_wav_set);
       active_audio = NULL;
     }
 }
@@ -41,29 +38,17 @@ SimpleWavSetSource::set_wav_set (const string& path)
 void
 SimpleWavSetSource::retrigger (int channel, float freq, int midi_velocity, float mix_freq)
 {
-  Audio *best_audio = NULL;
-  float  best_diff  = 1e10;
+  /* the repo holds a reference to every wav set that is still referenced,
+   * so releasing old_wav_set here never frees a wav set in the synthesis thread;
+   * in the common case (no wav set change), there is no reference counting here
+   */
+  if (old_wav_set)
+    old_wav_set.reset();
 
   if (wav_set)
-    {
-      float note = freq_to_note (freq);
-      for (vector<WavSetWave>::iterator wi = wav_set->waves.begin(); wi != wav_set->waves.end(); wi++)
-        {
-          Audio *audio = wi->audio;
-          if (audio && wi->channel == channel &&
-                       wi->velocity_range_min <= midi_velocity &&
-                       wi->velocity_range_max >= midi_velocity)
-            {
-              float audio_note = freq_to_note (audio->fundamental_freq);
-              if (fabs (audio_note - note) < best_diff)
-                {
-                  best_diff = fabs (audio_note - note);
-                  best_audio = audio;
-                }
-            }
-        }
-    }
-  active_audio = best_audio;
+    active_audio = wav_set->find_audio (channel, freq, midi_velocity);
+  else
+    active_audio = NULL;
 }
 
 Audio*
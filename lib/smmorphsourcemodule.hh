@@ -12,8 +12,9 @@ namespace SpectMorph
 class SimpleWavSetSource : public LiveDecoderSource
 {
 private:
-  WavSet *wav_set;
-  Audio  *active_audio;
+  std::shared_ptr<WavSet> wav_set;
+  std::shared_ptr<WavSet> old_wav_set; // keeps audio of the old wav set alive until the next retrigger
+  Audio                  *active_audio;
 
 public:
   SimpleWavSetSource();
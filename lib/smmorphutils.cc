@@ -116,6 +116,73 @@ get_normalized_block (LiveDecoderSource *source, double time_ms, AudioBlock& out
   return true;
 }
 
+/*
+ * interpolate between two frames of the same sound (for instance two adjacent frames):
+ *
+ *  - partials that exist in both frames are interpolated (frequency and magnitude in dB)
+ *  - the other partials are faded in/out
+ *  - the noise envelope is interpolated (in dB)
+ *
+ * interp = 0 gives left_block, interp = 1 gives right_block
+ */
+void
+interp_frames (const AudioBlock& left_block, const AudioBlock& right_block, double interp, AudioBlock& out_audio_block)
+{
+  const size_t left_freqs_size  = left_block.freqs.size();
+  const size_t right_freqs_size = right_block.freqs.size();
+
+  FreqState left_freqs[left_freqs_size];
+  FreqState right_freqs[right_freqs_size];
+
+  init_freq_state (left_block.freqs, left_freqs);
+  init_freq_state (right_block.freqs, right_freqs);
+
+  out_audio_block.freqs.clear();
+  out_audio_block.mags.clear();
+  out_audio_block.phases.clear();
+
+  for (size_t i = 0; i < left_freqs_size; i++)
+    {
+      size_t j;
+      if (find_match (left_freqs[i].freq_f, right_freqs, right_freqs_size, &j))
+        {
+          const double freq = (1 - interp) * left_block.freqs[i] + interp * right_block.freqs[j];
+          const double mag  = (1 - interp) * left_block.mags[i] + interp * right_block.mags[j];
+
+          out_audio_block.freqs.push_back (sm_round_positive (freq));
+          out_audio_block.mags.push_back (sm_round_positive (mag));
+
+          right_freqs[j].used = 1;
+        }
+      else
+        {
+          out_audio_block.freqs.push_back (left_block.freqs[i]);
+          out_audio_block.mags.push_back (sm_factor2idb ((1 - interp) * left_block.mags_f (i)));
+        }
+    }
+  for (size_t j = 0; j < right_freqs_size; j++)
+    {
+      if (!right_freqs[j].used)
+        {
+          out_audio_block.freqs.push_back (right_block.freqs[j]);
+          out_audio_block.mags.push_back (sm_factor2idb (interp * right_block.mags_f (j)));
+        }
+    }
+  out_audio_block.sort_freqs();
+
+  if (left_block.noise.size() == right_block.noise.size())
+    {
+      out_audio_block.noise.resize (left_block.noise.size());
+
+      for (size_t i = 0; i < left_block.noise.size(); i++)
+        out_audio_block.noise[i] = sm_round_positive ((1 - interp) * left_block.noise[i] + interp * right_block.noise[i]);
+    }
+  else
+    {
+      out_audio_block.noise = left_block.noise;
+    }
+}
+
 }
 
 }
@@ -28,6 +28,8 @@ void init_freq_state (const std::vector<uint16_t>& fint, FreqState *freq_state);
 AudioBlock* get_normalized_block_ptr (LiveDecoderSource *source, double time_ms);
 bool get_normalized_block (LiveDecoderSource *source, double time_ms, AudioBlock& out_audio_block);
 
+void interp_frames (const AudioBlock& left_block, const AudioBlock& right_block, double interp, AudioBlock& out_audio_block);
+
 }
 
 }
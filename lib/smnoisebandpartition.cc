@@ -9,6 +9,7 @@
 
 using namespace SpectMorph;
 using std::vector;
+using std::max;
 
 static double
 mel_to_hz (double mel)
@@ -65,6 +66,25 @@ NoiseBandPartition::NoiseBandPartition (size_t n_bands, size_t n_spectrum_bins,
           band_count[b]++;
         }
     }
+  /* for small spectrum sizes, the lowest bands contain no bins; to avoid
+   * losing their energy, add it to the bin nearest to the band center
+   */
+  const double bin_width_hz = mix_freq / n_spectrum_bins; /* same frequency mapping as above */
+  for (size_t band = 0; band < n_bands; band++)
+    {
+      if (band_count[band] == 0)
+        {
+          double hz_low = mel_to_hz (30 + 4000.0 / n_bands * band);
+          double hz_high = mel_to_hz (30 + 4000.0 / n_bands * (band + 1));
+
+          NarrowBand nb;
+          nb.band   = band;
+          nb.d      = max (sm_round_positive ((hz_low + hz_high) / 2 / bin_width_hz), 1) * 2;
+          nb.weight = (hz_high - hz_low) / bin_width_hz;
+          if (nb.d + 1 < n_spectrum_bins)
+            narrow_bands.push_back (nb);
+        }
+    }
 }
 
 size_t
@@ -110,4 +130,27 @@ NoiseBandPartition::noise_envelope_to_spectrum (Random& random_gen, const vector
           spectrum[d+1] = int_sinf (r) * value;
         }
     }
+  for (const auto& nb : narrow_bands)
+    {
+      const float value = sm_idb2factor (envelope[nb.band]) * scale;
+      const float extra_energy = value * value * nb.weight;
+
+      const size_t d = nb.d;
+      const float energy = spectrum[d] * spectrum[d] + spectrum[d + 1] * spectrum[d + 1];
+      if (energy > 0)
+        {
+          const float factor = sqrtf ((energy + extra_energy) / energy);
+
+          spectrum[d]   *= factor;
+          spectrum[d+1] *= factor;
+        }
+      else
+        {
+          const guint8 r = random_data_byte[d / 2];
+          const float  mag = sqrtf (extra_energy);
+
+          spectrum[d]   = int_cosf (r) * mag;
+          spectrum[d+1] = int_sinf (r) * mag;
+        }
+    }
 }
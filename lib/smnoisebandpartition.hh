@@ -18,6 +18,15 @@ class NoiseBandPartition
   std::vector<int> band_start;
   size_t           spectrum_size;
 
+  /* bands which are narrower than one spectrum bin (small block sizes) */
+  struct NarrowBand
+  {
+    size_t band;
+    size_t d;         // spectrum bin index (real part) nearest to the band center
+    float  weight;    // band width / bin width
+  };
+  std::vector<NarrowBand> narrow_bands;
+
 public:
   NoiseBandPartition (size_t n_bands, size_t n_spectrum_bins, double mix_freq);
   void noise_envelope_to_spectrum (SpectMorph::Random& random_gen, const std::vector<uint16_t>& envelope, float *spectrum, double scale);
@@ -70,12 +70,14 @@ NoiseDecoder::set_seed (int seed)
  * fills the decoded_residue vector of the frame.
  *
  * \param audio_block   AudioBlock to be decoded
+ * \param spectrum_gain optional gain for each of the block_size / 2 + 1 spectrum bins (filter)
  */
 void
 NoiseDecoder::process (const AudioBlock& audio_block,
                        float            *samples,
                        OutputMode        output_mode,
-                       float             portamento_stretch)
+                       float             portamento_stretch,
+                       const float      *spectrum_gain)
 {
   if (!noise_band_partition)
     noise_band_partition = new NoiseBandPartition (audio_block.noise.size(), block_size + 2, mix_freq);
@@ -97,6 +99,14 @@ NoiseDecoder::process (const AudioBlock& audio_block,
 
       zero_float_block (block_size + 2 - boundary, interpolated_spectrum + boundary);
     }
+  if (spectrum_gain)
+    {
+      for (size_t d = 0; d < block_size + 2; d += 2)
+        {
+          interpolated_spectrum[d]     *= spectrum_gain[d / 2];
+          interpolated_spectrum[d + 1] *= spectrum_gain[d / 2];
+        }
+    }
 
   interpolated_spectrum[1] = interpolated_spectrum[block_size];
   if (output_mode == FFT_SPECTRUM)
@@ -36,7 +36,8 @@ public:
   void process (const AudioBlock& audio_block,
                 float *samples,
                 OutputMode output_mode = REPLACE,
-                float portamento_stretch = 1.0);
+                float portamento_stretch = 1.0,
+                const float *spectrum_gain = nullptr);
 
   static size_t preferred_block_size (double mix_freq);
 };
@@ -0,0 +1,200 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smoscbanksynth.hh"
+#include "smmath.hh"
+
+#include <map>
+#include <mutex>
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+using namespace SpectMorph;
+
+using std::min;
+using std::map;
+using std::vector;
+
+/* four floats, computed with SIMD instructions */
+typedef float Float4 __attribute__ ((vector_size (16)));
+
+static inline Float4
+load_float4 (const float *p)
+{
+  Float4 v;
+  memcpy (&v, p, sizeof (v));
+  return v;
+}
+
+static inline void
+store_float4 (float *p, const Float4& v)
+{
+  memcpy (p, &v, sizeof (v));
+}
+
+/* windows are shared by all instances with the same block size (LiveDecoders may run in different threads) */
+static std::mutex                 cos_window_mutex;
+static map<size_t, vector<float>> cos_window_for_block_size;
+
+static const float *
+cos_window (size_t block_size)
+{
+  std::lock_guard<std::mutex> lg (cos_window_mutex);
+
+  /* map entries are never removed, so the pointer stays valid */
+  vector<float>& win = cos_window_for_block_size[block_size];
+  if (win.empty())
+    {
+      win.resize (block_size);
+      for (size_t i = 0; i < block_size; i++)
+        win[i] = window_cos (2.0 * i / block_size - 1.0);
+    }
+  return &win[0];
+}
+
+OscBankSynth::OscBankSynth (size_t block_size, double mix_freq) :
+  block_size (block_size),
+  mix_freq (mix_freq),
+  osc_out (block_size)
+{
+  assert (block_size % 16 == 0);
+
+  /* same quantization as IFFTSynth (zero_padding = 256) */
+  freq256_factor = 1 / mix_freq * block_size * 256;
+
+  /* same window as IFFTSynth output with WIN_HANNING */
+  window = cos_window (block_size);
+}
+
+void
+OscBankSynth::clear_partials()
+{
+  zero_float_block (block_size, &osc_out[0]);
+}
+
+void
+OscBankSynth::render_partial_iphase (double mf_freq, double mag, uint32_t iphase)
+{
+  render_freq256 (sm_round_positive (mf_freq * freq256_factor), mag, iphase);
+}
+
+void
+OscBankSynth::render_partials_iphase (size_t n_partials, const double *freqs, double mag, const uint32_t *iphases)
+{
+  for (size_t i = 0; i < n_partials; i++)
+    render_freq256 (sm_round_positive (freqs[i] * freq256_factor), mag, iphases[i]);
+}
+
+/*
+ * Adds mag * sin (phase + i * omega) to osc_out
+ *
+ * The oscillator bank uses the recursion
+ *
+ *   y[i + 16] = 2 * cos (16 * omega) * y[i] - y[i - 16]
+ *
+ * which has 16 independent lanes (computed as four Float4 vectors), so only one
+ * multiplication and one subtraction per output sample are necessary.
+ */
+void
+OscBankSynth::render_freq256 (int freq256, double mag, uint32_t iphase)
+{
+  const int    LANES = 16;
+  const int    VECS = LANES / 4;
+  const size_t RESYNC = 256; /* recompute oscillator state every RESYNC samples to avoid error accumulation */
+
+  const double phase = sm_iphase2phase (iphase);
+  const double omega = freq256 * (2 * M_PI / 256.0) / block_size;
+
+  /* lane_re[k / 4][k % 4] + i * lane_im[k / 4][k % 4] = exp (i * omega * (k - LANES)) */
+  Float4 lane_re[2 * VECS], lane_im[2 * VECS];
+  double inc_re, inc_im, l_re, l_im;
+
+  sm_sincos (omega, &inc_im, &inc_re);
+  sm_sincos (-omega * LANES, &l_im, &l_re);
+  for (int k = 0; k < 2 * LANES; k++)
+    {
+      lane_re[k / 4][k % 4] = l_re;
+      lane_im[k / 4][k % 4] = l_im;
+
+      const double new_l_re = l_re * inc_re - l_im * inc_im;
+      l_im = l_re * inc_im + l_im * inc_re;
+      l_re = new_l_re;
+    }
+  const Float4 c = Float4{} + float (2 * cos (omega * LANES));
+
+  /* z_re + i * z_im = mag * exp (i * (phase + omega * pos)), advanced in double precision */
+  double z_re, z_im, resync_re, resync_im;
+  sm_sincos (phase, &z_im, &z_re);
+  sm_sincos (omega * RESYNC, &resync_im, &resync_re);
+  z_re *= mag;
+  z_im *= mag;
+
+  for (size_t pos = 0; pos < block_size; pos += RESYNC)
+    {
+      /* prev: samples [pos - LANES, pos - 1], cur: samples [pos, pos + LANES - 1] */
+      const Float4 zv_re = Float4{} + float (z_re);
+      const Float4 zv_im = Float4{} + float (z_im);
+
+      Float4 prev[VECS], cur[VECS];
+      for (int j = 0; j < VECS; j++)
+        {
+          prev[j] = zv_re * lane_im[j] + zv_im * lane_re[j];
+          cur[j]  = zv_re * lane_im[j + VECS] + zv_im * lane_re[j + VECS];
+        }
+
+      float *out = &osc_out[pos];
+      const size_t todo = min (RESYNC, block_size - pos);
+      for (size_t i = 0; i < todo; i += LANES)
+        {
+          for (int j = 0; j < VECS; j++)
+            {
+              store_float4 (out + i + 4 * j, load_float4 (out + i + 4 * j) + cur[j]);
+
+              const Float4 next = c * cur[j] - prev[j];
+              prev[j] = cur[j];
+              cur[j] = next;
+            }
+        }
+      const double new_z_re = z_re * resync_re - z_im * resync_im;
+      z_im = z_re * resync_im + z_im * resync_re;
+      z_re = new_z_re;
+    }
+}
+
+void
+OscBankSynth::get_samples (float *samples, IFFTSynth::OutputMode output_mode)
+{
+  const float *out = &osc_out[0];
+
+  if (output_mode == IFFTSynth::REPLACE)
+    {
+      for (size_t i = 0; i < block_size; i++)
+        samples[i] = out[i] * window[i];
+    }
+  else if (output_mode == IFFTSynth::ADD)
+    {
+      for (size_t i = 0; i < block_size; i++)
+        samples[i] += out[i] * window[i];
+    }
+  else
+    {
+      assert (false);
+    }
+}
+
+/*
+ * Estimate whether rendering n_partials with the oscillator bank is faster than
+ * rendering them with IFFTSynth (inverse FFT + window + overlap-add).
+ *
+ * The costs are rough per sample estimates, relative to the cost of computing
+ * one sample of one partial using the oscillator bank; the benchmark in
+ * tests/testoscbankperf can be used to check the crossover point on a given machine.
+ */
+bool
+OscBankSynth::faster_than_ifft (size_t block_size, size_t n_partials)
+{
+  const double ifft_cost = 0.4 * log2 (block_size) + 1.5;
+
+  return n_partials < ifft_cost;
+}
@@ -0,0 +1,46 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#ifndef SPECTMORPH_OSC_BANK_SYNTH_HH
+#define SPECTMORPH_OSC_BANK_SYNTH_HH
+
+#include <sys/types.h>
+#include <vector>
+
+#include "smifftsynth.hh"
+#include "smalignedarray.hh"
+
+namespace SpectMorph {
+
+/*
+ * Time domain version of IFFTSynth (with WIN_HANNING): the partials are
+ * computed by a bank of recursive oscillators, and the output frame has the
+ * same window, quantized frequencies and phases as the IFFTSynth output
+ *
+ * This is faster than IFFTSynth if only a few partials need to be rendered.
+ */
+class OscBankSynth
+{
+  size_t                    block_size;
+  double                    mix_freq;
+  double                    freq256_factor;
+
+  AlignedArray<float, 16>   osc_out;
+  const float              *window;
+
+  void render_freq256 (int freq256, double mag, uint32_t iphase);
+
+public:
+  OscBankSynth (size_t block_size, double mix_freq);
+
+  void clear_partials();
+
+  void render_partial_iphase (double freq, double mag, uint32_t iphase);
+  void render_partials_iphase (size_t n_partials, const double *freqs, double mag, const uint32_t *iphases);
+  void get_samples (float *samples, IFFTSynth::OutputMode output_mode = IFFTSynth::REPLACE);
+
+  static bool faster_than_ifft (size_t block_size, size_t n_partials);
+};
+
+}
+
+#endif
@@ -3,6 +3,11 @@
 #ifdef __SSE__
 #include <xmmintrin.h>
 #endif
+/* AVX2 kernels are compiled for x86 only, and selected at runtime */
+#if defined (__SSE__) && defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define PANDA_RESAMPLER_AVX2_KERNEL 1
+#include <immintrin.h>
+#endif
 #include <math.h>
 #include <string.h>
 
@@ -34,12 +39,14 @@ PANDA_RESAMPLER_FN
 Resampler2::Resampler2 (Mode      mode,
                         uint      ratio,
                         Precision precision,
-                        bool      use_sse_if_available)
+                        bool      use_sse_if_available,
+                        bool      use_avx2_if_available)
 {
   mode_ = mode;
   ratio_ = ratio;
   precision_ = precision;
   use_sse_if_available_ = use_sse_if_available;
+  use_avx2_if_available_ = use_avx2_if_available;
 
   init_stage (impl_x2, 2);
   init_stage (impl_x4, 4);
@@ -57,11 +64,14 @@ Resampler2::init_stage (std::unique_ptr<Impl>& impl,
 
   if (sse_available() && use_sse_if_available_)
     {
-      impl.reset (create_impl<true> (stage_ratio));
+      if (avx2_available() && use_avx2_if_available_)
+        impl.reset (create_impl<true, true> (stage_ratio));
+      else
+        impl.reset (create_impl<true, false> (stage_ratio));
     }
   else
     {
-      impl.reset (create_impl<false> (stage_ratio));
+      impl.reset (create_impl<false, false> (stage_ratio));
     }
 }
 
@@ -76,6 +86,18 @@ Resampler2::sse_available()
 #endif
 }
 
+PANDA_RESAMPLER_FN
+bool
+Resampler2::avx2_available()
+{
+#ifdef PANDA_RESAMPLER_AVX2_KERNEL
+  static const bool avx2_fma = __builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma");
+  return avx2_fma;
+#else
+  return false;
+#endif
+}
+
 PANDA_RESAMPLER_FN
 Resampler2::Precision
 Resampler2::find_precision_for_bits (uint bits)
@@ -475,6 +497,94 @@ fir_compute_sse_taps (const vector<float>& taps)
   return sse_taps;
 }
 
+/*
+ * FIR filter routine for 8 samples simultaneously
+ *
+ * This is the AVX2 version of fir_process_4samples_sse, which uses FMA
+ * instructions and computes eight consecutive output values at once. Input
+ * doesn't need to be aligned, avx2_taps need to be 32-byte aligned, and need
+ * to be computed with fir_compute_avx2_taps.
+ *
+ * Since the compiler flags don't enable AVX2, the function is compiled for
+ * AVX2 using the target attribute, and may only be called if avx2_available()
+ * returns true.
+ */
+#ifdef PANDA_RESAMPLER_AVX2_KERNEL
+__attribute__ ((target ("avx2,fma"))) static void
+fir_process_8samples_avx2 (const float *input,
+                           const float *avx2_taps,
+                           const uint   order,
+                           float       *out)
+{
+  const __m256 *avx2_taps_v = reinterpret_cast<const __m256 *> (avx2_taps);
+
+  const __m256 input_v = _mm256_loadu_ps (input);
+  __m256 out0_v = _mm256_mul_ps (input_v, avx2_taps_v[0]);
+  __m256 out1_v = _mm256_mul_ps (input_v, avx2_taps_v[1]);
+  __m256 out2_v = _mm256_mul_ps (input_v, avx2_taps_v[2]);
+  __m256 out3_v = _mm256_mul_ps (input_v, avx2_taps_v[3]);
+  __m256 out4_v = _mm256_mul_ps (input_v, avx2_taps_v[4]);
+  __m256 out5_v = _mm256_mul_ps (input_v, avx2_taps_v[5]);
+  __m256 out6_v = _mm256_mul_ps (input_v, avx2_taps_v[6]);
+  __m256 out7_v = _mm256_mul_ps (input_v, avx2_taps_v[7]);
+
+  for (uint i = 1; i < (order + 14) / 8; i++)
+    {
+      const __m256 in_v = _mm256_loadu_ps (input + i * 8);
+
+      out0_v = _mm256_fmadd_ps (in_v, avx2_taps_v[i * 8 + 0], out0_v);
+      out1_v = _mm256_fmadd_ps (in_v, avx2_taps_v[i * 8 + 1], out1_v);
+      out2_v = _mm256_fmadd_ps (in_v, avx2_taps_v[i * 8 + 2], out2_v);
+      out3_v = _mm256_fmadd_ps (in_v, avx2_taps_v[i * 8 + 3], out3_v);
+      out4_v = _mm256_fmadd_ps (in_v, avx2_taps_v[i * 8 + 4], out4_v);
+      out5_v = _mm256_fmadd_ps (in_v, avx2_taps_v[i * 8 + 5], out5_v);
+      out6_v = _mm256_fmadd_ps (in_v, avx2_taps_v[i * 8 + 6], out6_v);
+      out7_v = _mm256_fmadd_ps (in_v, avx2_taps_v[i * 8 + 7], out7_v);
+    }
+
+  /* horizontal sums: result[j] = sum of all elements of outj_v */
+  const __m256 h01 = _mm256_hadd_ps (out0_v, out1_v);
+  const __m256 h23 = _mm256_hadd_ps (out2_v, out3_v);
+  const __m256 h45 = _mm256_hadd_ps (out4_v, out5_v);
+  const __m256 h67 = _mm256_hadd_ps (out6_v, out7_v);
+  const __m256 h0123 = _mm256_hadd_ps (h01, h23); // [ 0 1 2 3 (low half) | 0 1 2 3 (high half) ]
+  const __m256 h4567 = _mm256_hadd_ps (h45, h67); // [ 4 5 6 7 (low half) | 4 5 6 7 (high half) ]
+  const __m256 result = _mm256_add_ps (_mm256_permute2f128_ps (h0123, h4567, 0x20),
+                                       _mm256_permute2f128_ps (h0123, h4567, 0x31));
+  _mm256_storeu_ps (out, result);
+}
+#else
+static inline void
+fir_process_8samples_avx2 (const float *input,
+                           const float *avx2_taps,
+                           const uint   order,
+                           float       *out)
+{
+  PANDA_RESAMPLER_CHECK(false); // should not be reached
+}
+#endif
+
+/*
+ * fir_compute_avx2_taps computes the tap ordering for fir_process_8samples_avx2,
+ * which is the same as for SSE (see fir_compute_sse_taps), but for eight outputs
+ * and vectors of eight floats
+ */
+static inline vector<float>
+fir_compute_avx2_taps (const vector<float>& taps)
+{
+  const int order = taps.size();
+  vector<float> avx2_taps ((order + 14) / 8 * 64);
+
+  for (int j = 0; j < 8; j++)
+    for (int i = 0; i < order; i++)
+      {
+        int k = i + j;
+        avx2_taps[(k / 8) * 64 + (k % 8) + j * 8] = taps[i];
+      }
+
+  return avx2_taps;
+}
+
 /*
  * This function tests the SSEified FIR filter code (that is, the reordering
  * done by fir_compute_sse_taps and the actual computation implemented in
@@ -542,6 +652,50 @@ fir_test_filter_sse (bool       verbose,
   return (errors == 0);
 }
 
+/*
+ * Tests the AVX2 FIR filter code, like fir_test_filter_sse.
+ */
+static inline bool
+fir_test_filter_avx2 (bool       verbose,
+                      const uint max_order = 64)
+{
+  int errors = 0;
+  if (verbose)
+    printf ("testing AVX2 filter implementation:\n\n");
+
+  for (uint order = 0; order < max_order; order++)
+    {
+      vector<float> taps (order);
+      for (uint i = 0; i < order; i++)
+        taps[i] = i + 1;
+
+      AlignedArray<float> avx2_taps (fir_compute_avx2_taps (taps));
+      AlignedArray<float> random_mem (order + 14);
+      for (uint i = 0; i < order + 14; i++)
+        random_mem[i] = 1.0 - rand() / (0.5 * RAND_MAX);
+
+      float out[8];
+      fir_process_8samples_avx2 (&random_mem[0], &avx2_taps[0], order, out);
+
+      double avg_diff = 0.0;
+      for (int i = 0; i < 8; i++)
+        {
+          double diff = fir_process_one_sample<double> (&random_mem[i], &taps[0], order) - out[i];
+          avg_diff += fabs (diff);
+        }
+      avg_diff /= (order + 1);
+      bool is_error = (avg_diff > 0.00001);
+      if (is_error || verbose)
+        printf ("*** order = %d, avg_diff = %g\n", order, avg_diff);
+      if (is_error)
+        errors++;
+    }
+  if (errors)
+    printf ("*** %d errors detected\n", errors);
+
+  return (errors == 0);
+}
+
 } // Aux
 
 using namespace Aux; // avoid anon namespace
@@ -552,13 +706,31 @@ using namespace Aux; // avoid anon namespace
  * Template arguments:
  *   ORDER     number of resampling filter coefficients
  *   USE_SSE   whether to use SSE (vectorized) instructions or not
+ *   USE_AVX2  whether to use AVX2/FMA instructions (for blocks of 8 samples)
  */
-template<uint ORDER, bool USE_SSE>
+template<uint ORDER, bool USE_SSE, bool USE_AVX2>
 class Resampler2::Upsampler2 final : public Resampler2::Impl {
   vector<float>       taps;
   AlignedArray<float> history;
   AlignedArray<float> sse_taps;
+  AlignedArray<float> avx2_taps;
 protected:
+  /* AVX2 optimized convolution */
+  void
+  process_8samples (const float *input,
+                    float       *output)
+  {
+    const uint H = (ORDER / 2); /* half the filter length */
+
+    float out[8];
+    fir_process_8samples_avx2 (input, &avx2_taps[0], ORDER, out);
+
+    for (uint k = 0; k < 8; k++)
+      {
+        output[2 * k] = out[k];
+        output[2 * k + 1] = input[H + k];
+      }
+  }
   /* fast SSE optimized convolution */
   void
   process_4samples_aligned (const float *input /* aligned */,
@@ -588,6 +760,17 @@ protected:
 			 float       *output)
   {
     uint i = 0;
+    if (USE_AVX2)
+      {
+        /* leave at least 4 samples for the SSE code, so that we don't read
+         * more input than the SSE code would
+         */
+        while (i + 11 < n_input_samples)
+          {
+            process_8samples (&input[i], &output[i * 2]);
+            i += 8;
+          }
+      }
     if (USE_SSE)
       {
 	while (i + 3 < n_input_samples)
@@ -627,7 +810,8 @@ public:
   Upsampler2 (float *init_taps) :
     taps (init_taps, init_taps + ORDER),
     history (2 * ORDER),
-    sse_taps (fir_compute_sse_taps (taps))
+    sse_taps (fir_compute_sse_taps (taps)),
+    avx2_taps (USE_AVX2 ? fir_compute_avx2_taps (taps) : vector<float>())
   {
     PANDA_RESAMPLER_CHECK ((ORDER & 1) == 0);    /* even order filter */
   }
@@ -681,21 +865,41 @@ public:
   {
     return USE_SSE;
   }
+  bool
+  avx2_enabled() const override
+  {
+    return USE_AVX2;
+  }
 };
 
 /*
  * Factor 2 downsampling of a data stream
  *
  * Template arguments:
- *   ORDER    number of resampling filter coefficients
- *   USE_SSE  whether to use SSE (vectorized) instructions or not
+ *   ORDER     number of resampling filter coefficients
+ *   USE_SSE   whether to use SSE (vectorized) instructions or not
+ *   USE_AVX2  whether to use AVX2/FMA instructions (for blocks of 8 samples)
  */
-template<uint ORDER, bool USE_SSE>
+template<uint ORDER, bool USE_SSE, bool USE_AVX2>
 class Resampler2::Downsampler2 final : public Resampler2::Impl {
   vector<float>        taps;
   AlignedArray<float> history_even;
   AlignedArray<float> history_odd;
   AlignedArray<float> sse_taps;
+  AlignedArray<float> avx2_taps;
+  /* AVX2 optimized convolution */
+  template<int ODD_STEPPING> void
+  process_8samples (const float *input_even,
+                    const float *input_odd,
+                    float       *output)
+  {
+    const uint H = (ORDER / 2) - 1; /* half the filter length */
+
+    fir_process_8samples_avx2 (input_even, &avx2_taps[0], ORDER, output);
+
+    for (uint k = 0; k < 8; k++)
+      output[k] += 0.5f * input_odd[(H + k) * ODD_STEPPING];
+  }
   /* fast SSE optimized convolution */
   template<int ODD_STEPPING> void
   process_4samples_aligned (const float *input_even /* aligned */,
@@ -727,6 +931,15 @@ class Resampler2::Downsampler2 final : public Resampler2::Impl {
 			 uint         n_output_samples)
   {
     uint i = 0;
+    if (USE_AVX2)
+      {
+        /* leave at least 4 samples for the SSE code (see Upsampler2) */
+        while (i + 11 < n_output_samples)
+          {
+            process_8samples<ODD_STEPPING> (&input_even[i], &input_odd[i * ODD_STEPPING], &output[i]);
+            i += 8;
+          }
+      }
     if (USE_SSE)
       {
 	while (i + 3 < n_output_samples)
@@ -776,7 +989,8 @@ public:
     taps (init_taps, init_taps + ORDER),
     history_even (2 * ORDER),
     history_odd (2 * ORDER),
-    sse_taps (fir_compute_sse_taps (taps))
+    sse_taps (fir_compute_sse_taps (taps)),
+    avx2_taps (USE_AVX2 ? fir_compute_avx2_taps (taps) : vector<float>())
   {
     PANDA_RESAMPLER_CHECK ((ORDER & 1) == 0);    /* even order filter */
   }
@@ -870,9 +1084,14 @@ public:
   {
     return USE_SSE;
   }
+  bool
+  avx2_enabled() const override
+  {
+    return USE_AVX2;
+  }
 };
 
-template<bool USE_SSE> Resampler2::Impl*
+template<bool USE_SSE, bool USE_AVX2> Resampler2::Impl*
 Resampler2::create_impl (uint stage_ratio)
 {
   // START generated code
@@ -932,9 +1151,9 @@ Resampler2::create_impl (uint stage_ratio)
     -1.896649020687189e-07,
   };
   if (stage_ratio == 2 && precision_ == 24 && mode_ == UP)
-    return create_impl_with_coeffs <Upsampler2<52, USE_SSE> > (coeffs2_24, 52, 2.0);
+    return create_impl_with_coeffs <Upsampler2<52, USE_SSE, USE_AVX2> > (coeffs2_24, 52, 2.0);
   if (stage_ratio == 2 && precision_ == 24 && mode_ == DOWN)
-    return create_impl_with_coeffs <Downsampler2<52, USE_SSE> > (coeffs2_24, 52, 1.0);
+    return create_impl_with_coeffs <Downsampler2<52, USE_SSE, USE_AVX2> > (coeffs2_24, 52, 1.0);
   static constexpr double coeffs4_24[16] =
   {
     -7.8113862062895476e-06,
@@ -955,9 +1174,9 @@ Resampler2::create_impl (uint stage_ratio)
     -7.8113862062895476e-06,
   };
   if (stage_ratio == 4 && precision_ == 24 && mode_ == UP)
-    return create_impl_with_coeffs <Upsampler2<16, USE_SSE> > (coeffs4_24, 16, 2.0);
+    return create_impl_with_coeffs <Upsampler2<16, USE_SSE, USE_AVX2> > (coeffs4_24, 16, 2.0);
   if (stage_ratio == 4 && precision_ == 24 && mode_ == DOWN)
-    return create_impl_with_coeffs <Downsampler2<16, USE_SSE> > (coeffs4_24, 16, 1.0);
+    return create_impl_with_coeffs <Downsampler2<16, USE_SSE, USE_AVX2> > (coeffs4_24, 16, 1.0);
   static constexpr double coeffs8_24[12] =
   {
     -3.0345557546583312e-05,
@@ -974,9 +1193,9 @@ Resampler2::create_impl (uint stage_ratio)
     -3.0345557546583312e-05,
   };
   if (stage_ratio == 8 && precision_ == 24 && mode_ == UP)
-    return create_impl_with_coeffs <Upsampler2<12, USE_SSE> > (coeffs8_24, 12, 2.0);
+    return create_impl_with_coeffs <Upsampler2<12, USE_SSE, USE_AVX2> > (coeffs8_24, 12, 2.0);
   if (stage_ratio == 8 && precision_ == 24 && mode_ == DOWN)
-    return create_impl_with_coeffs <Downsampler2<12, USE_SSE> > (coeffs8_24, 12, 1.0);
+    return create_impl_with_coeffs <Downsampler2<12, USE_SSE, USE_AVX2> > (coeffs8_24, 12, 1.0);
   static constexpr double coeffs2_20[42] =
   {
     2.4629216796772203e-06,
@@ -1023,9 +1242,9 @@ Resampler2::create_impl (uint stage_ratio)
     2.4629216796772203e-06,
   };
   if (stage_ratio == 2 && precision_ == 20 && mode_ == UP)
-    return create_impl_with_coeffs <Upsampler2<42, USE_SSE> > (coeffs2_20, 42, 2.0);
+    return create_impl_with_coeffs <Upsampler2<42, USE_SSE, USE_AVX2> > (coeffs2_20, 42, 2.0);
   if (stage_ratio == 2 && precision_ == 20 && mode_ == DOWN)
-    return create_impl_with_coeffs <Downsampler2<42, USE_SSE> > (coeffs2_20, 42, 1.0);
+    return create_impl_with_coeffs <Downsampler2<42, USE_SSE, USE_AVX2> > (coeffs2_20, 42, 1.0);
   static constexpr double coeffs4_20[14] =
   {
     4.3979674631863943e-05,
@@ -1044,9 +1263,9 @@ Resampler2::create_impl (uint stage_ratio)
     4.3979674631863943e-05,
   };
   if (stage_ratio == 4 && precision_ == 20 && mode_ == UP)
-    return create_impl_with_coeffs <Upsampler2<14, USE_SSE> > (coeffs4_20, 14, 2.0);
+    return create_impl_with_coeffs <Upsampler2<14, USE_SSE, USE_AVX2> > (coeffs4_20, 14, 2.0);
   if (stage_ratio == 4 && precision_ == 20 && mode_ == DOWN)
-    return create_impl_with_coeffs <Downsampler2<14, USE_SSE> > (coeffs4_20, 14, 1.0);
+    return create_impl_with_coeffs <Downsampler2<14, USE_SSE, USE_AVX2> > (coeffs4_20, 14, 1.0);
   static constexpr double coeffs8_20[10] =
   {
     0.00017230594713343064,
@@ -1061,9 +1280,9 @@ Resampler2::create_impl (uint stage_ratio)
     0.00017230594713343064,
   };
   if (stage_ratio == 8 && precision_ == 20 && mode_ == UP)
-    return create_impl_with_coeffs <Upsampler2<10, USE_SSE> > (coeffs8_20, 10, 2.0);
+    return create_impl_with_coeffs <Upsampler2<10, USE_SSE, USE_AVX2> > (coeffs8_20, 10, 2.0);
   if (stage_ratio == 8 && precision_ == 20 && mode_ == DOWN)
-    return create_impl_with_coeffs <Downsampler2<10, USE_SSE> > (coeffs8_20, 10, 1.0);
+    return create_impl_with_coeffs <Downsampler2<10, USE_SSE, USE_AVX2> > (coeffs8_20, 10, 1.0);
   static constexpr double coeffs2_16[32] =
   {
     -3.5142734993474452e-05,
@@ -1100,9 +1319,9 @@ Resampler2::create_impl (uint stage_ratio)
     -3.5142734993474452e-05,
   };
   if (stage_ratio == 2 && precision_ == 16 && mode_ == UP)
-    return create_impl_with_coeffs <Upsampler2<32, USE_SSE> > (coeffs2_16, 32, 2.0);
+    return create_impl_with_coeffs <Upsampler2<32, USE_SSE, USE_AVX2> > (coeffs2_16, 32, 2.0);
   if (stage_ratio == 2 && precision_ == 16 && mode_ == DOWN)
-    return create_impl_with_coeffs <Downsampler2<32, USE_SSE> > (coeffs2_16, 32, 1.0);
+    return create_impl_with_coeffs <Downsampler2<32, USE_SSE, USE_AVX2> > (coeffs2_16, 32, 1.0);
   static constexpr double coeffs4_16[10] =
   {
     0.00055713256761683592,
@@ -1117,9 +1336,9 @@ Resampler2::create_impl (uint stage_ratio)
     0.00055713256761683592,
   };
   if (stage_ratio == 4 && precision_ == 16 && mode_ == UP)
-    return create_impl_with_coeffs <Upsampler2<10, USE_SSE> > (coeffs4_16, 10, 2.0);
+    return create_impl_with_coeffs <Upsampler2<10, USE_SSE, USE_AVX2> > (coeffs4_16, 10, 2.0);
   if (stage_ratio == 4 && precision_ == 16 && mode_ == DOWN)
-    return create_impl_with_coeffs <Downsampler2<10, USE_SSE> > (coeffs4_16, 10, 1.0);
+    return create_impl_with_coeffs <Downsampler2<10, USE_SSE, USE_AVX2> > (coeffs4_16, 10, 1.0);
   static constexpr double coeffs8_16[8] =
   {
     -0.0010885239331601664,
@@ -1132,9 +1351,9 @@ Resampler2::create_impl (uint stage_ratio)
     -0.0010885239331601664,
   };
   if (stage_ratio == 8 && precision_ == 16 && mode_ == UP)
-    return create_impl_with_coeffs <Upsampler2<8, USE_SSE> > (coeffs8_16, 8, 2.0);
+    return create_impl_with_coeffs <Upsampler2<8, USE_SSE, USE_AVX2> > (coeffs8_16, 8, 2.0);
   if (stage_ratio == 8 && precision_ == 16 && mode_ == DOWN)
-    return create_impl_with_coeffs <Downsampler2<8, USE_SSE> > (coeffs8_16, 8, 1.0);
+    return create_impl_with_coeffs <Downsampler2<8, USE_SSE, USE_AVX2> > (coeffs8_16, 8, 1.0);
   static constexpr double coeffs2_12[24] =
   {
     -0.00031919473602139891,
@@ -1163,9 +1382,9 @@ Resampler2::create_impl (uint stage_ratio)
     -0.00031919473602139891,
   };
   if (stage_ratio == 2 && precision_ == 12 && mode_ == UP)
-    return create_impl_with_coeffs <Upsampler2<24, USE_SSE> > (coeffs2_12, 24, 2.0);
+    return create_impl_with_coeffs <Upsampler2<24, USE_SSE, USE_AVX2> > (coeffs2_12, 24, 2.0);
   if (stage_ratio == 2 && precision_ == 12 && mode_ == DOWN)
-    return create_impl_with_coeffs <Downsampler2<24, USE_SSE> > (coeffs2_12, 24, 1.0);
+    return create_impl_with_coeffs <Downsampler2<24, USE_SSE, USE_AVX2> > (coeffs2_12, 24, 1.0);
   static constexpr double coeffs4_12[8] =
   {
     -0.0025910542040449157,
@@ -1178,9 +1397,9 @@ Resampler2::create_impl (uint stage_ratio)
     -0.0025910542040449157,
   };
   if (stage_ratio == 4 && precision_ == 12 && mode_ == UP)
-    return create_impl_with_coeffs <Upsampler2<8, USE_SSE> > (coeffs4_12, 8, 2.0);
+    return create_impl_with_coeffs <Upsampler2<8, USE_SSE, USE_AVX2> > (coeffs4_12, 8, 2.0);
   if (stage_ratio == 4 && precision_ == 12 && mode_ == DOWN)
-    return create_impl_with_coeffs <Downsampler2<8, USE_SSE> > (coeffs4_12, 8, 1.0);
+    return create_impl_with_coeffs <Downsampler2<8, USE_SSE, USE_AVX2> > (coeffs4_12, 8, 1.0);
   static constexpr double coeffs8_12[6] =
   {
     0.005872148420194066,
@@ -1191,9 +1410,9 @@ Resampler2::create_impl (uint stage_ratio)
     0.005872148420194066,
   };
   if (stage_ratio == 8 && precision_ == 12 && mode_ == UP)
-    return create_impl_with_coeffs <Upsampler2<6, USE_SSE> > (coeffs8_12, 6, 2.0);
+    return create_impl_with_coeffs <Upsampler2<6, USE_SSE, USE_AVX2> > (coeffs8_12, 6, 2.0);
   if (stage_ratio == 8 && precision_ == 12 && mode_ == DOWN)
-    return create_impl_with_coeffs <Downsampler2<6, USE_SSE> > (coeffs8_12, 6, 1.0);
+    return create_impl_with_coeffs <Downsampler2<6, USE_SSE, USE_AVX2> > (coeffs8_12, 6, 1.0);
   static constexpr double coeffs2_8[16] =
   {
     -0.0026367453410967019,
@@ -1214,9 +1433,9 @@ Resampler2::create_impl (uint stage_ratio)
     -0.0026367453410967019,
   };
   if (stage_ratio == 2 && precision_ == 8 && mode_ == UP)
-    return create_impl_with_coeffs <Upsampler2<16, USE_SSE> > (coeffs2_8, 16, 2.0);
+    return create_impl_with_coeffs <Upsampler2<16, USE_SSE, USE_AVX2> > (coeffs2_8, 16, 2.0);
   if (stage_ratio == 2 && precision_ == 8 && mode_ == DOWN)
-    return create_impl_with_coeffs <Downsampler2<16, USE_SSE> > (coeffs2_8, 16, 1.0);
+    return create_impl_with_coeffs <Downsampler2<16, USE_SSE, USE_AVX2> > (coeffs2_8, 16, 1.0);
   static constexpr double coeffs4_8[6] =
   {
     0.013331613494158878,
@@ -1227,9 +1446,9 @@ Resampler2::create_impl (uint stage_ratio)
     0.013331613494158878,
   };
   if (stage_ratio == 4 && precision_ == 8 && mode_ == UP)
-    return create_impl_with_coeffs <Upsampler2<6, USE_SSE> > (coeffs4_8, 6, 2.0);
+    return create_impl_with_coeffs <Upsampler2<6, USE_SSE, USE_AVX2> > (coeffs4_8, 6, 2.0);
   if (stage_ratio == 4 && precision_ == 8 && mode_ == DOWN)
-    return create_impl_with_coeffs <Downsampler2<6, USE_SSE> > (coeffs4_8, 6, 1.0);
+    return create_impl_with_coeffs <Downsampler2<6, USE_SSE, USE_AVX2> > (coeffs4_8, 6, 1.0);
   static constexpr double coeffs8_8[4] =
   {
     -0.037276258261764332,
@@ -1238,14 +1457,14 @@ Resampler2::create_impl (uint stage_ratio)
     -0.037276258261764332,
   };
   if (stage_ratio == 8 && precision_ == 8 && mode_ == UP)
-    return create_impl_with_coeffs <Upsampler2<4, USE_SSE> > (coeffs8_8, 4, 2.0);
+    return create_impl_with_coeffs <Upsampler2<4, USE_SSE, USE_AVX2> > (coeffs8_8, 4, 2.0);
   if (stage_ratio == 8 && precision_ == 8 && mode_ == DOWN)
-    return create_impl_with_coeffs <Downsampler2<4, USE_SSE> > (coeffs8_8, 4, 1.0);
+    return create_impl_with_coeffs <Downsampler2<4, USE_SSE, USE_AVX2> > (coeffs8_8, 4, 1.0);
   // END generated code
   if (precision_ == PREC_LINEAR && mode_ == UP)
-    return create_impl_with_coeffs <Upsampler2<2, USE_SSE> > (halfband_fir_linear_coeffs, 2, 2.0);
+    return create_impl_with_coeffs <Upsampler2<2, USE_SSE, USE_AVX2> > (halfband_fir_linear_coeffs, 2, 2.0);
   if (precision_ == PREC_LINEAR && mode_ == DOWN)
-    return create_impl_with_coeffs <Downsampler2<2, USE_SSE> > (halfband_fir_linear_coeffs, 2, 1.0);
+    return create_impl_with_coeffs <Downsampler2<2, USE_SSE, USE_AVX2> > (halfband_fir_linear_coeffs, 2, 1.0);
   return 0;
 }
 
@@ -1255,7 +1474,10 @@ Resampler2::test_filter_impl (bool verbose)
 {
   if (sse_available())
     {
-      return fir_test_filter_sse (verbose);
+      bool ok = fir_test_filter_sse (verbose);
+      if (avx2_available())
+        ok = fir_test_filter_avx2 (verbose) && ok;
+      return ok;
     }
   else
     {
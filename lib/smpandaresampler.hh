@@ -103,6 +103,7 @@ class Resampler2 {
     virtual double delay() const = 0;
     virtual void   reset() = 0;
     virtual bool   sse_enabled() const = 0;
+    virtual bool   avx2_enabled() const = 0;
     virtual
     ~Impl()
     {
@@ -113,9 +114,9 @@ class Resampler2 {
   std::unique_ptr<Impl> impl_x8;
   uint                  ratio_;
 
-  template<uint ORDER, bool USE_SSE>
+  template<uint ORDER, bool USE_SSE, bool USE_AVX2>
   class Upsampler2;
-  template<uint ORDER, bool USE_SSE>
+  template<uint ORDER, bool USE_SSE, bool USE_AVX2>
   class Downsampler2;
 public:
   enum Mode {
@@ -134,18 +135,26 @@ protected:
   Mode      mode_;
   Precision precision_;
   bool      use_sse_if_available_;
+  bool      use_avx2_if_available_;
 public:
   /**
    * creates a resampler instance fulfilling a given specification
+   *
+   * the AVX2 kernels are only used if SSE is used, too
    */
   Resampler2 (Mode      mode,
               uint      ratio,
               Precision precision,
-              bool      use_sse_if_available = true);
+              bool      use_sse_if_available = true,
+              bool      use_avx2_if_available = true);
   /**
    * returns true if an optimized SSE version of the Resampler is available
    */
   static bool        sse_available();
+  /**
+   * returns true if the CPU we're running on supports AVX2 and FMA (runtime check)
+   */
+  static bool        avx2_available();
   /**
    * test internal filter implementation
    */
@@ -263,6 +272,14 @@ public:
   {
     return impl_x2->sse_enabled();
   }
+  /**
+   * return whether the resampler is using avx2 optimized code
+   */
+  bool
+  avx2_enabled() const
+  {
+    return impl_x2->avx2_enabled();
+  }
 protected:
   /* Creates implementation from filter coefficients and Filter implementation class
    *
@@ -285,12 +302,13 @@ protected:
     return filter;
   }
   /* creates the actual implementation; specifying USE_SSE=true will use
-   * SSE instructions, USE_SSE=false will use FPU instructions
+   * SSE instructions, USE_SSE=false will use FPU instructions; USE_AVX2=true
+   * (requires USE_SSE=true) will additionally use AVX2/FMA instructions
    *
    * Don't use this directly - it's only to be used by
    * bseblockutils.cc's anonymous Impl classes.
    */
-  template<bool USE_SSE> inline Impl*
+  template<bool USE_SSE, bool USE_AVX2> inline Impl*
   create_impl (uint stage_ratio);
 
   void
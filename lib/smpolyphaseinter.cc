@@ -4,6 +4,7 @@
 #include "smmath.hh"
 
 #include <math.h>
+#include <string.h>
 
 using namespace SpectMorph;
 
@@ -15,6 +16,20 @@ using std::vector;
 /* set this to at least WIDTH + 2, no problem if it is a little too high */
 #define MIN_PADDING 16
 
+/* coefficients for each oversampling step are padded with zeros from 2 * WIDTH to X_STRIDE values */
+#define X_STRIDE    16
+
+/* four floats, computed with SIMD instructions */
+typedef float Float4 __attribute__ ((vector_size (16)));
+
+static inline Float4
+load_float4 (const float *p)
+{
+  Float4 v;
+  memcpy (&v, p, sizeof (v)); // unaligned load
+  return v;
+}
+
 #include "smpolyphasecoeffs.cc"
 
 PolyPhaseInter*
@@ -59,23 +74,101 @@ PolyPhaseInter::get_sample (const vector<float>& signal, double pos)
 
 double
 PolyPhaseInter::get_sample_no_check (const vector<float>& signal, double pos)
+{
+  return interpolate (&signal[0], pos);
+}
+
+inline float
+PolyPhaseInter::interpolate (const float *signal, double pos) const
 {
   const int ipos = pos;
 
   const int frac64 = (pos - ipos) * OVERSAMPLE;
   const float frac = (pos - ipos) * OVERSAMPLE - frac64;
 
-  const float *x_a = &x[(WIDTH * 2) * (OVERSAMPLE - frac64)];
-  const float *x_b = &x[(WIDTH * 2) * ((OVERSAMPLE * 2 - frac64 - 1) & (OVERSAMPLE - 1))];
+  const float *x_a = &x[X_STRIDE * (OVERSAMPLE - frac64)];
+  const float *x_b = &x[X_STRIDE * ((OVERSAMPLE * 2 - frac64 - 1) & (OVERSAMPLE - 1))];
   const float *s_ptr = &signal[ipos - WIDTH + 1];
 
-  float result_a = 0, result_b = 0;
-  for (int j = 0; j < 2 * WIDTH; j++)
+  /* interpolate between the coefficients of both oversampling steps first, so
+   * that only one dot product is necessary (the padding coefficients are zero,
+   * the signal is read up to ipos + WIDTH + 2)
+   */
+  Float4 result = Float4{};
+  for (int j = 0; j < X_STRIDE; j += 4)
+    {
+      const Float4 a = load_float4 (x_a + j);
+      const Float4 b = load_float4 (x_b + j);
+
+      result += load_float4 (s_ptr + j) * (a + (b - a) * frac);
+    }
+  return result[0] + result[1] + result[2] + result[3];
+}
+
+/*
+ * Block version of get_sample(): out[i] = get_sample (signal, pos[i])
+ */
+void
+PolyPhaseInter::get_samples (const vector<float>& signal, const double *pos, size_t n_values, float *out)
+{
+  if (!n_values)
+    return;
+
+  /* fast path: all positions are far enough away from the signal boundaries */
+  double min_pos = pos[0], max_pos = pos[0];
+  for (size_t i = 1; i < n_values; i++)
+    {
+      min_pos = std::min (min_pos, pos[i]);
+      max_pos = std::max (max_pos, pos[i]);
+    }
+  if (min_pos >= MIN_PADDING && int (max_pos) + MIN_PADDING <= int (signal.size()))
+    {
+      get_samples_no_check (signal, pos, n_values, out);
+    }
+  else
+    {
+      for (size_t i = 0; i < n_values; i++)
+        out[i] = get_sample (signal, pos[i]);
+    }
+}
+
+/*
+ * Block version of get_sample() for a constant increment:
+ *
+ *   out[i] = get_sample (signal, pos + i * inc)
+ *
+ * \returns position after the last output sample (pos + n_values * inc)
+ */
+double
+PolyPhaseInter::get_samples (const vector<float>& signal, double pos, double inc, size_t n_values, float *out)
+{
+  const size_t BLOCK_SIZE = 256;
+
+  double block_pos[BLOCK_SIZE];
+  size_t i = 0;
+  while (i < n_values)
     {
-      result_a += s_ptr[j] * x_a[j];
-      result_b += s_ptr[j] * x_b[j];
+      const size_t todo = std::min (n_values - i, BLOCK_SIZE);
+
+      for (size_t k = 0; k < todo; k++)
+        block_pos[k] = pos + (i + k) * inc;
+
+      get_samples (signal, block_pos, todo, out + i);
+      i += todo;
     }
-  return result_a * (1 - frac) + result_b * frac;
+  return pos + n_values * inc;
+}
+
+/*
+ * Block version of get_sample_no_check(): out[i] = get_sample_no_check (signal, pos[i])
+ */
+void
+PolyPhaseInter::get_samples_no_check (const vector<float>& signal, const double *pos, size_t n_values, float *out)
+{
+  const float *signal_ptr = &signal[0];
+
+  for (size_t i = 0; i < n_values; i++)
+    out[i] = interpolate (signal_ptr, pos[i]);
 }
 
 size_t
@@ -103,9 +196,9 @@ PolyPhaseInter::PolyPhaseInter()
     {
       int p = o - 1;
 
-      for (int n = 0; n < WIDTH * 2; n++)
+      for (int n = 0; n < X_STRIDE; n++)
         {
-          x.push_back (c_get (p));
+          x.push_back (n < WIDTH * 2 ? c_get (p) : 0);
           p += OVERSAMPLE;
         }
     }
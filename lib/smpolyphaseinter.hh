@@ -16,12 +16,17 @@ class PolyPhaseInter
 
   std::vector<float> x;
 
+  float interpolate (const float *signal, double pos) const;
 public:
   static PolyPhaseInter *the();
 
   double get_sample (const std::vector<float>& signal, double pos);
   double get_sample_no_check (const std::vector<float>& signal, double pos);
 
+  void   get_samples (const std::vector<float>& signal, const double *pos, size_t n_values, float *out);
+  double get_samples (const std::vector<float>& signal, double pos, double inc, size_t n_values, float *out);
+  void   get_samples_no_check (const std::vector<float>& signal, const double *pos, size_t n_values, float *out);
+
   size_t get_min_padding();
 };
 
@@ -0,0 +1,95 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smsemaphore.hh"
+
+#include <errno.h>
+#include <limits.h>
+
+#ifdef SM_OS_MACOS
+#include <dispatch/dispatch.h>
+#endif
+
+#ifdef SM_OS_WINDOWS
+#include <windows.h>
+#endif
+
+using namespace SpectMorph;
+
+#ifdef SM_OS_LINUX
+
+Semaphore::Semaphore()
+{
+  sem_init (&sem, 0, 0);
+}
+
+Semaphore::~Semaphore()
+{
+  sem_destroy (&sem);
+}
+
+void
+Semaphore::post()
+{
+  sem_post (&sem);
+}
+
+void
+Semaphore::wait()
+{
+  while (sem_wait (&sem) != 0 && errno == EINTR)
+    ;
+}
+
+#endif
+
+#ifdef SM_OS_MACOS
+
+Semaphore::Semaphore()
+{
+  sem = dispatch_semaphore_create (0);
+}
+
+Semaphore::~Semaphore()
+{
+  dispatch_release (dispatch_semaphore_t (sem));
+}
+
+void
+Semaphore::post()
+{
+  dispatch_semaphore_signal (dispatch_semaphore_t (sem));
+}
+
+void
+Semaphore::wait()
+{
+  dispatch_semaphore_wait (dispatch_semaphore_t (sem), DISPATCH_TIME_FOREVER);
+}
+
+#endif
+
+#ifdef SM_OS_WINDOWS
+
+Semaphore::Semaphore()
+{
+  sem = CreateSemaphore (NULL, 0, LONG_MAX, NULL);
+}
+
+Semaphore::~Semaphore()
+{
+  CloseHandle (sem);
+}
+
+void
+Semaphore::post()
+{
+  ReleaseSemaphore (sem, 1, NULL);
+}
+
+void
+Semaphore::wait()
+{
+  WaitForSingleObject (sem, INFINITE);
+}
+
+#endif
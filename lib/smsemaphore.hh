@@ -0,0 +1,39 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#ifndef SPECTMORPH_SEMAPHORE_HH
+#define SPECTMORPH_SEMAPHORE_HH
+
+#include "smutils.hh"
+
+#ifdef SM_OS_LINUX
+#include <semaphore.h>
+#endif
+
+namespace SpectMorph
+{
+
+/*
+ * Counting semaphore; post() is realtime safe, so it can be used to wake up a
+ * worker thread from the synthesis thread (without lost wakeups)
+ */
+class Semaphore
+{
+#ifdef SM_OS_LINUX
+  sem_t sem;
+#else
+  void *sem; // macOS: dispatch_semaphore_t, Windows: HANDLE
+#endif
+
+public:
+  Semaphore();
+  ~Semaphore();
+
+  void post();
+  void wait();
+
+  SPECTMORPH_CLASS_NON_COPYABLE (Semaphore);
+};
+
+}
+
+#endif
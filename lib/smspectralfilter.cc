@@ -0,0 +1,145 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smspectralfilter.hh"
+
+using namespace SpectMorph;
+
+using std::complex;
+
+SpectralFilter::SpectralFilter()
+{
+  set_mode (LadderVCFMode::LP4);
+  set_drive (0);
+  set_rate (48000);
+  set_mix_freq (48000);
+  set_params (24000, 0, 1);
+}
+
+void
+SpectralFilter::set_mode (LadderVCFMode new_mode)
+{
+  mode = new_mode;
+}
+
+/**
+ * Set filter drive; since the spectral filter has no distortion, this only
+ * affects the gain (like LadderVCF::set_drive for small input signals).
+ */
+void
+SpectralFilter::set_drive (double drive_db)
+{
+  const double drive_delta_db = 36;
+
+  pre_scale = db_to_factor (drive_db - drive_delta_db);
+  post_scale = std::max (1 / pre_scale, 1.0);
+}
+
+/**
+ * Set rate used for cutoff normalization (see LadderVCF::set_rate).
+ */
+void
+SpectralFilter::set_rate (double r)
+{
+  rate = r;
+}
+
+/**
+ * Set sample rate of the synthesized signal.
+ */
+void
+SpectralFilter::set_mix_freq (double new_mix_freq)
+{
+  mix_freq = new_mix_freq;
+}
+
+/**
+ * Set filter parameters, this should be done once per frame.
+ *
+ * \param cutoff     cutoff frequency in Hz
+ * \param resonance  resonance in range [0;1]
+ * \param new_mix    mix in range [0;1]
+ */
+void
+SpectralFilter::set_params (double cutoff, double resonance, double new_mix)
+{
+  /* same coefficients as LadderVCFNonLinear, which runs at 2 * mix_freq */
+  const double freq_scale = 0.5;
+  const double nyquist = rate * 0.5;
+
+  double fc = sm_clamp (cutoff * freq_scale / nyquist, 0.0, 1.0);
+  fc = M_PI * fc;
+
+  g = 0.9892 * fc - 0.4342 * fc * fc + 0.1381 * fc * fc * fc - 0.0202 * fc * fc * fc * fc;
+
+  res = sm_clamp (resonance, 0.0, 1.0);
+  res *= 1.0029 + 0.0526 * fc - 0.0926 * fc * fc + 0.0218 * fc * fc * fc;
+
+  mix = new_mix;
+}
+
+/*
+ * Each of the four filter stages computes
+ *
+ *   y[n] = y[n-1] + g * (x[n] / 1.3 + x[n-1] * 0.3 / 1.3 - y[n-1])
+ *
+ * and the input of the first stage is x0[n] = x[n] - 4 * res * (y4[n-1] - 0.5 * x[n]),
+ * so the transfer function of the filter can be computed analytically.
+ */
+complex<double>
+SpectralFilter::response (double freq) const
+{
+  const double omega = 2 * M_PI * freq / (2 * mix_freq);
+  const complex<double> z_inv = std::polar (1.0, -omega);
+
+  const complex<double> h1 = (g / 1.3) * (1.0 + 0.3 * z_inv) / (1.0 - (1 - g) * z_inv);
+  const complex<double> h2 = h1 * h1;
+  const complex<double> h4 = h2 * h2;
+  const complex<double> x0 = (1 + 2 * res) / (1.0 + 4 * res * z_inv * h4);
+
+  complex<double> h;
+  switch (mode)
+    {
+      case LadderVCFMode::LP1:
+        h = h1;
+        break;
+      case LadderVCFMode::LP2:
+        h = h2;
+        break;
+      case LadderVCFMode::LP3:
+        h = h2 * h1;
+        break;
+      case LadderVCFMode::LP4:
+      default:
+        h = h4;
+        break;
+    }
+  h *= x0 * pre_scale * post_scale;
+
+  return h * mix + (1 - mix);
+}
+
+/**
+ * Compute filter gain for a partial.
+ *
+ * \param freq partial frequency in Hz
+ * \returns magnitude of the filter response
+ */
+double
+SpectralFilter::gain (double freq) const
+{
+  return std::abs (response (freq));
+}
+
+/**
+ * Compute filter gain for FFT bins (for instance for noise synthesis).
+ *
+ * \param n_bins     number of bins
+ * \param bin_width  frequency distance between bins in Hz
+ * \param gains      output: magnitude of the filter response for each bin
+ */
+void
+SpectralFilter::gain_spectrum (size_t n_bins, double bin_width, float *gains) const
+{
+  for (size_t i = 0; i < n_bins; i++)
+    gains[i] = std::abs (response (i * bin_width));
+}
@@ -0,0 +1,49 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#ifndef SPECTMORPH_SPECTRAL_FILTER_HH
+#define SPECTMORPH_SPECTRAL_FILTER_HH
+
+#include "smladdervcf.hh"
+
+#include <complex>
+
+namespace SpectMorph
+{
+
+/**
+ * \brief Frequency domain version of the (oversampled) ladder filter
+ *
+ * Instead of filtering the output signal, this filter computes the frequency
+ * response of the linear ladder filter model, so that the magnitudes of sine
+ * partials and noise bins can be scaled before synthesis. Filter parameters
+ * are updated once per frame, and the filter has no distortion.
+ */
+class SpectralFilter
+{
+  LadderVCFMode mode;
+  double        pre_scale, post_scale;
+  double        rate;
+  double        mix_freq;
+
+  /* per frame parameters */
+  double        g;
+  double        res;
+  double        mix;
+
+  std::complex<double> response (double freq) const;
+public:
+  SpectralFilter();
+
+  void set_mode (LadderVCFMode new_mode);
+  void set_drive (double drive_db);
+  void set_rate (double r);
+  void set_mix_freq (double new_mix_freq);
+  void set_params (double cutoff, double resonance, double new_mix);
+
+  double gain (double freq) const;
+  void   gain_spectrum (size_t n_bins, double bin_width, float *gains) const;
+};
+
+}
+
+#endif
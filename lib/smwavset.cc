@@ -7,6 +7,7 @@
 
 #include <map>
 #include <set>
+#include <atomic>
 
 #include <assert.h>
 
@@ -17,6 +18,26 @@ using std::set;
 
 using namespace SpectMorph;
 
+struct WavSet::DemandLoadEntry
+{
+  enum { UNLOADED, REQUESTED, LOADING, LOADED };
+
+  Audio                     *audio = nullptr;
+  size_t                     blob_pos = 0;   // position of audio data in demand_load_filename
+  size_t                     blob_size = 0;
+  std::atomic<int>           state { UNLOADED };
+};
+
+static float
+freq_to_note (float freq)
+{
+  return 69 + 12 * log (freq / 440) / log (2);
+}
+
+WavSet::WavSet()
+{
+}
+
 Error
 WavSet::save (const string& filename, bool embed_models)
 {
@@ -88,6 +109,9 @@ WavSet::load (const string& filename, AudioLoadOptions load_options)
 {
   clear();        // delete old contents (if any)
 
+  if (load_options == AUDIO_SKIP_FRAMES)
+    demand_load_filename = filename;
+
   map<string, Audio *> blob_map;
 
   WavSetWave *wave = NULL;
@@ -101,7 +125,8 @@ WavSet::load (const string& filename, AudioLoadOptions load_options)
   if (ifile.file_type() != "SpectMorph::WavSet")
     return Error::Code::FORMAT_INVALID;
 
-  if (ifile.file_version() != SPECTMORPH_BINARY_FILE_VERSION)
+  if (ifile.file_version() < SPECTMORPH_BINARY_FILE_VERSION_MIN ||
+      ifile.file_version() > SPECTMORPH_BINARY_FILE_VERSION)
     return Error::Code::FORMAT_INVALID;
 
   while (ifile.event() != InFile::END_OF_FILE)
@@ -205,6 +230,17 @@ WavSet::load (const string& filename, AudioLoadOptions load_options)
 
                   delete blob_in; // close input file
 
+                  if (load_options == AUDIO_SKIP_FRAMES)
+                    {
+                      /* remember where the blob is to load the frames later (on demand) */
+                      DemandLoadEntry *entry = new DemandLoadEntry();
+                      entry->audio = wave->audio;
+                      entry->blob_pos = ifile.event_blob_pos();
+                      entry->blob_size = ifile.event_blob_size();
+
+                      demand_load_map[wave->audio].reset (entry);
+                    }
+
                   blob_map[ifile.event_blob_sum()] = wave->audio;
                 }
               else
@@ -262,6 +298,9 @@ WavSetWave::~WavSetWave()
 void
 WavSet::clear()
 {
+  demand_load_map.clear();
+  demand_load_filename.clear();
+
   set<Audio *> to_delete;
 
   for (vector<WavSetWave>::iterator wi = waves.begin(); wi != waves.end(); wi++)
@@ -288,3 +327,201 @@ WavSet::~WavSet()
 {
   clear();
 }
+
+/**
+ * Find the audio entry that should be used to play a note. For demand loaded
+ * wav sets, the best match may not be loaded yet; in this case loading it is
+ * requested, and the best match among the audio entries that are already loaded
+ * is returned instead (or nullptr if none is loaded).
+ *
+ * This function is realtime safe.
+ *
+ * \returns the audio entry to be used for playback, or nullptr if none is available
+ */
+Audio *
+WavSet::find_audio (int channel, float freq, int midi_velocity)
+{
+  Audio *best_audio = nullptr;
+  Audio *best_loaded_audio = nullptr;
+  float  best_diff = 1e10;
+  float  best_loaded_diff = 1e10;
+
+  const float note = freq_to_note (freq);
+
+  for (vector<WavSetWave>::iterator wi = waves.begin(); wi != waves.end(); wi++)
+    {
+      Audio *audio = wi->audio;
+      if (audio && wi->channel == channel &&
+                   wi->velocity_range_min <= midi_velocity &&
+                   wi->velocity_range_max >= midi_velocity)
+        {
+          const float diff = fabs (freq_to_note (audio->fundamental_freq) - note);
+
+          if (diff < best_diff)
+            {
+              best_diff = diff;
+              best_audio = audio;
+            }
+          if (diff < best_loaded_diff && audio_loaded (audio))
+            {
+              best_loaded_diff = diff;
+              best_loaded_audio = audio;
+            }
+        }
+    }
+  if (best_audio && request_audio (best_audio))
+    return best_audio;
+
+  return best_loaded_audio;
+}
+
+WavSet::DemandLoadEntry *
+WavSet::demand_load_entry (const Audio *audio)
+{
+  auto it = demand_load_map.find (audio);
+  if (it != demand_load_map.end())
+    return it->second.get();
+  else
+    return nullptr;
+}
+
+/**
+ * Check whether the frames of an audio entry are available (always true
+ * unless the wav set is demand loaded). This function is realtime safe.
+ */
+bool
+WavSet::audio_loaded (const Audio *audio)
+{
+  DemandLoadEntry *entry = demand_load_entry (audio);
+
+  return !entry || entry->state.load() == DemandLoadEntry::LOADED;
+}
+
+/**
+ * Request loading the frames of an audio entry. Loading is performed by
+ * load_requested(), which will usually be run in a background thread.
+ * This function is realtime safe.
+ *
+ * \returns true if the audio is already loaded
+ */
+bool
+WavSet::request_audio (const Audio *audio)
+{
+  DemandLoadEntry *entry = demand_load_entry (audio);
+  if (!entry)
+    return true;
+
+  int state = entry->state.load();
+  if (state == DemandLoadEntry::LOADED)
+    return true;
+
+  if (state == DemandLoadEntry::UNLOADED &&
+      entry->state.compare_exchange_strong (state, DemandLoadEntry::REQUESTED) &&
+      demand_load_notify)
+    {
+      demand_load_notify();
+    }
+  return false;
+}
+
+/**
+ * Request loading all audio entries for notes in the range [min_midi_note, max_midi_note].
+ */
+void
+WavSet::prefetch (int min_midi_note, int max_midi_note)
+{
+  for (auto& wave : waves)
+    {
+      if (wave.audio && wave.midi_note >= min_midi_note && wave.midi_note <= max_midi_note)
+        request_audio (wave.audio);
+    }
+}
+
+/**
+ * Load frames of all audio entries that have been requested (not realtime safe).
+ *
+ * \returns true if audio data was loaded
+ */
+bool
+WavSet::load_requested()
+{
+  /* the file is only opened while loading, so that many demand loaded wav sets
+   * don't need one open file each
+   */
+  std::unique_ptr<GenericIn> file;
+  bool loaded = false;
+  for (auto& it : demand_load_map)
+    {
+      DemandLoadEntry *entry = it.second.get();
+
+      int state = DemandLoadEntry::REQUESTED;
+      if (!entry->state.compare_exchange_strong (state, DemandLoadEntry::LOADING))
+        continue;
+
+      if (!file)
+        file.reset (GenericIn::open (demand_load_filename));
+
+      /* the synthesis thread may read the header while we're loading, so we
+       * load into a temporary object and only move the frames afterwards
+       */
+      Audio  frames_audio;
+      std::unique_ptr<GenericIn> blob_in;
+      if (file)
+        blob_in.reset (file->open_subfile (entry->blob_pos, entry->blob_size));
+
+      Error error = blob_in ? frames_audio.load (blob_in.get(), AUDIO_SKIP_DEBUG) : Error (Error::Code::FILE_NOT_FOUND);
+      if (error)
+        fprintf (stderr, "wavset: error loading audio data on demand: %s\n", error.message());
+
+      entry->audio->contents         = std::move (frames_audio.contents);
+      entry->audio->original_samples = std::move (frames_audio.original_samples);
+
+      entry->state.store (DemandLoadEntry::LOADED);
+      loaded = true;
+    }
+  return loaded;
+}
+
+/**
+ * Set function to be called if loading audio is requested (for instance to wake up
+ * a background thread which calls load_requested()); it must be realtime safe.
+ */
+void
+WavSet::set_demand_load_notify (const std::function<void()>& notify)
+{
+  demand_load_notify = notify;
+}
+
+/**
+ * Estimate memory used by this wav set. For demand loaded wav sets, only
+ * audio entries which are already loaded count (not realtime safe).
+ *
+ * \returns memory usage in bytes
+ */
+size_t
+WavSet::memory_usage()
+{
+  set<const Audio *> done;
+  size_t             bytes = sizeof (WavSet) + waves.capacity() * sizeof (WavSetWave);
+
+  for (auto& wave : waves)
+    {
+      const Audio *audio = wave.audio;
+
+      if (!audio || !done.insert (audio).second)
+        continue;
+
+      bytes += sizeof (Audio);
+      if (!audio_loaded (audio))
+        continue;
+
+      bytes += audio->original_samples.capacity() * sizeof (float);
+      bytes += audio->contents.capacity() * sizeof (AudioBlock);
+      for (const auto& block : audio->contents)
+        {
+          bytes += (block.noise.capacity() + block.freqs.capacity() + block.mags.capacity() + block.phases.capacity()) * sizeof (uint16_t);
+          bytes += (block.original_fft.capacity() + block.debug_samples.capacity()) * sizeof (float);
+        }
+    }
+  return bytes;
+}
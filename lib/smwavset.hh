@@ -5,6 +5,9 @@
 
 #include <vector>
 #include <string>
+#include <map>
+#include <memory>
+#include <functional>
 
 #include "smaudio.hh"
 
@@ -27,7 +30,15 @@ public:
 
 class WavSet
 {
+  struct DemandLoadEntry;
+
+  std::map<const Audio *, std::shared_ptr<DemandLoadEntry>> demand_load_map;
+  std::string                                               demand_load_filename;
+  std::function<void()>                                     demand_load_notify;
+
+  DemandLoadEntry *demand_load_entry (const Audio *audio);
 public:
+  WavSet();
   ~WavSet();
 
   std::string              name;
@@ -38,6 +49,16 @@ public:
 
   Error load (const std::string& filename, AudioLoadOptions load_options = AUDIO_LOAD_DEBUG);
   Error save (const std::string& filename, bool embed_models = false);
+
+  Audio *find_audio (int channel, float freq, int midi_velocity);
+  size_t memory_usage();
+
+  /* demand loading (only for wav sets loaded with AUDIO_SKIP_FRAMES) */
+  bool   audio_loaded (const Audio *audio);
+  bool   request_audio (const Audio *audio);
+  void   prefetch (int min_midi_note, int max_midi_note);
+  bool   load_requested();
+  void   set_demand_load_notify (const std::function<void()>& notify);
 };
 
 }
@@ -7,6 +7,8 @@
 #include "smaudiotool.hh"
 
 #include <mutex>
+#include <thread>
+#include <atomic>
 
 using namespace SpectMorph;
 
@@ -69,35 +71,81 @@ WavSetBuilder::killed()
   return kill_function && kill_function();
 }
 
+Audio *
+WavSetBuilder::encode_sample (const SampleData& sd)
+{
+  /* clipping */
+  const WavData& wav_data = sd.shared->wav_data();
+  assert (wav_data.n_channels() == 1);
+
+  /* if we have a loop, the loop end determines the real end of the recording */
+  int iclipend = wav_data.n_values();
+  if (sd.loop == Sample::Loop::NONE)
+    iclipend = sm_bound<int> (0, sm_round_positive (sd.clip_end_ms * wav_data.mix_freq() / 1000.0), wav_data.n_values());
+
+  int iclipstart = sm_bound<int> (0, sm_round_positive (sd.clip_start_ms * wav_data.mix_freq() / 1000.0), iclipend);
+
+  return InstEncCache::the()->encode (cache_group, wav_data, sd.shared->wav_data_hash(), sd.midi_note, iclipstart, iclipend, encoder_config, kill_function);
+}
+
 WavSet *
 WavSetBuilder::run()
 {
-  for (auto& sd : sample_data_vec)
-    {
-      /* clipping */
-      const WavData& wav_data = sd.shared->wav_data();
-      assert (wav_data.n_channels() == 1);
+  /* samples are encoded in parallel; results are stored by index, so the
+   * order of the waves doesn't depend on which encoder finishes first
+   */
+  vector<Audio *>     audio (sample_data_vec.size());
+  std::atomic<size_t> next_index { 0 };
+
+  auto worker = [&]() {
+    for (size_t i = next_index++; i < sample_data_vec.size(); i = next_index++)
+      {
+        if (killed())
+          break;
+
+        audio[i] = encode_sample (sample_data_vec[i]);
+      }
+  };
+
+  size_t n_threads = max_threads > 0 ? max_threads : std::max (std::thread::hardware_concurrency(), 1u);
+  n_threads = std::min (n_threads, sample_data_vec.size());
+
+  vector<std::thread> threads;
+  for (size_t t = 1; t < n_threads; t++)
+    threads.emplace_back (worker);
 
-      /* if we have a loop, the loop end determines the real end of the recording */
-      int iclipend = wav_data.n_values();
-      if (sd.loop == Sample::Loop::NONE)
-        iclipend = sm_bound<int> (0, sm_round_positive (sd.clip_end_ms * wav_data.mix_freq() / 1000.0), wav_data.n_values());
+  worker();
 
-      int iclipstart = sm_bound<int> (0, sm_round_positive (sd.clip_start_ms * wav_data.mix_freq() / 1000.0), iclipend);
+  for (auto& t : threads)
+    t.join();
 
+  bool complete = !killed();
+  for (auto a : audio)
+    {
+      if (!a) // killed?
+        complete = false;
+    }
+  if (!complete)
+    {
+      for (auto a : audio)
+        delete a;
+
+      return nullptr;
+    }
+
+  for (size_t i = 0; i < sample_data_vec.size(); i++)
+    {
+      const SampleData& sd = sample_data_vec[i];
 
       WavSetWave new_wave;
       new_wave.midi_note = sd.midi_note;
       new_wave.channel = 0;
       new_wave.velocity_range_min = 0;
       new_wave.velocity_range_max = 127;
-      new_wave.audio = InstEncCache::the()->encode (cache_group, wav_data, sd.shared->wav_data_hash(), sd.midi_note, iclipstart, iclipend, encoder_config, kill_function);
-
-      if (!new_wave.audio) // killed?
-        return nullptr;
+      new_wave.audio = audio[i];
 
       if (keep_samples)
-        new_wave.audio->original_samples = wav_data.samples(); // FIXME: clipping?
+        new_wave.audio->original_samples = sd.shared->wav_data().samples(); // FIXME: clipping?
 
       wav_set->waves.push_back (new_wave);
     }
@@ -111,12 +159,25 @@ WavSetBuilder::run()
   return result;
 }
 
+/**
+ * Set function that is used to check whether building should be aborted. Since
+ * samples are encoded by multiple threads, the function must be thread safe.
+ */
 void
 WavSetBuilder::set_kill_function (const std::function<bool()>& new_kill_function)
 {
   kill_function = new_kill_function;
 }
 
+/**
+ * Set maximum number of threads used for encoding samples (0: number of CPU cores).
+ */
+void
+WavSetBuilder::set_max_threads (int new_max_threads)
+{
+  max_threads = new_max_threads;
+}
+
 void
 WavSetBuilder::apply_loop_settings()
 {
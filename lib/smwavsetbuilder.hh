@@ -34,18 +34,21 @@ class WavSetBuilder
   Instrument::AutoTune       auto_tune;
   Instrument::EncoderConfig  encoder_config;
   bool keep_samples;
+  int  max_threads = 0;
 
   void apply_loop_settings();
   void apply_auto_volume();
   void apply_auto_tune();
 
-  void add_sample (const Sample *sample);
+  void   add_sample (const Sample *sample);
+  Audio *encode_sample (const SampleData& sd);
 public:
   WavSetBuilder (const Instrument *instrument, bool keep_samples);
   ~WavSetBuilder();
 
   void set_kill_function (const std::function<bool()>& kill_function);
   void set_cache_group (InstEncCache::Group *group);
+  void set_max_threads (int max_threads);
   WavSet *run();
 };
 
@@ -3,9 +3,13 @@
 #include "smwavsetrepo.hh"
 #include "smmain.hh"
 
+#include <algorithm>
+#include <atomic>
+
 using namespace SpectMorph;
 
 using std::string;
+using std::vector;
 
 WavSetRepo*
 WavSetRepo::the()
@@ -13,22 +17,267 @@ WavSetRepo::the()
   return Global::wav_set_repo();
 }
 
-WavSet*
+bool
+WavSetRepo::Entry::loaded() const
+{
+  return wav_set.wait_for (std::chrono::seconds (0)) == std::future_status::ready;
+}
+
+/**
+ * Get wav set from repo, loading it if necessary. The repo mutex is not held
+ * while loading, so different wav sets can be loaded by different threads at
+ * the same time; if the wav set is being loaded by another thread, this
+ * function waits until loading is complete.
+ */
+std::shared_ptr<WavSet>
 WavSetRepo::get (const string& filename)
 {
-  std::lock_guard<std::mutex> lock (mutex);
+  std::unique_lock<std::mutex> lock (mutex);
 
-  WavSet*& wav_set = wav_set_map[filename];
-  if (!wav_set)
+  for (auto it = wav_set_map.find (filename); it != wav_set_map.end(); it = wav_set_map.find (filename))
+    {
+      Entry& entry = it->second;
+      if (entry.loaded())
+        {
+          m_stats.hits++;
+
+          /* take reference while holding the lock, so evict_unused() can't free the wav set */
+          entry.last_use = ++use_counter;
+          return entry.wav_set.get();
+        }
+
+      /* still loading: wait without lock, then look up the entry again (it may have been evicted) */
+      std::shared_future<std::shared_ptr<WavSet>> future = entry.wav_set;
+      lock.unlock();
+      future.wait();
+      lock.lock();
+    }
+  Entry& entry = wav_set_map[filename];
+  entry.last_use = ++use_counter;
+
+  m_stats.misses++;
+
+  std::promise<std::shared_ptr<WavSet>> promise;
+  entry.wav_set = promise.get_future().share();
+
+  const bool entry_demand_load = demand_load;
+  lock.unlock();
+
+  std::shared_ptr<WavSet> wav_set = load_wav_set (filename, entry_demand_load);
+  const size_t bytes = wav_set->memory_usage();
+  promise.set_value (wav_set);
+
+  lock.lock();
+  /* entry is still in the map: it is referenced by wav_set, so it could not be evicted */
+  wav_set_map[filename].bytes = bytes;
+  evict_unused();
+
+  return wav_set;
+}
+
+/**
+ * Load a list of wav sets in parallel, for instance all wav sets required
+ * by a MorphPlan. Wav sets already in the repo will not be loaded again.
+ *
+ * \returns the wav sets (for keeping them alive until they are used)
+ */
+vector<std::shared_ptr<WavSet>>
+WavSetRepo::preload (const vector<string>& filenames)
+{
+  vector<string> todo = filenames;
+
+  std::sort (todo.begin(), todo.end());
+  todo.erase (std::unique (todo.begin(), todo.end()), todo.end());
+
+  vector<std::shared_ptr<WavSet>> wav_sets (todo.size());
+  std::atomic<size_t>             next_index { 0 };
+
+  auto worker = [&]() {
+    for (size_t i = next_index++; i < todo.size(); i = next_index++)
+      wav_sets[i] = get (todo[i]);
+  };
+
+  const size_t n_threads = std::min<size_t> (todo.size(), std::max (std::thread::hardware_concurrency(), 1u));
+
+  vector<std::thread> threads;
+  for (size_t t = 1; t < n_threads; t++)
+    threads.emplace_back (worker);
+
+  worker();
+
+  for (auto& t : threads)
+    t.join();
+
+  return wav_sets;
+}
+
+std::shared_ptr<WavSet>
+WavSetRepo::load_wav_set (const string& filename, bool demand_load)
+{
+  std::shared_ptr<WavSet> wav_set = std::make_shared<WavSet>();
+  if (demand_load)
+    {
+      /* only load headers here, frames are loaded by the loader thread when needed */
+      wav_set->load (filename, AUDIO_SKIP_FRAMES);
+      wav_set->set_demand_load_notify ([this]() { loader_sem.post(); });
+
+      std::lock_guard<std::mutex> loader_lock (loader_mutex);
+      loader_wav_sets.push_back ({ filename, wav_set });
+
+      if (!loader_thread.joinable())
+        loader_thread = std::thread (&WavSetRepo::loader_run, this);
+    }
+  else
     {
-      wav_set = new WavSet();
       wav_set->load (filename, AUDIO_SKIP_DEBUG);
     }
   return wav_set;
 }
 
+/* remove least recently used wav sets that are only referenced by the repo
+ * until the memory usage is within the budget
+ */
+void
+WavSetRepo::evict_unused()
+{
+  if (!memory_budget)
+    return;
+
+  struct Usage
+  {
+    uint64_t    last_use;
+    size_t      bytes;
+    std::string filename;
+  };
+  vector<Usage> usage;
+  size_t        total_bytes = 0;
+
+  for (auto& it : wav_set_map)
+    {
+      if (!it.second.loaded())
+        continue;
+
+      usage.push_back ({ it.second.last_use, it.second.bytes, it.first });
+      total_bytes += it.second.bytes;
+    }
+  std::sort (usage.begin(), usage.end(), [] (const Usage& a, const Usage& b) { return a.last_use < b.last_use; });
+
+  for (const auto& u : usage)
+    {
+      if (total_bytes <= memory_budget)
+        break;
+
+      auto it = wav_set_map.find (u.filename);
+      if (it->second.wav_set.get().use_count() == 1)
+        {
+          wav_set_map.erase (it);
+          total_bytes -= u.bytes;
+          m_stats.evictions++;
+        }
+    }
+}
+
+/**
+ * Enable or disable demand loading for wav sets that are loaded after this
+ * call. With demand loading, only the wav set headers are loaded by get(),
+ * and the audio data of a wave will be loaded in a background thread once it
+ * is needed for playing a note (see WavSet::find_audio).
+ */
+void
+WavSetRepo::set_demand_load (bool new_demand_load)
+{
+  std::lock_guard<std::mutex> lock (mutex);
+
+  demand_load = new_demand_load;
+}
+
+/**
+ * Set memory budget for the repo. If the wav sets use more memory than
+ * this, the least recently used wav sets that are no longer referenced
+ * outside the repo are freed during get(). A budget of 0 means unlimited.
+ *
+ * \param bytes memory budget in bytes
+ */
+void
+WavSetRepo::set_memory_budget (size_t bytes)
+{
+  std::lock_guard<std::mutex> lock (mutex);
+
+  memory_budget = bytes;
+}
+
+/**
+ * Get repo statistics (hits, misses, evictions and memory usage).
+ */
+WavSetRepo::Stats
+WavSetRepo::stats()
+{
+  std::lock_guard<std::mutex> lock (mutex);
+
+  Stats stats = m_stats;
+
+  stats.wav_sets = wav_set_map.size();
+  for (auto& it : wav_set_map)
+    stats.resident_bytes += it.second.bytes;
+
+  return stats;
+}
+
+void
+WavSetRepo::loader_run()
+{
+  std::unique_lock<std::mutex> loader_lock (loader_mutex);
+
+  while (!loader_quit)
+    {
+      /* wait until loading is requested (every request posts the semaphore, so none can get lost) */
+      loader_lock.unlock();
+      loader_sem.wait();
+      loader_lock.lock();
+
+      if (loader_quit)
+        break;
+
+      /* forget about wav sets that have been evicted in the meantime */
+      loader_wav_sets.erase (std::remove_if (loader_wav_sets.begin(), loader_wav_sets.end(),
+                                             [] (const LoaderEntry& e) { return e.wav_set.expired(); }),
+                             loader_wav_sets.end());
+
+      vector<LoaderEntry> wav_sets = loader_wav_sets;
+
+      loader_lock.unlock();
+      for (auto& loader_entry : wav_sets)
+        {
+          std::shared_ptr<WavSet> wav_set = loader_entry.wav_set.lock();
+          if (wav_set && wav_set->load_requested())
+            update_bytes (loader_entry.filename, wav_set);
+        }
+      loader_lock.lock();
+    }
+}
+
+/* update memory usage of a demand loaded wav set after loading audio data */
+void
+WavSetRepo::update_bytes (const string& filename, const std::shared_ptr<WavSet>& wav_set)
+{
+  const size_t bytes = wav_set->memory_usage();
+
+  std::lock_guard<std::mutex> lock (mutex);
+
+  auto it = wav_set_map.find (filename);
+  if (it != wav_set_map.end() && it->second.loaded() && it->second.wav_set.get() == wav_set)
+    it->second.bytes = bytes;
+}
+
 WavSetRepo::~WavSetRepo()
 {
-  for (auto w : wav_set_map)
-    delete w.second;
+  if (loader_thread.joinable())
+    {
+      loader_mutex.lock();
+      loader_quit = true;
+      loader_mutex.unlock();
+      loader_sem.post();
+
+      loader_thread.join();
+    }
 }
@@ -4,21 +4,70 @@
 #define SPECTMORPH_WAVSET_REPO_HH
 
 #include "smwavset.hh"
+#include "smsemaphore.hh"
 
 #include <mutex>
+#include <thread>
+#include <future>
 
 #include <map>
+#include <memory>
 
 namespace SpectMorph
 {
 
 class WavSetRepo {
+public:
+  struct Stats
+  {
+    size_t   wav_sets       = 0;  // number of wav sets in repo
+    size_t   resident_bytes = 0;  // estimated memory used by the wav sets in repo
+    uint64_t hits           = 0;
+    uint64_t misses         = 0;
+    uint64_t evictions      = 0;
+  };
+
+private:
+  struct Entry
+  {
+    std::shared_future<std::shared_ptr<WavSet>> wav_set;  // not ready while loading
+    uint64_t                                    last_use = 0;
+    size_t                                      bytes = 0;   // memory_usage() of the wav set (once loaded)
+
+    bool loaded() const;
+  };
   std::mutex mutex;
-  std::map<std::string, WavSet *> wav_set_map;
+  std::map<std::string, Entry> wav_set_map;
+  bool     demand_load = false;
+  size_t   memory_budget = 0;
+  uint64_t use_counter = 0;
+  Stats    m_stats;
+
+  /* background thread which loads audio data for demand loaded wav sets */
+  std::mutex                          loader_mutex;
+  Semaphore                           loader_sem;   // posted (realtime safe) if loading is requested
+  std::thread                         loader_thread;
+  bool                                loader_quit = false;
+  struct LoaderEntry
+  {
+    std::string           filename;
+    std::weak_ptr<WavSet> wav_set;
+  };
+  std::vector<LoaderEntry>            loader_wav_sets;
+
+  void loader_run();
+  void update_bytes (const std::string& filename, const std::shared_ptr<WavSet>& wav_set);
+  void evict_unused();
+  std::shared_ptr<WavSet> load_wav_set (const std::string& filename, bool demand_load);
 public:
   ~WavSetRepo();
 
-  WavSet *get (const std::string& filename);
+  std::shared_ptr<WavSet> get (const std::string& filename);
+  std::vector<std::shared_ptr<WavSet>> preload (const std::vector<std::string>& filenames);
+
+  void  set_demand_load (bool demand_load);
+  void  set_memory_budget (size_t bytes);
+  Stats stats();
 
   static WavSetRepo *the(); // Singleton
 };
@@ -6,6 +6,7 @@
 
 #include "smaudio.hh"
 #include "smencoder.hh"
+#include "smencoderoptions.hh"
 #include "smmain.hh"
 #include "smdebug.hh"
 #include "smutils.hh"
@@ -20,65 +21,16 @@ using std::max;
 
 using namespace SpectMorph;
 
-static float
-freqFromNote (float note)
-{
-  return 440 * exp (log (2) * (note - 69) / 12.0);
-}
-
-/*
- * for ch == 'X', substitute searches for occurrences of %X
- * in pattern and replaces them with the string subst
- */
-static void
-substitute (string& pattern,
-            char    ch,
-            const   string& subst)
-{
-  string result;
-  bool need_subst = false;
-
-  for (size_t i = 0; i < pattern.size(); i++)
-    {
-      if (need_subst)
-        {
-          if (pattern[i] == ch)
-            result += subst;
-          else
-            {
-              result += '%';
-              result += pattern[i];
-            }
-          need_subst = false;
-        }
-      else if (pattern[i] == '%')
-        need_subst = true;
-      else
-        result += pattern[i];
-    }
-  if (need_subst)
-    pattern += '%';
-  pattern = result;
-}
-
 /// @cond
 struct Options
 {
   string	program_name; /* FIXME: what to do with that */
-  bool          strip_models;
   bool          text_input_file;
   int           text_input_rate;
-  bool          keep_samples;
-  bool          attack;
-  bool          track_sines;
-  float         fundamental_freq;
-  int           optimization_level;
-  double        loop_start;
-  double        loop_end;
-  Audio::LoopType loop_type;
-  bool          loop_unit_seconds;
   string        debug_decode_filename;
-  string        config_filename;
+  string        profile_filename;
+
+  EncoderOptions encoder_options;
 
   Options ();
   void parse (int *argc_p, char **argv_p[]);
@@ -91,18 +43,8 @@ struct Options
 Options::Options ()
 {
   program_name = "smenc";
-  fundamental_freq = 0; // unset
-  optimization_level = 0;
-  strip_models = false;
-  keep_samples = false;
-  track_sines = true;   // perform peak tracking to find sine components
-  attack = true;        // perform attack time optimization
   text_input_file = false;
   text_input_rate = 0;
-  loop_start = -1;
-  loop_end = -1;
-  loop_type = Audio::LOOP_NONE;
-  loop_unit_seconds = false;
 }
 
 void
@@ -120,6 +62,7 @@ Options::parse (int   *argc_p,
     program_name = argv[0];
   */
 
+  /* smenc specific options, encoder options are parsed by EncoderOptions */
   for (i = 1; i < argc; i++)
     {
       const char *opt_arg;
@@ -138,83 +81,18 @@ Options::parse (int   *argc_p,
 	{
           Debug::enable ("encoder");
 	}
-      else if (check_arg (argc, argv, &i, "-f", &opt_arg))
-	{
-	  fundamental_freq = sm_atof (opt_arg);
-        }
-      else if (check_arg (argc, argv, &i, "-m", &opt_arg))
-        {
-          fundamental_freq = freqFromNote (atoi (opt_arg));
-        }
-      else if (check_arg (argc, argv, &i, "-O0"))
-        {
-          optimization_level = 0;
-        }
-      else if (check_arg (argc, argv, &i, "-O1"))
-        {
-          optimization_level = 1;
-        }
-      else if (check_arg (argc, argv, &i, "-O2"))
-        {
-          optimization_level = 2;
-        }
-      else if (check_arg (argc, argv, &i, "-O", &opt_arg))
-        {
-          optimization_level = atoi (opt_arg);
-        }
-      else if (check_arg (argc, argv, &i, "-s"))
-        {
-          strip_models = true;
-        }
-      else if (check_arg (argc, argv, &i, "--keep-samples"))
-        {
-          keep_samples = true;
-        }
-      else if (check_arg (argc, argv, &i, "--no-attack"))
-        {
-          attack = false;
-        }
-      else if (check_arg (argc, argv, &i, "--no-sines"))
-        {
-          track_sines = false;
-        }
       else if (check_arg (argc, argv, &i, "--debug-decode", &opt_arg))
         {
           debug_decode_filename = opt_arg;
         }
-      else if (check_arg (argc, argv, &i, "--loop-start", &opt_arg))
-        {
-          loop_start = sm_atof (opt_arg);
-        }
-      else if (check_arg (argc, argv, &i, "--loop-end", &opt_arg))
-        {
-          loop_end = sm_atof (opt_arg);
-        }
-      else if (check_arg (argc, argv, &i, "--loop-type", &opt_arg))
-        {
-          if (!Audio::string_to_loop_type (opt_arg, loop_type))
-            {
-              fprintf (stderr, "%s: unsupported loop type %s\n", options.program_name.c_str(), opt_arg);
-              exit (1);
-            }
-        }
-      else if (check_arg (argc, argv, &i, "--loop-unit", &opt_arg))
-        {
-          if (strcmp (opt_arg, "seconds") != 0)
-            {
-              fprintf (stderr, "%s: unsupported loop unit %s\n", options.program_name.c_str(), opt_arg);
-              exit (1);
-            }
-          loop_unit_seconds = true;
-        }
       else if (check_arg (argc, argv, &i, "--text-input-file", &opt_arg))
         {
           text_input_file = true;
           text_input_rate = atoi (opt_arg);
         }
-      else if (check_arg (argc, argv, &i, "--config", &opt_arg))
+      else if (check_arg (argc, argv, &i, "--profile", &opt_arg))
         {
-          config_filename = opt_arg;
+          profile_filename = opt_arg;
         }
      }
 
@@ -250,6 +128,10 @@ Options::print_usage ()
   sm_printf (" -d                          dump encoder debug information\n");
   sm_printf (" --text-input-file <rate>    set input file format to human readable text values\n");
   sm_printf (" --config <config>           set additional parameters for analysis\n");
+  sm_printf (" -j <threads>                analyze frames using multiple threads\n");
+  sm_printf (" --stream                    analyze frames one at a time to reduce memory usage\n");
+  sm_printf (" --keep-debug-data           keep original spectrum in models (default unless --stream)\n");
+  sm_printf (" --profile <file>            write time and memory usage of encoder stages to file (JSON)\n");
   sm_printf ("\n");
 }
 
@@ -353,23 +235,23 @@ main (int argc, char **argv)
   Main main (&argc, &argv);
   options.parse (&argc, &argv);
 
-  if (argc != 2 && argc != 3)
+  const EncoderOptions& encoder_options = options.encoder_options;
+
+  vector<string> files;
+  string         error;
+  if (!options.encoder_options.parse (vector<string> (argv + 1, argv + argc), files, error))
     {
-      options.print_usage();
+      fprintf (stderr, "%s: %s\n", options.program_name.c_str(), error.c_str());
       exit (1);
     }
-
-  if (options.config_filename != "")
+  if (files.size() != 1 && files.size() != 2)
     {
-      if (!enc_params.load_config (options.config_filename))
-        {
-          fprintf (stderr, "%s: can't open config file '%s'\n", options.program_name.c_str(), options.config_filename.c_str());
-          exit (1);
-        }
+      options.print_usage();
+      exit (1);
     }
 
   /* open input */
-  string input_file = argv[1];
+  string input_file = files[0];
 
   WavData wav_data;
 
@@ -387,54 +269,19 @@ main (int argc, char **argv)
           exit (1);
         }
     }
-  /* use defaults, but customize window */
-  enc_params.setup_params (wav_data, options.fundamental_freq);
-
-  /* compute encoder window */
-  vector<float> window (enc_params.block_size);
-
-  string window_type;
-  if (!enc_params.get_param ("window", window_type))
-    window_type = "hann";
-
-  for (uint i = 0; i < window.size(); i++)
+  if (!encoder_options.setup_params (enc_params, wav_data, error))
     {
-      const uint frame_size = enc_params.frame_size;
-
-      if (i < frame_size)
-        {
-          if (window_type == "hann")
-            {
-              window[i] = window_cos (2.0 * i / (frame_size - 1) - 1.0);
-            }
-          else if (window_type == "hamming")
-            {
-              /* probably never a good idea, since the sidelobes of the spectrum
-               * do not roll off fast (as with the hann window)
-               */
-              window[i] = window_hamming (2.0 * i / (frame_size - 1) - 1.0);
-            }
-          else if (window_type == "blackman")
-            {
-              window[i] = window_blackman (2.0 * i / (frame_size - 1) - 1.0);
-            }
-          else
-            {
-              fprintf (stderr, "%s: unsupported window type in config.\n", options.program_name.c_str());
-              exit (1);
-            }
-        }
-      else
-        window[i] = 0;
+      fprintf (stderr, "%s: %s\n", options.program_name.c_str(), error.c_str());
+      exit (1);
     }
-  enc_params.window = window;
 
   int n_channels = wav_data.n_channels();
 
+  vector<string> profiles;
   for (int channel = 0; channel < n_channels; channel++)
     {
       string sm_file;
-      if (argc == 2)
+      if (files.size() == 1)
         {
           // replace suffix: foo.wav => foo.sm   (or foo-ch1.sm for channel 1)
           size_t dot_pos = input_file.rfind ('.');
@@ -447,12 +294,10 @@ main (int argc, char **argv)
             sm_file += string_printf ("-ch%d", channel);
           sm_file += ".sm";
         }
-      else if (argc == 3)
+      else
         {
-          input_file = argv[1];
-          sm_file = argv[2];
-          substitute (sm_file, 'c', string_printf ("%d", channel));
-          if (sm_file == argv[2] && n_channels > 1)
+          sm_file = EncoderOptions::channel_filename (files[1], channel);
+          if (sm_file == files[1] && n_channels > 1)
             {
               fprintf (stderr, "%s: input file '%s' has more than one channel, need pattern %%c in output file name.\n", options.program_name.c_str(), input_file.c_str());
               exit (1);
@@ -460,42 +305,28 @@ main (int argc, char **argv)
         }
 
       Encoder encoder (enc_params);
-      encoder.encode (wav_data, channel, options.optimization_level, options.attack, options.track_sines);
-      if (options.strip_models)
-        {
-          vector<EncoderBlock>& audio_blocks = encoder.audio_blocks;
-
-          for (size_t i = 0; i < audio_blocks.size(); i++)
-            {
-              audio_blocks[i].debug_samples.clear();
-              audio_blocks[i].original_fft.clear();
-            }
-          if (!options.keep_samples)
-            {
-              encoder.original_samples.clear();
-            }
-        }
-      if (options.loop_type == Audio::LOOP_NONE && options.loop_start == -1 && options.loop_end == -1)
-        {
-          // no loop
-        }
-      else
-        {
-          assert (options.loop_type != Audio::LOOP_NONE);
-          assert (options.loop_start >= 0 && options.loop_end >= options.loop_start);
+      encoder.encode (wav_data, channel, encoder_options.optimization_level, encoder_options.attack, encoder_options.track_sines);
+      profiles.push_back (encoder.profile().to_json());
+      encoder_options.finish (encoder);
 
-          if (options.loop_unit_seconds)
-            {
-              encoder.set_loop_seconds (options.loop_type, options.loop_start, options.loop_end);
-            }
-          else
-            {
-              encoder.set_loop (options.loop_type, options.loop_start, options.loop_end);
-            }
-        }
       if (options.debug_decode_filename != "")
         encoder.debug_decode (options.debug_decode_filename);
 
       encoder.save (sm_file);
     }
+  if (options.profile_filename != "")
+    {
+      /* one profile for each channel */
+      FILE *profile_file = fopen (options.profile_filename.c_str(), "w");
+      if (!profile_file)
+        {
+          fprintf (stderr, "%s: can't write profile to %s\n", options.program_name.c_str(), options.profile_filename.c_str());
+          exit (1);
+        }
+      fprintf (profile_file, "[");
+      for (size_t i = 0; i < profiles.size(); i++)
+        fprintf (profile_file, "%s\n%s", i ? "," : "", profiles[i].c_str());
+      fprintf (profile_file, "\n]\n");
+      fclose (profile_file);
+    }
 }
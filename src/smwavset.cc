@@ -12,6 +12,7 @@
 #include <smmain.hh>
 #include <smmicroconf.hh>
 #include "smjobqueue.hh"
+#include "smbatchencoder.hh"
 #include "smutils.hh"
 #include "smwavdata.hh"
 #include "sminstrument.hh"
@@ -265,7 +266,7 @@ Options::print_usage ()
   sm_printf (" -d, --data-dir <dir>        set data directory for newly created .sm or .wav files\n");
   sm_printf (" -c, --channel <ch>          set channel for added .sm file\n");
   sm_printf (" --format <f1>,...,<fN>      set fields to display in list\n");
-  sm_printf (" -j <jobs>                   run <jobs> commands simultaneously (use multiple cpus for encoding)\n");
+  sm_printf (" -j <jobs>                   run <jobs> encoder jobs simultaneously (use multiple cpus for encoding)\n");
   sm_printf (" --smenc <cmd>               use <cmd> as smenc command\n");
   sm_printf (" --loop                      also extract loop markers (for smwavset get-markers)\n");
   sm_printf ("\n");
@@ -438,20 +439,38 @@ main (int argc, char **argv)
       WavSet wset, smset;
       load_or_die (wset, argv[1]);
 
-      JobQueue job_queue (options.max_jobs);
+      /* the default encoder runs in this process (no process startup cost per wave) */
+      const bool in_process = (options.smenc == "smenc");
+
+      JobQueue     job_queue (options.max_jobs);
+      BatchEncoder batch_encoder;
+
+      batch_encoder.set_max_threads (options.max_jobs);
+      batch_encoder.set_progress_function ([&] (const BatchEncoder::Job& job, size_t n_done, size_t n_jobs)
+        {
+          sm_printf ("[%s] ## encoded %s (%zd/%zd)\n", time2str (get_time() - start_time).c_str(), job.output_filename.c_str(), n_done, n_jobs);
+        });
 
       for (vector<WavSetWave>::iterator wi = wset.waves.begin(); wi != wset.waves.end(); wi++)
         {
           string smpath = options.data_dir + "/" + int2str (wi->midi_note) + ".sm";
-          string cmd = options.smenc + " -m " + int2str (wi->midi_note) + " \"" + wi->path.c_str() + "\" " + smpath + " " + options.args;
-          sm_printf ("[%s] ## %s\n", time2str (get_time() - start_time).c_str(), cmd.c_str());
-          job_queue.run (cmd);
+          if (in_process)
+            {
+              batch_encoder.add_job (wi->path, smpath, "-m " + int2str (wi->midi_note) + " " + options.args);
+            }
+          else
+            {
+              string cmd = options.smenc + " -m " + int2str (wi->midi_note) + " \"" + wi->path.c_str() + "\" " + smpath + " " + options.args;
+              sm_printf ("[%s] ## %s\n", time2str (get_time() - start_time).c_str(), cmd.c_str());
+              job_queue.run (cmd);
+            }
 
           WavSetWave new_wave = *wi;
           new_wave.path = smpath;
           smset.waves.push_back (new_wave);
         }
-      if (!job_queue.wait_for_all())
+      bool ok = in_process ? batch_encoder.run() : job_queue.wait_for_all();
+      if (!ok)
         {
           g_printerr ("smwavset: encoding commands did not complete successfully\n");
           exit (1);
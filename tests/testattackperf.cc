@@ -0,0 +1,65 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smmain.hh"
+#include "smencoder.hh"
+#include "smutils.hh"
+
+using namespace SpectMorph;
+
+using std::vector;
+using std::min;
+
+static double
+encode_time (const WavData& wav_data, double freq, bool attack, Audio *& audio)
+{
+  EncoderParams enc_params;
+  enc_params.setup_params (wav_data, freq);
+
+  double min_time = 1e20;
+  for (int reps = 0; reps < 3; reps++)
+    {
+      Encoder encoder (enc_params);
+
+      double start = get_time();
+      encoder.encode (wav_data, 0, /* optimization level */ 1, attack, /* track sines */ true);
+      double end = get_time();
+
+      min_time = min (min_time, end - start);
+      if (reps == 0 && audio == nullptr)
+        audio = encoder.save_as_audio();
+    }
+  return min_time;
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  const double mix_freq = 48000;
+
+  for (double freq : { 55.0, 220.0, 880.0 })
+    {
+      /* saw wave with a short attack */
+      vector<float> samples (mix_freq);
+      for (size_t i = 0; i < samples.size(); i++)
+        {
+          double saw = 0;
+          for (int p = 1; p * freq < mix_freq / 2; p++)
+            saw += sin (i * freq * p * 2 * M_PI / mix_freq) / p;
+
+          samples[i] = saw * 0.3 * min (i / (0.02 * mix_freq), 1.0);
+        }
+      WavData wav_data (samples, 1, mix_freq, 32);
+
+      Audio *audio = nullptr;
+      const double t_no_attack = encode_time (wav_data, freq, false, audio);
+      delete audio;
+      audio = nullptr;
+      const double t_attack = encode_time (wav_data, freq, true, audio);
+
+      printf ("freq %6.1f: attack stage %8.2f ms, total %8.2f ms (attack %.3f ms .. %.3f ms)\n", freq,
+              (t_attack - t_no_attack) * 1000, t_attack * 1000, audio->attack_start_ms, audio->attack_end_ms);
+      delete audio;
+    }
+}
@@ -0,0 +1,183 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smmain.hh"
+#include "smaudio.hh"
+#include "smoutfile.hh"
+#include "smmemout.hh"
+#include "smmmapin.hh"
+#include "smstdioin.hh"
+#include "smrandom.hh"
+
+#include <stdlib.h>
+#include <assert.h>
+#include <unistd.h>
+
+using namespace SpectMorph;
+
+using std::vector;
+using std::string;
+
+static void
+fill_audio (Audio& audio, bool debug)
+{
+  Random random;
+
+  audio.mix_freq = 48000;
+  audio.frame_size_ms = 40;
+  audio.frame_step_ms = 10;
+  audio.fundamental_freq = 440;
+  audio.zeropad = 4;
+  audio.sample_count = 4800;
+  audio.contents.resize (100);
+
+  for (size_t f = 0; f < audio.contents.size(); f++)
+    {
+      AudioBlock& block = audio.contents[f];
+
+      block.noise.resize (32);
+      for (auto& n : block.noise)
+        n = random.random_uint32() & 0xffff;
+
+      /* some frames without partials / without phases */
+      int n_partials = (f % 7 == 0) ? 0 : random.random_uint32() % 100;
+      for (int p = 0; p < n_partials; p++)
+        {
+          block.freqs.push_back (random.random_uint32() & 0xffff);
+          block.mags.push_back (random.random_uint32() & 0xffff);
+          if (f % 5)
+            block.phases.push_back (random.random_uint32() & 0xffff);
+        }
+      std::sort (block.freqs.begin(), block.freqs.end());
+
+      if (debug)
+        {
+          block.debug_samples.resize (f % 3);
+          block.original_fft.resize (f % 5, f);
+        }
+    }
+}
+
+/* writes the old (version 14) layout, which stores each frame in its own section */
+static void
+save_v14 (const Audio& audio, vector<unsigned char>& data)
+{
+  MemOut  mo (&data);
+  OutFile of (&mo, "SpectMorph::Audio", 14);
+
+  of.begin_section ("header");
+  of.write_float ("mix_freq", audio.mix_freq);
+  of.write_float ("frame_size_ms", audio.frame_size_ms);
+  of.write_float ("frame_step_ms", audio.frame_step_ms);
+  of.write_float ("fundamental_freq", audio.fundamental_freq);
+  of.write_int ("zeropad", audio.zeropad);
+  of.write_int ("frame_count", audio.contents.size());
+  of.write_int ("sample_count", audio.sample_count);
+  of.end_section();
+
+  for (const auto& block : audio.contents)
+    {
+      of.begin_section ("frame");
+      of.write_uint16_block ("noise", block.noise);
+      of.write_uint16_block ("freqs", block.freqs);
+      of.write_uint16_block ("mags", block.mags);
+      of.write_uint16_block ("phases", block.phases);
+      of.write_float_block ("original_fft", block.original_fft);
+      of.write_float_block ("debug_samples", block.debug_samples);
+      of.end_section();
+    }
+}
+
+static void
+check_equal (const Audio& a, const Audio& b, bool debug)
+{
+  assert (a.mix_freq == b.mix_freq);
+  assert (a.frame_size_ms == b.frame_size_ms);
+  assert (a.frame_step_ms == b.frame_step_ms);
+  assert (a.zeropad == b.zeropad);
+  assert (a.sample_count == b.sample_count);
+  assert (a.contents.size() == b.contents.size());
+
+  for (size_t f = 0; f < a.contents.size(); f++)
+    {
+      assert (a.contents[f].noise == b.contents[f].noise);
+      assert (a.contents[f].freqs == b.contents[f].freqs);
+      assert (a.contents[f].mags == b.contents[f].mags);
+      assert (a.contents[f].phases == b.contents[f].phases);
+      if (debug)
+        {
+          assert (a.contents[f].original_fft == b.contents[f].original_fft);
+          assert (a.contents[f].debug_samples == b.contents[f].debug_samples);
+        }
+      else
+        {
+          assert (b.contents[f].original_fft.empty());
+          assert (b.contents[f].debug_samples.empty());
+        }
+    }
+}
+
+static void
+load_mem (Audio& audio, vector<unsigned char>& data, AudioLoadOptions load_options)
+{
+  GenericIn *in = MMapIn::open_mem (&data[0], &data[data.size()]);
+  Error error = audio.load (in, load_options);
+  assert (!error);
+  delete in;
+}
+
+static void
+test_format (bool debug)
+{
+  Audio audio;
+  fill_audio (audio, debug);
+
+  /* current version: mmap input */
+  vector<unsigned char> data;
+  MemOut mo (&data);
+  audio.save (&mo);
+
+  Audio audio_mmap;
+  load_mem (audio_mmap, data, AUDIO_LOAD_DEBUG);
+  check_equal (audio, audio_mmap, debug);
+
+  Audio audio_nodebug;
+  load_mem (audio_nodebug, data, AUDIO_SKIP_DEBUG);
+  check_equal (audio, audio_nodebug, false);
+
+  /* current version: stdio input */
+  audio.save ("testaudioformat.out");
+
+  GenericIn *in = StdioIn::open ("testaudioformat.out");
+  assert (in);
+
+  Audio audio_stdio;
+  Error error = audio_stdio.load (in);
+  assert (!error);
+  check_equal (audio, audio_stdio, debug);
+  delete in;
+
+  if (unlink ("testaudioformat.out") != 0)
+    {
+      perror ("unlink testaudioformat.out failed");
+      exit (1);
+    }
+
+  /* old version */
+  vector<unsigned char> data_v14;
+  save_v14 (audio, data_v14);
+
+  Audio audio_v14;
+  load_mem (audio_v14, data_v14, AUDIO_LOAD_DEBUG);
+  check_equal (audio, audio_v14, debug);
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  test_format (false);
+  test_format (true);
+
+  printf ("testaudioformat: OK\n");
+}
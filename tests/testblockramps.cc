@@ -0,0 +1,146 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smmain.hh"
+#include "smmath.hh"
+#include "smlinearsmooth.hh"
+#include "smfilterenvelope.hh"
+#include "smadsrenvelope.hh"
+#include "smutils.hh"
+
+#include <vector>
+
+#include <assert.h>
+
+using namespace SpectMorph;
+
+using std::vector;
+
+static void
+test_exp2()
+{
+  double max_err = 0;
+  for (double x = -30; x < 30; x += 0.0001)
+    {
+      double err = fabs (sm_exp2f_fast (x) / exp2 (x) - 1);
+      max_err = std::max (max_err, err);
+    }
+  printf ("exp2: max relative error %g\n", max_err);
+  assert (max_err < 1e-6);
+}
+
+static void
+test_linear_smooth()
+{
+  LinearSmooth smooth_next, smooth_block;
+  smooth_next.reset (48000, 0.010);
+  smooth_block.reset (48000, 0.010);
+
+  double max_err = 0;
+  for (int block = 0; block < 100; block++)
+    {
+      if (block % 7 == 0)
+        {
+          float target = (block % 3) * 100 + 50;
+          smooth_next.set (target, block == 0);
+          smooth_block.set (target, block == 0);
+        }
+      const uint n_values = 1 + (block * 37) % 300;
+      vector<float> values (n_values);
+      smooth_block.get_block (n_values, &values[0]);
+      for (uint i = 0; i < n_values; i++)
+        {
+          /* get_next() accumulates rounding errors, so use a relative error bound */
+          const float ref = smooth_next.get_next();
+          max_err = std::max<double> (max_err, fabs (values[i] - ref) / std::max (fabs (ref), 1.0f));
+        }
+    }
+  printf ("linear smooth: max relative error %g\n", max_err);
+  assert (max_err < 1e-4);
+}
+
+static void
+test_filter_envelope (FilterEnvelope::Shape shape)
+{
+  FilterEnvelope env_next, env_block;
+  for (auto env : { &env_next, &env_block })
+    {
+      env->set_shape (shape);
+      env->set_delay (0);
+      env->set_attack (0.05);
+      env->set_hold (0);
+      env->set_decay (0.2);
+      env->set_sustain (30);
+      env->set_release (0.1);
+      env->start (48000);
+    }
+  double max_err = 0;
+  double next_time = 0, block_time = 0;
+  for (int block = 0; block < 300; block++)
+    {
+      if (block == 150)
+        {
+          env_next.stop();
+          env_block.stop();
+        }
+      const uint n_values = 1 + (block * 53) % 256;
+      vector<float> values (n_values), ref_values (n_values);
+
+      double t0 = get_time();
+      env_block.get_block (n_values, &values[0]);
+      double t1 = get_time();
+      for (uint i = 0; i < n_values; i++)
+        ref_values[i] = env_next.get_next();
+      double t2 = get_time();
+
+      block_time += t1 - t0;
+      next_time += t2 - t1;
+      for (uint i = 0; i < n_values; i++)
+        max_err = std::max<double> (max_err, fabs (values[i] - ref_values[i]));
+    }
+  assert (env_block.done() && env_next.done());
+  printf ("filter envelope: max error %g (get_next: %.3f ms, get_block: %.3f ms)\n", max_err, next_time * 1000, block_time * 1000);
+  assert (max_err < 1e-5);
+}
+
+static void
+test_adsr()
+{
+  ADSREnvelope adsr;
+  adsr.set_config (30, 40, 50, 30, 48000);
+  adsr.retrigger();
+
+  vector<float> values (48000, 1);
+  for (size_t pos = 0; pos < values.size(); pos += 100)
+    adsr.process (100, &values[pos]);
+
+  /* attack: increasing, then decay to sustain level */
+  size_t max_pos = std::max_element (values.begin(), values.end()) - values.begin();
+  for (size_t i = 1; i <= max_pos; i++)
+    assert (values[i] >= values[i - 1]);
+  for (size_t i = max_pos + 1; i < values.size(); i++)
+    assert (values[i] <= values[i - 1] + 1e-6);
+  assert (fabs (values[max_pos] - 1) < 1e-4);
+
+  adsr.release();
+  while (!adsr.done())
+    {
+      float block[256];
+      std::fill (block, block + 256, 1);
+      adsr.process (256, block);
+    }
+  printf ("adsr: sustain level %f\n", values.back());
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  test_exp2();
+  test_linear_smooth();
+  test_filter_envelope (FilterEnvelope::Shape::LINEAR);
+  test_filter_envelope (FilterEnvelope::Shape::EXPONENTIAL);
+  test_adsr();
+
+  printf ("testblockramps: OK\n");
+}
@@ -0,0 +1,84 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smmain.hh"
+#include "smencoder.hh"
+#include "smmath.hh"
+
+#include <assert.h>
+
+using namespace SpectMorph;
+
+using std::vector;
+
+static vector<EncoderBlock>
+encode (const WavData& wav_data, double freq, bool downsample)
+{
+  EncoderParams enc_params;
+  enc_params.setup_params (wav_data, freq);
+  if (downsample)
+    enc_params.add_config_entry ("downsample-threshold", "-60");
+
+  Encoder encoder (enc_params);
+  bool ok = encoder.encode (wav_data, 0, /* optimization level */ 1, /* attack */ false, /* track sines */ true);
+  assert (ok);
+
+  return encoder.audio_blocks;
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  /* low note with all partials below 2000 Hz */
+  const double mix_freq = 48000;
+  const double freq = 55;
+
+  vector<float> samples (mix_freq * 2);
+  for (size_t i = 0; i < samples.size(); i++)
+    {
+      double s = 0;
+      for (int p = 1; p * freq < 2000; p++)
+        s += sin (i * freq * p * 2 * M_PI / mix_freq + p) / p;
+
+      samples[i] = s * 0.3 * exp (-(i / mix_freq));
+    }
+  WavData wav_data (samples, 1, mix_freq, 32);
+
+  vector<EncoderBlock> full_blocks = encode (wav_data, freq, false);
+  vector<EncoderBlock> ds_blocks = encode (wav_data, freq, true);
+
+  assert (full_blocks.size() == ds_blocks.size());
+
+  /* all relevant partials must be found with (almost) the same parameters */
+  size_t n_partials = 0;
+  double max_freq_delta = 0, max_db_delta = 0;
+  for (size_t f = 0; f < full_blocks.size(); f++)
+    {
+      const EncoderBlock& a = full_blocks[f];
+      const EncoderBlock& b = ds_blocks[f];
+
+      for (size_t i = 0; i < a.freqs.size(); i++)
+        {
+          if (a.mags[i] < 1e-3)
+            continue;
+
+          size_t best = 0;
+          for (size_t j = 1; j < b.freqs.size(); j++)
+            if (fabs (b.freqs[j] - a.freqs[i]) < fabs (b.freqs[best] - a.freqs[i]))
+              best = j;
+
+          assert (!b.freqs.empty());
+          max_freq_delta = std::max<double> (max_freq_delta, fabs (b.freqs[best] - a.freqs[i]));
+          max_db_delta = std::max (max_db_delta, fabs (db_from_factor (b.mags[best], -200) - db_from_factor (a.mags[i], -200)));
+          n_partials++;
+        }
+    }
+  printf ("partials=%zd max_freq_delta=%f max_db_delta=%f\n", n_partials, max_freq_delta, max_db_delta);
+  assert (n_partials > 1000);
+  assert (max_freq_delta > 0);  // results are not bit-identical if downsampling was used
+  assert (max_freq_delta < 0.5);
+  assert (max_db_delta < 0.2);
+
+  printf ("testencoderdownsample: OK\n");
+}
@@ -0,0 +1,59 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smmain.hh"
+#include "smencoder.hh"
+
+#include <algorithm>
+
+#include <assert.h>
+
+using namespace SpectMorph;
+
+using std::vector;
+using std::string;
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  const double mix_freq = 48000;
+
+  vector<float> samples (mix_freq);
+  for (size_t i = 0; i < samples.size(); i++)
+    samples[i] = sin (i * 440 * 2 * M_PI / mix_freq) * 0.5;
+
+  WavData wav_data (samples, 1, mix_freq, 32);
+
+  EncoderParams enc_params;
+  enc_params.setup_params (wav_data, 440);
+
+  Encoder encoder (enc_params);
+  bool ok = encoder.encode (wav_data, 0, /* optimization level */ 1, /* attack */ true, /* track sines */ true);
+  assert (ok);
+
+  const EncoderProfile& profile = encoder.profile();
+
+  vector<string> names;
+  double         stage_ms = 0;
+  for (const auto& stage : profile.stages)
+    {
+      names.push_back (stage.name);
+      stage_ms += stage.time_ms;
+
+      assert (stage.time_ms >= 0);
+      assert (stage.frames == encoder.audio_blocks.size());
+      assert (stage.memory > 0);
+    }
+  for (auto name : { "setup", "downsample", "stft", "maxima", "link", "validate", "optimize", "subtract", "noise", "attack", "sort" })
+    assert (std::find (names.begin(), names.end(), name) != names.end());
+
+  assert (stage_ms <= profile.total_ms + 1e-3);
+  assert (profile.stages.back().partials > 0);
+
+  string json = profile.to_json();
+  assert (json.find ("\"name\": \"stft\"") != string::npos);
+
+  printf ("%s\n", json.c_str());
+  printf ("testencoderprofile: OK\n");
+}
@@ -0,0 +1,80 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smmain.hh"
+#include "smencoder.hh"
+#include "smrandom.hh"
+
+#include <assert.h>
+#include <string.h>
+
+using namespace SpectMorph;
+
+using std::vector;
+
+/* bitwise comparison: threads must not change a single bit of the result */
+template<class T> static bool
+same (const vector<T>& a, const vector<T>& b)
+{
+  return a.size() == b.size() && (a.empty() || memcmp (a.data(), b.data(), a.size() * sizeof (T)) == 0);
+}
+
+static void
+encode (const WavData& wav_data, int max_threads, bool streaming, vector<EncoderBlock>& audio_blocks)
+{
+  EncoderParams enc_params;
+  enc_params.setup_params (wav_data, 440);
+  enc_params.max_threads = max_threads;
+  enc_params.streaming = streaming;
+
+  Encoder encoder (enc_params);
+  bool ok = encoder.encode (wav_data, 0, /* optimization level */ 1, /* attack */ true, /* track sines */ true);
+  assert (ok);
+
+  audio_blocks = encoder.audio_blocks;
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  /* decaying saw wave with some noise */
+  const double mix_freq = 48000;
+  Random       random;
+  vector<float> samples (mix_freq * 2);
+  for (size_t i = 0; i < samples.size(); i++)
+    {
+      double saw = 0;
+      for (int p = 1; p < 10; p++)
+        saw += sin (i * 440 * p * 2 * M_PI / mix_freq) / p;
+
+      samples[i] = (saw * 0.3 + random.random_double_range (-0.01, 0.01)) * exp (-(i / mix_freq));
+    }
+  WavData wav_data (samples, 1, mix_freq, 32);
+
+  vector<EncoderBlock> serial_blocks;
+  encode (wav_data, 1, false, serial_blocks);
+  assert (serial_blocks.size() > 100);
+
+  /* parallel and streaming encoding must produce exactly the same result */
+  for (auto mode : { std::make_pair (4, false), std::make_pair (1, true), std::make_pair (4, true) })
+    {
+      vector<EncoderBlock> blocks;
+      encode (wav_data, mode.first, mode.second, blocks);
+
+      assert (serial_blocks.size() == blocks.size());
+      for (size_t i = 0; i < serial_blocks.size(); i++)
+        {
+          const EncoderBlock& a = serial_blocks[i];
+          const EncoderBlock& b = blocks[i];
+
+          assert (same (a.noise, b.noise));
+          assert (same (a.freqs, b.freqs));
+          assert (same (a.mags, b.mags));
+          assert (same (a.phases, b.phases));
+          assert (same (a.original_fft, b.original_fft));
+          assert (same (a.debug_samples, b.debug_samples));
+        }
+    }
+  printf ("testencoderthreads: OK\n");
+}
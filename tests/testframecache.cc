@@ -0,0 +1,91 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smmain.hh"
+#include "smencoder.hh"
+#include "smrandom.hh"
+
+#include <assert.h>
+
+using namespace SpectMorph;
+
+using std::vector;
+
+static vector<EncoderBlock>
+encode (const vector<float>& samples, int clip_start, int clip_end, std::shared_ptr<EncoderFrameCache>& frame_cache)
+{
+  const double mix_freq = 48000;
+
+  vector<float> clipped (samples.begin() + clip_start, samples.begin() + clip_end);
+  WavData wav_data (clipped, 1, mix_freq, 32);
+
+  EncoderParams enc_params;
+  enc_params.setup_params (wav_data, 440);
+  enc_params.keep_debug_data = false;
+
+  Encoder encoder (enc_params);
+  if (frame_cache)
+    encoder.set_frame_cache (frame_cache, clip_start);
+
+  bool ok = encoder.encode (wav_data, 0, /* optimization level */ 1, /* attack */ true, /* track sines */ true);
+  assert (ok);
+
+  if (frame_cache)
+    {
+      frame_cache = encoder.get_frame_cache();
+      assert (frame_cache);
+    }
+  return encoder.audio_blocks;
+}
+
+static double
+max_delta (const vector<float>& a, const vector<float>& b)
+{
+  assert (a.size() == b.size());
+
+  double d = 0;
+  for (size_t i = 0; i < a.size(); i++)
+    d = std::max<double> (d, fabs (a[i] - b[i]));
+  return d;
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  /* decaying saw wave with some noise */
+  const double mix_freq = 48000;
+  Random       random;
+  vector<float> samples (mix_freq * 2);
+  for (size_t i = 0; i < samples.size(); i++)
+    {
+      double saw = 0;
+      for (int p = 1; p < 10; p++)
+        saw += sin (i * 440 * p * 2 * M_PI / mix_freq) / p;
+
+      samples[i] = (saw * 0.3 + random.random_double_range (-0.01, 0.01)) * exp (-(i / mix_freq));
+    }
+
+  auto frame_cache = std::make_shared<EncoderFrameCache>();
+  encode (samples, 1000, 80000, frame_cache);
+  assert (frame_cache->frames.size() > 100);
+
+  /* move clip markers: result with frame cache must match encoding without frame cache */
+  for (auto clip : { std::make_pair (1000, 70000), std::make_pair (1123, 70000), std::make_pair (1000, 90000) })
+    {
+      std::shared_ptr<EncoderFrameCache> no_cache;
+
+      vector<EncoderBlock> ref_blocks = encode (samples, clip.first, clip.second, no_cache);
+      vector<EncoderBlock> blocks     = encode (samples, clip.first, clip.second, frame_cache);
+
+      assert (ref_blocks.size() == blocks.size());
+      for (size_t i = 0; i < blocks.size(); i++)
+        {
+          assert (ref_blocks[i].freqs.size() == blocks[i].freqs.size());
+          assert (max_delta (ref_blocks[i].freqs, blocks[i].freqs) < 1e-3);
+          assert (max_delta (ref_blocks[i].mags, blocks[i].mags) < 1e-5);
+          assert (max_delta (ref_blocks[i].noise, blocks[i].noise) < 1e-5);
+        }
+    }
+  printf ("testframecache: OK\n");
+}
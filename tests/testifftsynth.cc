@@ -1,8 +1,11 @@
 // Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
 
 #include "smifftsynth.hh"
+#include "smoscbanksynth.hh"
+#include "sminterpsinesynth.hh"
 #include "smsinedecoder.hh"
 #include "smlivedecoder.hh"
+#include "smmorphutils.hh"
 #include "smmath.hh"
 #include "smmain.hh"
 #include "smfft.hh"
@@ -196,6 +199,90 @@ test_accs()
   printf ("# max_diff = %.17g\n", max_diff);
 }
 
+/* check fixed point phase accumulation against floating point phase accumulation with fmod() */
+void
+test_iphase()
+{
+  const double mix_freq = 48000;
+  const size_t block_size = 1024;
+
+  IFFTSynth synth (block_size, mix_freq, IFFTSynth::WIN_BLACKMAN_HARRIS_92);
+  vector<float> samples (block_size), isamples (block_size);
+
+  const double phase_factor = block_size * M_PI / mix_freq;
+  const double iphase_factor = block_size * 2147483648.0 / mix_freq;
+
+  double max_phase_diff = 0;
+  double max_output_diff = 0;
+  for (double freq : { 20.0, 440.0, 1234.5, 9876.54, 21000.0 })
+    {
+      double   phase = 0.5;
+      uint32_t iphase = sm_phase2iphase (phase);
+
+      for (int frame = 0; frame < 1000; frame++)
+        {
+          synth.clear_partials();
+          synth.render_partial (freq, 0.9, phase);
+          synth.get_samples (&samples[0]);
+
+          synth.clear_partials();
+          synth.render_partial_iphase (freq, 0.9, iphase);
+          synth.get_samples (&isamples[0]);
+
+          for (size_t i = 0; i < block_size; i++)
+            max_output_diff = max<double> (max_output_diff, fabs (samples[i] - isamples[i]));
+
+          double phase_diff = fabs (sm_iphase2phase (iphase) - phase);
+          phase_diff = min (phase_diff, 2 * M_PI - phase_diff);
+          max_phase_diff = max (max_phase_diff, phase_diff);
+
+          phase = fmod (phase + freq * phase_factor, 2 * M_PI);
+          iphase += uint32_t (int64_t (freq * iphase_factor + 0.5));
+        }
+    }
+  printf ("# iphase: max_phase_diff = %.17g\n", max_phase_diff);
+  printf ("# iphase: max_output_diff = %.17g\n", max_output_diff);
+
+  /* both phases should map to the same sin table entry, so the output is identical */
+  assert (max_phase_diff < 1e-6);
+  assert (max_output_diff == 0);
+}
+
+/* check time domain oscillator bank output against windowed sin() with quantized frequency */
+void
+test_osc_bank()
+{
+  const double mix_freq = 48000;
+  const double mag = 0.991;
+
+  double max_output_diff = 0;
+  for (size_t block_size : { 1024, 2048 })
+    {
+      IFFTSynth    ifft_synth (block_size, mix_freq, IFFTSynth::WIN_HANNING);
+      OscBankSynth osc_synth (block_size, mix_freq);
+      vector<float> samples (block_size);
+
+      for (double freq = 20; freq < 24000; freq = min (freq * 1.01, freq + 2.5))
+        {
+          const double   phase = 0.5 + freq;
+          const uint32_t iphase = sm_phase2iphase (phase);
+          const double   qfreq = ifft_synth.quantized_freq (freq);
+
+          osc_synth.clear_partials();
+          osc_synth.render_partial_iphase (freq, mag, iphase);
+          osc_synth.get_samples (&samples[0]);
+
+          for (size_t i = 0; i < block_size; i++)
+            {
+              const double expect = window_cos (2.0 * i / block_size - 1.0) * mag * sin (sm_iphase2phase (iphase) + i * qfreq / mix_freq * 2 * M_PI);
+              max_output_diff = max (max_output_diff, fabs (samples[i] - expect));
+            }
+        }
+    }
+  printf ("# OscBankSynth: max_output_diff = %.17g\n", max_output_diff);
+  assert (max_output_diff < 2e-5);
+}
+
 class ConstBlockSource : public LiveDecoderSource
 {
   Audio      my_audio;
@@ -313,7 +400,7 @@ test_phase()
 }
 
 void
-test_saw_perf()
+test_saw_perf (int unison_voices)
 {
   double mix_freq = 48000;
   double freq = 110;
@@ -337,6 +424,7 @@ test_saw_perf()
       live_decoder.enable_sines (i == 1);
       live_decoder.enable_debug_fft_perf (i == 0);
       live_decoder.precompute_tables (mix_freq);
+      live_decoder.set_unison_voices (unison_voices, 10);
       live_decoder.retrigger (0, freq, 127, mix_freq);
 
       double start, end;
@@ -354,7 +442,182 @@ test_saw_perf()
 
   const double clocks_per_sec = 2500.0 * 1000 * 1000;
   double time = t[1] - t[0]; // time without fft time
-  printf ("LiveDecoder: clocks per sample per partial: %f\n", clocks_per_sec * time / RUNS / PARTIALS / samples.size());
+  printf ("LiveDecoder (unison voices: %d): clocks per sample per partial: %f\n", unison_voices,
+          clocks_per_sec * time / RUNS / PARTIALS / samples.size());
+}
+
+/* render a 440 Hz sine with LiveDecoder, returns index of the first sample with abs (value) >= 0.5 */
+static size_t
+render_onset (bool low_latency, double mix_freq, vector<float>& samples)
+{
+  AudioBlock audio_block;
+
+  push_partial_f (audio_block, 1, 1, 0.9);
+
+  ConstBlockSource source (audio_block);
+  source.audio()->attack_start_ms = 0;
+  source.audio()->attack_end_ms = 0;
+
+  LiveDecoder live_decoder (&source);
+  live_decoder.enable_noise (false);
+  live_decoder.enable_low_latency (low_latency);
+  live_decoder.retrigger (0, 440, 127, mix_freq);
+  live_decoder.process (samples.size(), nullptr, &samples[0]);
+
+  for (size_t i = 0; i < samples.size(); i++)
+    if (fabs (samples[i]) >= 0.5)
+      return i;
+  return samples.size();
+}
+
+/* frame interpolation for low latency mode */
+void
+test_interp_frames()
+{
+  AudioBlock left, right, out;
+
+  push_partial_f (left, 1, 1, 0);
+  push_partial_f (left, 2, 0.5, 0);
+  push_partial_f (right, 1.01, 0.25, 0);
+  push_partial_f (right, 3, 0.2, 0);
+
+  MorphUtils::interp_frames (left, right, 0.5, out);
+
+  assert (out.freqs.size() == 3 && out.mags.size() == 3);
+  assert (out.freqs_f (0) > 1 && out.freqs_f (0) < 1.01);  // matched: interpolated
+  assert (fabs (out.mags_f (0) - 0.5) < 0.001);            // (dB interpolation)
+  assert (fabs (out.freqs_f (1) - 2) < 0.001);             // only left: fade out
+  assert (fabs (out.mags_f (1) - 0.25) < 0.001);
+  assert (fabs (out.freqs_f (2) - 3) < 0.001);             // only right: fade in
+  assert (fabs (out.mags_f (2) - 0.1) < 0.001);
+}
+
+void
+test_low_latency()
+{
+  const double mix_freq = 48000;
+
+  size_t onset[2];
+  for (int ll = 0; ll < 2; ll++)
+    {
+      vector<float> samples (mix_freq / 2);
+      onset[ll] = render_onset (ll, mix_freq, samples);
+
+      /* after the onset, amplitude should be the same as in the default mode */
+      float max_value = 0;
+      for (size_t i = samples.size() / 2; i < samples.size(); i++)
+        max_value = max (max_value, fabs (samples[i]));
+
+      printf ("# low latency %d: onset %.2f ms, amplitude %.5f\n", ll, onset[ll] * 1000 / mix_freq, max_value);
+      assert (fabs (max_value - 1) < 1e-3);
+    }
+  assert (onset[1] * 2 < onset[0]);
+}
+
+void
+test_interp_sines()
+{
+  const double mix_freq = 48000;
+  const size_t hop = 512;
+
+  /* steady partial: phase continuous sine, starting with phase 0 */
+  InterpSineSynth synth (mix_freq);
+
+  vector<float> samples (hop * 10);
+  for (size_t pos = 0; pos < samples.size(); pos += hop)
+    {
+      synth.add_partial (1000, 0.5);
+      synth.render (hop, &samples[pos]);
+    }
+  double max_diff = 0;
+  for (size_t i = hop; i < samples.size(); i++)
+    max_diff = max<double> (max_diff, fabs (samples[i] - 0.5 * sin (i * 1000 * 2 * M_PI / mix_freq)));
+  printf ("# InterpSineSynth: steady max_diff = %.6g\n", max_diff);
+  assert (max_diff < 1e-4);
+
+  /* frequency change: frequency is interpolated, no jump in the output */
+  synth.reset();
+  std::fill (samples.begin(), samples.end(), 0);
+  double max_step = 0;
+  for (size_t pos = 0; pos < samples.size(); pos += hop)
+    {
+      synth.add_partial ((pos / hop) % 2 ? 1040 : 1000, 1);
+      synth.render (hop, &samples[pos]);
+    }
+  for (size_t i = hop; i < samples.size(); i++)
+    max_step = max<double> (max_step, fabs (samples[i] - samples[i - 1]));
+  assert (max_step < 1040 * 2 * M_PI / mix_freq * 1.001);
+
+  /* partial disappears: fade out, afterwards silence */
+  std::fill (samples.begin(), samples.end(), 0);
+  synth.render (hop, &samples[0]);
+  assert (fabs (samples[hop - 1]) < 0.01);
+  synth.render (hop, &samples[hop]);
+  for (size_t i = hop; i < 2 * hop; i++)
+    assert (samples[i] == 0);
+
+  /* LiveDecoder: steady sine should have the same amplitude as with overlap-add */
+  AudioBlock audio_block;
+  push_partial_f (audio_block, 1, 1, 0.9);
+
+  ConstBlockSource source (audio_block);
+  LiveDecoder live_decoder (&source);
+  live_decoder.enable_noise (false);
+  live_decoder.enable_interpolated_sines (true);
+  live_decoder.retrigger (0, 440, 127, mix_freq);
+
+  vector<float> live_samples (mix_freq / 2);
+  live_decoder.process (live_samples.size(), nullptr, &live_samples[0]);
+
+  float max_value = 0;
+  for (size_t i = live_samples.size() / 2; i < live_samples.size(); i++)
+    max_value = max (max_value, fabs (live_samples[i]));
+  printf ("# interpolated sines: amplitude %.5f\n", max_value);
+  assert (fabs (max_value - 1) < 1e-3);
+}
+
+void
+test_latency_perf()
+{
+  const double mix_freq = 48000;
+  const size_t PARTIALS = 100;
+
+  AudioBlock audio_block;
+  for (size_t partial = 1; partial <= PARTIALS; partial++)
+    push_partial_f (audio_block, partial, 1.0 / partial, 0.9);
+  for (int i = 0; i < 32; i++)
+    audio_block.noise.push_back (sm_factor2idb (0.001));
+
+  vector<float> samples (1024 * 100);
+  for (bool noise : { false, true })
+    {
+      for (bool low_latency : { false, true })
+        {
+          ConstBlockSource source (audio_block);
+
+          LiveDecoder live_decoder (&source);
+          live_decoder.enable_noise (noise);
+          live_decoder.enable_low_latency (low_latency);
+          live_decoder.precompute_tables (mix_freq);
+          live_decoder.retrigger (0, 110, 127, mix_freq);
+
+          const int RUNS = 10;
+          double t = 1e30;
+          for (int reps = 0; reps < 12; reps++)
+            {
+              double start = get_time();
+              for (int r = 0; r < RUNS; r++)
+                live_decoder.process (samples.size(), nullptr, &samples[0]);
+              double end = get_time();
+              t = min (t, end - start);
+            }
+          vector<float> onset_samples (mix_freq / 10);
+          const size_t onset = render_onset (low_latency, mix_freq, onset_samples);
+
+          printf ("LiveDecoder (noise: %d, low latency: %d): %f ns/sample, onset %.2f ms\n", noise, low_latency,
+                  t * 1e9 / RUNS / samples.size(), onset * 1000 / mix_freq);
+        }
+    }
 }
 
 int
@@ -370,7 +633,13 @@ main (int argc, char **argv)
     }
   if (argc == 2 && strcmp (argv[1], "saw_perf") == 0)
     {
-      test_saw_perf();
+      test_saw_perf (1);
+      test_saw_perf (7);
+      return 0;
+    }
+  if (argc == 2 && strcmp (argv[1], "latency_perf") == 0)
+    {
+      test_latency_perf();
       return 0;
     }
   if (argc == 2 && strcmp (argv[1], "accs") == 0)
@@ -407,4 +676,10 @@ main (int argc, char **argv)
   printf ("# IFFTSynth: max_freq_diff = %.17g\n", max_freq_diff);
   assert (max_output_diff < 9e-5);
   assert (max_freq_diff < 0.1);
+
+  test_iphase();
+  test_osc_bank();
+  test_interp_frames();
+  test_low_latency();
+  test_interp_sines();
 }
@@ -20,6 +20,7 @@ main (int argc, char **argv)
       inst.load (argv[2]);
 
       WavSetBuilder builder (&inst, /* keep_samples */ false);
+      builder.set_max_threads (1); // kill_func is not thread safe
 
       auto kill_func = []() {
         static double last_t = -1;
@@ -39,25 +40,29 @@ main (int argc, char **argv)
     }
   assert (argc == 2);
 
-  vector<double> times;
-
-  for (int i = 0; i < 10; i++)
+  for (int max_threads : { 1, 0 })
     {
-      // pretend that the just program started, and cache doesn't have in-memory entries
-      InstEncCache::the()->clear();
+      vector<double> times;
 
-      double t = get_time();
+      for (int i = 0; i < 10; i++)
+        {
+          // pretend that the just program started, and cache doesn't have in-memory entries
+          InstEncCache::the()->clear();
 
-      Instrument inst;
-      inst.load (argv[1]);
+          double t = get_time();
 
-      WavSetBuilder builder (&inst, /* keep_samples */ false);
-      std::unique_ptr<WavSet> wav_set (builder.run());
+          Instrument inst;
+          inst.load (argv[1]);
 
-      times.push_back ((get_time() - t) * 1000);
-    }
+          WavSetBuilder builder (&inst, /* keep_samples */ false);
+          builder.set_max_threads (max_threads);
+          std::unique_ptr<WavSet> wav_set (builder.run());
+
+          times.push_back ((get_time() - t) * 1000);
+        }
 
-  // report times at end of test
-  for (auto t_ms : times)
-      printf ("time: %.2f ms\n", t_ms);
+      // report times at end of test
+      for (auto t_ms : times)
+        printf ("time (%s): %.2f ms\n", max_threads == 1 ? "1 thread" : "all cores", t_ms);
+    }
 }
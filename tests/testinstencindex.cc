@@ -0,0 +1,121 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smmain.hh"
+#include "sminstencindex.hh"
+
+#include <stdlib.h>
+#include <assert.h>
+#include <unistd.h>
+
+using namespace SpectMorph;
+
+using std::vector;
+using std::string;
+
+static InstEncIndex::Entry
+mk_entry (int key, int version, uint64 size)
+{
+  InstEncIndex::Entry entry;
+
+  entry.key     = string_printf ("inst_enc_%08x_%08x_%d", 0x1234, 0x5678, key);
+  entry.version = sha1_hash (string_printf ("version%d", version));
+  entry.size    = size;
+  return entry;
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  const string filename = "testinstencindex.idx";
+  unlink (filename.c_str());
+
+  /* new index: initialized from file scan */
+  bool scanned = false;
+  auto scan = [&]() {
+    scanned = true;
+    return vector<InstEncIndex::Entry> { mk_entry (1, 1, 100), mk_entry (2, 2, 200), mk_entry (3, 3, 300) };
+  };
+
+  InstEncIndex index;
+  assert (index.open (filename, scan));
+  assert (scanned);
+  assert (index.size() == 3);
+  assert (index.total_size() == 600);
+
+  string key;
+  assert (index.lookup (mk_entry (2, 2, 0).version, key));
+  assert (key == mk_entry (2, 2, 0).key);
+  assert (!index.lookup (mk_entry (4, 4, 0).version, key));
+
+  /* insert new version for the same key: old version is removed */
+  assert (index.insert (mk_entry (4, 4, 400)).empty());
+  vector<InstEncIndex::Entry> removed = index.insert (mk_entry (4, 5, 500));
+  assert (removed.size() == 1 && removed[0].version == mk_entry (4, 4, 0).version);
+  assert (!index.lookup (mk_entry (4, 4, 0).version, key));
+  assert (index.size() == 4);
+  assert (index.total_size() == 1100);
+
+  /* prune: least recently used entries go first (1 is older than 3, since 2 was looked up) */
+  assert (index.lookup (mk_entry (3, 3, 0).version, key));
+  removed = index.prune (1000);
+  assert (removed.size() == 1 && removed[0].key == mk_entry (1, 1, 0).key);
+  removed = index.prune (800);
+  assert (removed.size() == 1 && removed[0].key == mk_entry (2, 2, 0).key);
+  assert (index.total_size() == 800);
+
+  /* grow table */
+  for (int i = 0; i < 5000; i++)
+    index.insert (mk_entry (1000 + i, 1000 + i, 1));
+  assert (index.size() == 5002);
+  for (int i = 0; i < 5000; i++)
+    {
+      assert (index.lookup (mk_entry (1000 + i, 1000 + i, 0).version, key));
+      assert (key == mk_entry (1000 + i, 1000 + i, 0).key);
+    }
+  for (int i = 0; i < 5000; i += 2)
+    index.remove (mk_entry (1000 + i, 1000 + i, 0).version);
+  assert (index.size() == 2502);
+  assert (index.total_size() == 3300);
+
+  /* reopen: index is persistent */
+  index.close();
+  scanned = false;
+  assert (index.open (filename, scan));
+  assert (!scanned);
+  assert (index.size() == 2502);
+  assert (index.lookup (mk_entry (3, 3, 0).version, key));
+
+  /* second index instance (like another process) sees updates */
+  InstEncIndex index2;
+  assert (index2.open (filename, scan));
+  index2.insert (mk_entry (7, 7, 700));
+  assert (index.lookup (mk_entry (7, 7, 0).version, key));
+  assert (index.size() == 2503);
+
+  /* old versions inserted by another process (or before a restart) are removed, too */
+  removed = index.insert (mk_entry (7, 8, 800));
+  assert (removed.size() == 1 && removed[0].version == mk_entry (7, 7, 0).version);
+  removed = index.insert (mk_entry (3, 9, 300));
+  assert (removed.size() == 1 && removed[0].version == mk_entry (3, 3, 0).version);
+  assert (index.size() == 2503);
+  index2.close();
+  index.close();
+
+  /* damaged index: rebuilt from scan */
+  FILE *f = fopen (filename.c_str(), "w");
+  fprintf (f, "garbage");
+  fclose (f);
+  assert (index.open (filename, scan));
+  assert (scanned);
+  assert (index.size() == 3);
+  index.close();
+
+  if (unlink (filename.c_str()) != 0)
+    {
+      perror ("unlink testinstencindex.idx failed");
+      return 1;
+    }
+  printf ("testinstencindex: OK\n");
+}
@@ -0,0 +1,310 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smmain.hh"
+#include "smifftsynth.hh"
+#include "sminterpsinesynth.hh"
+#include "smlivedecoder.hh"
+#include "smmath.hh"
+#include "smutils.hh"
+
+#include <vector>
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+
+/*
+ * Quality/CPU comparison: overlap-add of IFFTSynth frames (default LiveDecoder
+ * sine synthesis) vs. InterpSineSynth (interpolated sines with continuous phase)
+ *
+ * The test signal is a harmonic tone with vibrato and tremolo. Frames sample
+ * the parameters once per hop; the output is compared against the ideal signal
+ * (continuous parameters, integrated phase).
+ */
+
+using namespace SpectMorph;
+
+using std::vector;
+using std::max;
+using std::min;
+
+struct Signal
+{
+  double mix_freq     = 48000;
+  double freq         = 220;
+  int    partials     = 8;
+  double vib_cents    = 0;
+  double vib_freq     = 5.5;
+  double trem_depth   = 0;
+  double trem_freq    = 4;
+  bool   quantized    = false; // use the precision of AudioBlock (LiveDecoder)
+
+  /* parameters at time t (in samples) */
+  double
+  freq_at (double t, int partial) const
+  {
+    const double f = partial * pow (2, vib_cents / 1200 * sin (2 * M_PI * vib_freq * t / mix_freq));
+    return freq * (quantized ? sm_ifreq2freq (sm_freq2ifreq (f)) : f);
+  }
+  double
+  mag_at (double t, int partial) const
+  {
+    const double m = 0.3 / partial * (1 + trem_depth * sin (2 * M_PI * trem_freq * t / mix_freq));
+    return quantized ? sm_idb2factor (sm_factor2idb (m)) : m;
+  }
+};
+
+/* the output for the frame which is used for hop k is complete at the end of hop k */
+static inline double
+frame_time (size_t k, size_t hop)
+{
+  return (k + 1) * hop;
+}
+
+/*
+ * signal to noise ratio (in dB) of samples, compared to the ideal signal
+ *
+ * Both synthesis methods choose their own start phases, so the phase of each
+ * partial of the ideal signal is fitted to the samples first.
+ */
+static double
+snr_db (const Signal& signal, const vector<float>& samples, size_t skip)
+{
+  const size_t n = samples.size();
+
+  vector<double> ref (n), phase (n);
+  for (int p = 1; p <= signal.partials; p++)
+    {
+      double phi = 0;
+      for (size_t i = 0; i < n; i++)
+        {
+          phase[i] = phi;
+          phi = fmod (phi + 2 * M_PI * signal.freq_at (i, p) / signal.mix_freq, 2 * M_PI);
+        }
+
+      double c_sin = 0, c_cos = 0;
+      for (size_t i = skip; i < n; i++)
+        {
+          c_sin += samples[i] * sin (phase[i]);
+          c_cos += samples[i] * cos (phase[i]);
+        }
+      const double phase0 = atan2 (c_cos, c_sin);
+      for (size_t i = 0; i < n; i++)
+        ref[i] += signal.mag_at (i, p) * sin (phase[i] + phase0);
+    }
+
+  double signal_energy = 0, error_energy = 0;
+  for (size_t i = skip; i < n; i++)
+    {
+      signal_energy += ref[i] * ref[i];
+      error_energy  += (samples[i] - ref[i]) * (samples[i] - ref[i]);
+    }
+  return 10 * log10 (signal_energy / max (error_energy, 1e-30));
+}
+
+/* overlap-add of IFFTSynth frames, phase update as in LiveDecoder */
+static void
+render_ola (const Signal& signal, size_t hop, vector<float>& out)
+{
+  const size_t block_size = 2 * hop;
+
+  IFFTSynth synth (block_size, signal.mix_freq, IFFTSynth::WIN_HANNING);
+
+  vector<float> samples (block_size);
+  vector<uint32_t> phases (signal.partials);
+  vector<double> last_freqs (signal.partials);
+
+  const double iphase_factor = block_size * 2147483648.0 / signal.mix_freq;
+  for (size_t k = 0; k * hop < out.size(); k++)
+    {
+      std::copy (&samples[hop], &samples[block_size], &samples[0]);
+      zero_float_block (hop, &samples[hop]);
+
+      synth.clear_partials();
+      const double t = frame_time (k, hop);
+      for (int p = 1; p <= signal.partials; p++)
+        {
+          const double freq = signal.freq_at (t, p);
+
+          if (k > 0)
+            phases[p - 1] += uint32_t (int64_t (last_freqs[p - 1] * iphase_factor + 0.5));
+          last_freqs[p - 1] = freq;
+
+          synth.render_partial_iphase (freq, signal.mag_at (t, p), phases[p - 1]);
+        }
+      synth.get_samples (&samples[0], IFFTSynth::ADD);
+
+      const size_t todo = min (hop, out.size() - k * hop);
+      std::copy (&samples[0], &samples[todo], &out[k * hop]);
+    }
+}
+
+static void
+render_interp (const Signal& signal, size_t hop, vector<float>& out)
+{
+  InterpSineSynth synth (signal.mix_freq);
+
+  std::fill (out.begin(), out.end(), 0);
+  for (size_t k = 0; k * hop < out.size(); k++)
+    {
+      const double t = frame_time (k, hop);
+      for (int p = 1; p <= signal.partials; p++)
+        synth.add_partial (signal.freq_at (t, p), signal.mag_at (t, p));
+
+      synth.render (min (hop, out.size() - k * hop), &out[k * hop]);
+    }
+}
+
+/* LiveDecoder source: provides the frames of the test signal */
+class SignalSource : public LiveDecoderSource
+{
+  Signal     signal;
+  size_t     hop;
+  Audio      my_audio;
+  AudioBlock my_audio_block;
+public:
+  SignalSource (const Signal& signal, size_t hop) :
+    signal (signal),
+    hop (hop)
+  {
+    /* frame_step == hop (rounding down to the correct value) */
+    my_audio.frame_size_ms = 40;
+    my_audio.frame_step_ms = (hop + 0.25) * 1000 / signal.mix_freq;
+    my_audio.attack_start_ms = 0;
+    my_audio.attack_end_ms = 0;
+    my_audio.zeropad = 4;
+    my_audio.loop_type = Audio::LOOP_NONE;
+    my_audio.fundamental_freq = signal.freq;
+  }
+  void
+  retrigger (int channel, float freq, int midi_velocity, float mix_freq)
+  {
+    my_audio.mix_freq = mix_freq;
+  }
+  Audio *
+  audio()
+  {
+    return &my_audio;
+  }
+  AudioBlock *
+  audio_block (size_t index)
+  {
+    const double t = frame_time (index, hop);
+
+    my_audio_block.freqs.clear();
+    my_audio_block.mags.clear();
+    for (int p = 1; p <= signal.partials; p++)
+      {
+        my_audio_block.freqs.push_back (sm_freq2ifreq (signal.freq_at (t, p) / signal.freq));
+        my_audio_block.mags.push_back (sm_factor2idb (signal.mag_at (t, p)));
+      }
+    my_audio_block.noise.resize (32); // all 0, no noise
+    return &my_audio_block;
+  }
+};
+
+static void
+render_live (const Signal& signal, bool interpolated_sines, size_t interp_hop, vector<float>& out)
+{
+  SignalSource source (signal, 512);
+
+  LiveDecoder live_decoder (&source);
+  live_decoder.enable_noise (false);
+  live_decoder.enable_interpolated_sines (interpolated_sines, interp_hop);
+  live_decoder.retrigger (0, signal.freq, 127, signal.mix_freq);
+
+  live_decoder.process (out.size(), nullptr, &out[0]);
+}
+
+/* returns time per sample (in ns) */
+template<class Render> static double
+measure (size_t n_values, Render render)
+{
+  const int REPS = 5;
+
+  vector<float> out (n_values);
+  double min_time = 1e20;
+  for (int reps = 0; reps < REPS; reps++)
+    {
+      const double start = get_time();
+      render (out);
+      min_time = min (min_time, get_time() - start);
+    }
+  return min_time * 1e9 / n_values;
+}
+
+static Signal
+test_signal (int index)
+{
+  Signal signal;
+
+  if (index == 1)
+    {
+      signal.vib_cents = 25;
+    }
+  else if (index == 2)
+    {
+      signal.vib_cents = 100;
+      signal.trem_depth = 0.5;
+    }
+  return signal;
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  const size_t n_values = 48000 * 2;
+  vector<float> out (n_values);
+
+  printf ("# signal: 8 partials at 220 Hz, 48000 Hz; snr in dB, cpu in ns/sample\n");
+  printf ("# %-30s %6s %12s %12s %12s %12s\n", "vibrato/tremolo", "hop", "ola snr", "interp snr", "ola cpu", "interp cpu");
+  for (int s = 0; s < 3; s++)
+    {
+      const Signal signal = test_signal (s);
+
+      for (size_t hop = 128; hop <= 2048; hop *= 2)
+        {
+          const size_t skip = 4 * hop;
+
+          render_ola (signal, hop, out);
+          const double ola_snr = snr_db (signal, out, skip);
+
+          render_interp (signal, hop, out);
+          const double interp_snr = snr_db (signal, out, skip);
+
+          const double ola_ns = measure (n_values, [&] (vector<float>& out) { render_ola (signal, hop, out); });
+          const double interp_ns = measure (n_values, [&] (vector<float>& out) { render_interp (signal, hop, out); });
+
+          char name[256];
+          sprintf (name, "%.0f cents / %.0f%%", signal.vib_cents, signal.trem_depth * 100);
+          printf ("  %-30s %6zd %12.2f %12.2f %12.2f %12.2f\n", name, hop, ola_snr, interp_snr, ola_ns, interp_ns);
+        }
+    }
+
+  /* analysis hop is always 512, interpolated sines can use a larger synthesis hop */
+  printf ("\n# LiveDecoder (analysis hop 512)\n");
+  printf ("# %-30s %6s %12s %12s %12s %12s\n", "vibrato/tremolo", "hop", "ola snr", "interp snr", "ola cpu", "interp cpu");
+  for (int s = 0; s < 3; s++)
+    {
+      Signal signal = test_signal (s);
+      signal.quantized = true;
+
+      render_live (signal, false, 0, out);
+      const double ola_snr = snr_db (signal, out, 4096);
+      const double ola_ns = measure (n_values, [&] (vector<float>& out) { render_live (signal, false, 0, out); });
+
+      for (size_t hop = 512; hop <= 2048; hop *= 2)
+        {
+          render_live (signal, true, hop, out);
+          const double interp_snr = snr_db (signal, out, 4096);
+
+          const double interp_ns = measure (n_values, [&] (vector<float>& out) { render_live (signal, true, hop, out); });
+
+          char name[256];
+          sprintf (name, "%.0f cents / %.0f%%", signal.vib_cents, signal.trem_depth * 100);
+          printf ("  %-30s %6zd %12.2f %12.2f %12.2f %12.2f\n", name, hop, ola_snr, interp_snr, ola_ns, interp_ns);
+        }
+    }
+}
@@ -0,0 +1,121 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smmidisynth.hh"
+#include "smmain.hh"
+#include "smproject.hh"
+#include "smsynthinterface.hh"
+#include "smmorphlfo.hh"
+#include "smmorphoutput.hh"
+#include "smmorphwavsource.hh"
+#include "smwavset.hh"
+
+#include <assert.h>
+
+/*
+ * MidiSynth processes long host blocks in sub-blocks; the result must be the
+ * same as if the host had used short blocks (in particular LFO time must advance
+ * for every sub-block).
+ */
+
+using namespace SpectMorph;
+
+using std::vector;
+using std::max;
+
+/* one wave, magnitude of the partials changes from frame to frame */
+static WavSet *
+create_wav_set()
+{
+  WavSet *wav_set = new WavSet();
+
+  WavSetWave wave;
+  wave.midi_note = 60;
+  wave.audio = new Audio();
+  wave.audio->fundamental_freq = 440 * pow (2, (60 - 69) / 12.);
+  wave.audio->mix_freq = 48000;
+  wave.audio->frame_size_ms = 40;
+  wave.audio->frame_step_ms = 10;
+  wave.audio->attack_start_ms = 0;
+  wave.audio->attack_end_ms = 0;
+  wave.audio->zeropad = 4;
+  wave.audio->contents.resize (100);
+  for (size_t i = 0; i < wave.audio->contents.size(); i++)
+    {
+      AudioBlock& block = wave.audio->contents[i];
+
+      for (int p = 1; p <= 4; p++)
+        {
+          block.freqs.push_back (sm_freq2ifreq (p));
+          block.mags.push_back (sm_factor2idb ((0.05 + 0.9 * i / 99.) / p));
+        }
+      block.noise.resize (32); // all 0, no noise
+    }
+  wav_set->waves.push_back (wave);
+  return wav_set;
+}
+
+/* wav source with custom position, position controlled by LFO */
+static MorphPlanPtr
+create_plan (Project& project)
+{
+  MorphPlanPtr plan = new MorphPlan (project);
+
+  MorphOperator *lfo = MorphOperator::create ("SpectMorph::MorphLFO", plan.c_ptr());
+  plan->add_operator (lfo);
+  lfo->property (MorphLFO::P_FREQUENCY)->set_float (7);
+
+  MorphWavSource *source = dynamic_cast<MorphWavSource *> (MorphOperator::create ("SpectMorph::MorphWavSource", plan.c_ptr()));
+  plan->add_operator (source);
+  source->set_object_id (1);
+  source->property (MorphWavSource::P_PLAY_MODE)->set (MorphWavSource::PLAY_MODE_CUSTOM_POSITION);
+  source->property (MorphWavSource::P_POSITION)->modulation_list()->set_main_control_type_and_op (MorphOperator::CONTROL_OP, lfo);
+
+  MorphOutput *output = dynamic_cast<MorphOutput *> (MorphOperator::create ("SpectMorph::MorphOutput", plan.c_ptr()));
+  plan->add_operator (output);
+  output->set_channel_op (0, source);
+
+  return plan;
+}
+
+static vector<float>
+render (MorphPlanPtr plan, size_t block_size, size_t n_values)
+{
+  MidiSynth midi_synth (48000, 16 /* voices */);
+
+  auto update = midi_synth.prepare_update (plan);
+  midi_synth.apply_update (update);
+
+  const unsigned char note_on[3] = { 0x90, 60, 100 };
+  midi_synth.add_midi_event (0, note_on);
+
+  vector<float> output (n_values);
+  for (size_t offset = 0; offset < n_values; offset += block_size)
+    midi_synth.process (&output[offset], block_size);
+
+  return output;
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  Project project;
+  project.add_rebuild_result (1, create_wav_set());
+
+  MorphPlanPtr plan = create_plan (project);
+
+  const size_t n_values = 48 * 1024;
+  const vector<float> out_1024 = render (plan, 1024, n_values);
+  const vector<float> out_256  = render (plan, 256, n_values);
+
+  double max_diff = 0, max_value = 0;
+  for (size_t i = 0; i < n_values; i++)
+    {
+      max_diff = max<double> (max_diff, fabs (out_1024[i] - out_256[i]));
+      max_value = max<double> (max_value, fabs (out_256[i]));
+    }
+  printf ("max value %f, max diff 1024 <-> 4 x 256 %g\n", max_value, max_diff);
+  assert (max_value > 0.01);
+  assert (max_diff == 0);
+}
@@ -0,0 +1,124 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smmain.hh"
+#include "smrandom.hh"
+#include "smifftsynth.hh"
+#include "smoscbanksynth.hh"
+#include "smnoisedecoder.hh"
+#include "smutils.hh"
+
+#include <vector>
+
+#include <assert.h>
+#include <math.h>
+
+using namespace SpectMorph;
+using std::vector;
+using std::max;
+using std::min;
+
+struct Partial
+{
+  double   freq;
+  double   mag;
+  uint32_t iphase;
+};
+
+static vector<Partial>
+random_partials (Random& random, size_t n_partials, double mix_freq)
+{
+  vector<Partial> partials;
+  for (size_t i = 0; i < n_partials; i++)
+    {
+      Partial p;
+      p.freq = random.random_double_range (50, mix_freq * 0.4);
+      p.mag = random.random_double_range (0.01, 1.0 / n_partials);
+      p.iphase = random.random_uint32();
+      partials.push_back (p);
+    }
+  return partials;
+}
+
+template<class Synth> static void
+render (Synth& synth, const vector<Partial>& partials, float *samples)
+{
+  synth.clear_partials();
+  for (const auto& p : partials)
+    synth.render_partial_iphase (p.freq, p.mag, p.iphase);
+  synth.get_samples (samples, IFFTSynth::ADD);
+}
+
+/* returns time per frame (in ns) */
+template<class Synth> static double
+measure (Synth& synth, const vector<Partial>& partials, float *samples)
+{
+  double min_time = 1e20;
+  const int RUNS = 200, REPS = 7;
+  for (int reps = 0; reps < REPS; reps++)
+    {
+      double start = get_time();
+      for (int r = 0; r < RUNS; r++)
+        render (synth, partials, samples);
+      double end = get_time();
+      min_time = min (min_time, end - start);
+    }
+  return min_time * 1e9 / RUNS;
+}
+
+static void
+crossover_perf (double mix_freq)
+{
+  const size_t block_size = NoiseDecoder::preferred_block_size (mix_freq);
+
+  IFFTSynth    ifft_synth (block_size, mix_freq, IFFTSynth::WIN_HANNING);
+  OscBankSynth osc_synth (block_size, mix_freq);
+
+  Random random;
+  random.set_seed (42);
+
+  vector<float> ifft_samples (block_size);
+  vector<float> osc_samples (block_size);
+
+  printf ("# mix_freq = %.0f, block_size = %zd\n", mix_freq, block_size);
+  printf ("# partials     ifft ns/frame   oscbank ns/frame   max_diff   faster_than_ifft\n");
+
+  size_t crossover = 0;
+  for (size_t n_partials = 1; n_partials <= 64; n_partials = n_partials < 16 ? n_partials + 1 : n_partials * 2)
+    {
+      const vector<Partial> partials = random_partials (random, n_partials, mix_freq);
+
+      /* both synthesis methods should produce (almost) the same output */
+      std::fill (ifft_samples.begin(), ifft_samples.end(), 0);
+      std::fill (osc_samples.begin(), osc_samples.end(), 0);
+      render (ifft_synth, partials, &ifft_samples[0]);
+      render (osc_synth, partials, &osc_samples[0]);
+
+      double max_diff = 0;
+      for (size_t i = 0; i < block_size; i++)
+        max_diff = max<double> (max_diff, fabs (ifft_samples[i] - osc_samples[i]));
+
+      /* IFFTSynth uses a 12 bit phase, so the error can be up to mag * 2 * pi / 8192 per partial (plus IFFTSynth approximation error) */
+      double mag_sum = 0;
+      for (const auto& p : partials)
+        mag_sum += p.mag;
+      assert (max_diff < mag_sum * 2e-3);
+
+      const double ifft_ns = measure (ifft_synth, partials, &ifft_samples[0]);
+      const double osc_ns = measure (osc_synth, partials, &osc_samples[0]);
+      if (osc_ns < ifft_ns)
+        crossover = n_partials;
+
+      printf ("%10zd %15.1f %18.1f %10.3g %18s\n", n_partials, ifft_ns, osc_ns, max_diff,
+              OscBankSynth::faster_than_ifft (block_size, n_partials) ? "yes" : "no");
+    }
+  printf ("# crossover: oscillator bank is faster for up to %zd partials\n\n", crossover);
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  for (auto mix_freq : { 44100, 48000, 96000 })
+    crossover_perf (mix_freq);
+}
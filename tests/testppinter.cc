@@ -51,6 +51,43 @@ sin_test (double freq, double db_bound)
   assert (error < db_to_factor (db_bound));
 }
 
+void
+block_test()
+{
+  PolyPhaseInter *ppi = PolyPhaseInter::the();
+
+  vector<float> signal (1000);
+  for (size_t i = 0; i < signal.size(); i++)
+    signal[i] = g_random_double_range (-1, 1);
+
+  /* constant increment: includes positions before the start and after the end of the signal */
+  double error = 0;
+  for (double inc : { 0.456, 1.0, 1.3, 2.01 })
+    {
+      vector<float> out (1000);
+
+      const double start_pos = -20.3;
+      const double end_pos = ppi->get_samples (signal, start_pos, inc, out.size(), &out[0]);
+      assert (fabs (end_pos - (start_pos + out.size() * inc)) < 1e-9);
+
+      for (size_t i = 0; i < out.size(); i++)
+        error = max<double> (error, fabs (out[i] - ppi->get_sample (signal, start_pos + i * inc)));
+    }
+
+  /* position array (like portamento) */
+  vector<double> pos (500);
+  vector<float>  out (pos.size());
+  for (size_t i = 0; i < pos.size(); i++)
+    pos[i] = 100 + i * (1 + 0.3 * sin (i * 0.01));
+
+  ppi->get_samples_no_check (signal, &pos[0], pos.size(), &out[0]);
+  for (size_t i = 0; i < pos.size(); i++)
+    error = max<double> (error, fabs (out[i] - ppi->get_sample (signal, pos[i])));
+
+  printf ("block error: %g\n", error);
+  assert (error < 1e-6);
+}
+
 void
 sweep_test()
 {
@@ -219,7 +256,7 @@ speed_test()
       signal[i] = g_random_double_range (-1, 1);
     }
 
-  double t[2];
+  double t[3];
 
   vector<float> result (SR);
 
@@ -240,11 +277,20 @@ speed_test()
   end = get_time();
   t[0] = end - start;
 
-  for (int checks = 0; checks < 2; checks++)
+  start = get_time();
+  for (size_t k = 0; k < RUNS; k++)
+    ppi->get_samples (signal, PADDING * 0.987, 0.987, result.size() - PADDING, &result[PADDING]);
+  end = get_time();
+  t[2] = end - start;
+
+  for (int checks = 0; checks < 3; checks++)
     {
       double ns_per_sec = 1e9;
       double ns_per_sample = t[checks] * ns_per_sec / (RUNS * (result.size() - PADDING));
-      printf (" ** checks = %d\n", checks);
+      if (checks == 2)
+        printf (" ** block\n");
+      else
+        printf (" ** checks = %d\n", checks);
       printf ("interp: %f ns/sample\n", ns_per_sample);
       printf ("bogopolyphony = %f\n", ns_per_sec / (ns_per_sample * 48000));
       printf ("\n");
@@ -310,5 +356,6 @@ main (int argc, char **argv)
     {
       sin_test (440, -85);
       sin_test (2000, -75);
+      block_test();
     }
 }
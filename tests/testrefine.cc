@@ -0,0 +1,198 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smmain.hh"
+#include "smencoder.hh"
+#include "smmath.hh"
+#include "smalignedarray.hh"
+#include "smwavdata.hh"
+
+#include <assert.h>
+#include <stdlib.h>
+
+using namespace SpectMorph;
+
+using std::vector;
+using std::string;
+
+static double
+normalize_phase (double phase)
+{
+  phase /= 2 * M_PI;
+  phase -= floor (phase);
+  return phase * 2 * M_PI;
+}
+
+/* reference: straightforward (full frame) version of Encoder::refine_sine_params */
+static void
+refine_reference (EncoderBlock& audio_block, double mix_freq, const vector<float>& window)
+{
+  const size_t frame_size = audio_block.debug_samples.size();
+
+  AlignedArray<float, 16> sin_vec (frame_size);
+  AlignedArray<float, 16> cos_vec (frame_size);
+  AlignedArray<float, 16> sines (frame_size);
+  AlignedArray<float, 16> all_sines (frame_size);
+
+  vector<float> good_freqs;
+  vector<float> good_mags;
+  vector<float> good_phases;
+
+  double window_weight = 0;
+  for (size_t i = 0; i < frame_size; i++)
+    window_weight += window[i];
+
+  for (size_t i = 0; i < audio_block.freqs.size(); i++)
+    {
+      VectorSinParams params;
+
+      params.mix_freq = mix_freq;
+      params.freq     = audio_block.freqs[i];
+      params.mag      = audio_block.mags[i];
+      params.phase    = audio_block.phases[i];
+      params.mode     = VectorSinParams::ADD;
+
+      fast_vector_sinf (params, &all_sines[0], &all_sines[frame_size]);
+    }
+
+  double max_mag;
+  size_t partial = 0;
+  do
+    {
+      max_mag = 0;
+      for (size_t i = 0; i < audio_block.freqs.size(); i++)
+        {
+          if (audio_block.mags[i] > max_mag)
+            {
+              partial = i;
+              max_mag = audio_block.mags[i];
+            }
+        }
+      if (max_mag > 0)
+        {
+          double f = audio_block.freqs[partial];
+
+          audio_block.mags[partial] = 0;
+
+          VectorSinParams params;
+
+          params.mix_freq = mix_freq;
+          params.freq = f;
+          params.mag = 1;
+          params.phase = normalize_phase (-((frame_size - 1) / 2.0) * f / mix_freq * 2.0 * M_PI);
+          params.mode = VectorSinParams::REPLACE;
+
+          fast_vector_sincosf (params, &sin_vec[0], &sin_vec[frame_size], &cos_vec[0]);
+
+          params.mag   = max_mag;
+          params.phase = audio_block.phases[partial];
+
+          fast_vector_sinf (params, &sines[0], &sines[frame_size]);
+
+          double x_re = 0;
+          double x_im = 0;
+          for (size_t n = 0; n < frame_size; n++)
+            {
+              double v = (audio_block.debug_samples[n] - all_sines[n] + sines[n]) * window[n];
+
+              x_re += v * cos_vec[n];
+              x_im -= v * sin_vec[n];
+            }
+
+          params.freq = 2 * f;
+          params.mag = 1;
+          params.phase = normalize_phase (-((frame_size - 1) / 2.0) * (2 * f) / mix_freq * 2.0 * M_PI + 0.5 * M_PI);
+          fast_vector_sinf (params, &cos_vec[0], &cos_vec[frame_size]);
+
+          double w2omega = 0;
+          for (size_t n = 0; n < frame_size; n++)
+            w2omega += window[n] * cos_vec[n];
+
+          x_re *= 2 / (window_weight + w2omega);
+          x_im *= 2 / (window_weight - w2omega);
+
+          double magnitude = sqrt (x_re * x_re + x_im * x_im);
+          double phase = atan2 (x_im, x_re) + 0.5 * M_PI;
+          phase -= (frame_size - 1) / 2.0 / mix_freq * f * 2 * M_PI;
+          phase = normalize_phase (phase);
+
+          good_freqs.push_back (f);
+          good_mags.push_back (magnitude);
+          good_phases.push_back (phase);
+        }
+    }
+  while (max_mag > 0);
+
+  audio_block.freqs = good_freqs;
+  audio_block.mags = good_mags;
+  audio_block.phases = good_phases;
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  const char *srcdir = getenv ("srcdir");
+  string filename = string (srcdir ? srcdir : ".") + "/saw440.wav";
+
+  WavData wav_data;
+  if (!wav_data.load_mono (filename))
+    {
+      fprintf (stderr, "testrefine: can't load %s: %s\n", filename.c_str(), wav_data.error_blurb());
+      return 1;
+    }
+
+  EncoderParams enc_params;
+  enc_params.setup_params (wav_data, 440);
+
+  /* optimization level 0: blocks contain fft estimates & debug samples */
+  Encoder encoder (enc_params);
+  bool ok = encoder.encode (wav_data, 0, /* optimization level */ 0, /* attack */ false, /* track sines */ true);
+  assert (ok);
+  assert (encoder.audio_blocks.size() > 50);
+
+  size_t n_partials = 0;
+  double max_mag_delta = 0;
+  double max_complex_delta = 0;
+  for (const auto& block : encoder.audio_blocks)
+    {
+      EncoderBlock ref_block = block;
+      EncoderBlock new_block = block;
+
+      refine_reference (ref_block, enc_params.mix_freq, enc_params.window);
+      encoder.refine_sine_params (new_block);
+
+      assert (ref_block.freqs.size() == new_block.freqs.size());
+
+      double max_mag = 0;
+      for (auto mag : ref_block.mags)
+        max_mag = std::max<double> (max_mag, mag);
+
+      for (size_t i = 0; i < ref_block.freqs.size(); i++)
+        {
+          assert (ref_block.freqs[i] == new_block.freqs[i]);
+
+          const double ref_mag = ref_block.mags[i];
+          const double new_mag = new_block.mags[i];
+          const double ref_phase = ref_block.phases[i];
+          const double new_phase = new_block.phases[i];
+
+          /* compare as complex value, relative to the loudest partial of the frame */
+          const double re_delta = ref_mag * cos (ref_phase) - new_mag * cos (new_phase);
+          const double im_delta = ref_mag * sin (ref_phase) - new_mag * sin (new_phase);
+          const double complex_delta = sqrt (re_delta * re_delta + im_delta * im_delta) / max_mag;
+
+          max_complex_delta = std::max (max_complex_delta, complex_delta);
+          if (ref_mag > max_mag * 1e-3)
+            max_mag_delta = std::max (max_mag_delta, fabs (ref_mag - new_mag) / ref_mag);
+
+          n_partials++;
+        }
+    }
+  printf ("testrefine: %zd partials, max_mag_delta=%g, max_complex_delta=%g\n", n_partials, max_mag_delta, max_complex_delta);
+
+  assert (n_partials > 1000);
+  assert (max_mag_delta < 1e-4);
+  assert (max_complex_delta < 1e-5);
+  printf ("testrefine: OK\n");
+}
@@ -0,0 +1,122 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smmain.hh"
+#include "smrandom.hh"
+#include "smpandaresampler.hh"
+#include "smutils.hh"
+
+#include <vector>
+
+#include <assert.h>
+#include <math.h>
+
+using namespace SpectMorph;
+using PandaResampler::Resampler2;
+using std::vector;
+using std::max;
+using std::min;
+
+enum class Kernel { SCALAR, SSE, AVX2 };
+
+static const char *
+kernel_name (Kernel kernel)
+{
+  switch (kernel)
+    {
+      case Kernel::SCALAR: return "scalar";
+      case Kernel::SSE:    return "sse";
+      case Kernel::AVX2:   return "avx2";
+    }
+  return "";
+}
+
+static vector<float>
+resample (Resampler2& resampler, Resampler2::Mode mode, const vector<float>& in, uint block_size)
+{
+  vector<float> out (mode == Resampler2::UP ? in.size() * 2 : in.size() / 2);
+
+  float *out_ptr = &out[0];
+  for (size_t pos = 0; pos < in.size(); pos += block_size)
+    {
+      const uint n = min<size_t> (block_size, in.size() - pos);
+      resampler.process_block (&in[pos], n, out_ptr);
+      out_ptr += mode == Resampler2::UP ? n * 2 : n / 2;
+    }
+  return out;
+}
+
+static void
+resampler_perf (Resampler2::Mode mode, Resampler2::Precision precision)
+{
+  const uint block_size = 256;
+  const uint n_samples  = block_size * 64;
+
+  Random random;
+  random.set_seed (42);
+
+  /* extra space: the resampler may read a few samples beyond the end of the input */
+  vector<float> in (n_samples + 64);
+  for (auto& f : in)
+    f = random.random_double_range (-1.0, 1.0);
+  in.resize (n_samples);
+
+  vector<float> ref_out;
+  for (auto kernel : { Kernel::SCALAR, Kernel::SSE, Kernel::AVX2 })
+    {
+      if (kernel != Kernel::SCALAR && !Resampler2::sse_available())
+        continue;
+      if (kernel == Kernel::AVX2 && !Resampler2::avx2_available())
+        {
+          printf ("%s %-16s %-6s not available\n", mode == Resampler2::UP ? "  up" : "down", Resampler2::precision_name (precision), kernel_name (kernel));
+          continue;
+        }
+
+      Resampler2 resampler (mode, 2, precision, kernel != Kernel::SCALAR, kernel == Kernel::AVX2);
+      assert (resampler.sse_enabled() == (kernel != Kernel::SCALAR));
+      assert (resampler.avx2_enabled() == (kernel == Kernel::AVX2));
+
+      /* all kernels should produce (almost) the same output */
+      vector<float> out = resample (resampler, mode, in, block_size);
+      if (ref_out.empty())
+        ref_out = out;
+
+      double max_diff = 0;
+      for (size_t i = 0; i < out.size(); i++)
+        max_diff = max<double> (max_diff, fabs (out[i] - ref_out[i]));
+      assert (max_diff < 1e-5);
+
+      double min_time = 1e20;
+      const int RUNS = 50, REPS = 13;
+      for (int reps = 0; reps < REPS; reps++)
+        {
+          double start = get_time();
+          for (int r = 0; r < RUNS; r++)
+            resample (resampler, mode, in, block_size);
+          double end = get_time();
+          min_time = min (min_time, end - start);
+        }
+
+      const double ns_per_sec = 1e9;
+      const double time_norm = ns_per_sec / RUNS / n_samples;
+
+      printf ("%s %-16s %-6s %f ns/sample  (max_diff %g)\n", mode == Resampler2::UP ? "  up" : "down", Resampler2::precision_name (precision),
+              kernel_name (kernel), min_time * time_norm, max_diff);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  if (!Resampler2::test_filter_impl (false))
+    return 1;
+
+  for (auto mode : { Resampler2::UP, Resampler2::DOWN })
+    {
+      for (auto precision : { Resampler2::PREC_48DB, Resampler2::PREC_72DB, Resampler2::PREC_96DB, Resampler2::PREC_120DB, Resampler2::PREC_144DB })
+        resampler_perf (mode, precision);
+
+      printf ("------------------------\n");
+    }
+}
@@ -0,0 +1,79 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smmain.hh"
+#include "smspectralfilter.hh"
+#include "smladdervcf.hh"
+
+#include <vector>
+
+#include <assert.h>
+
+using namespace SpectMorph;
+
+using std::vector;
+
+/* measure gain of LadderVCFNonLinear for a sine wave (small signal => linear) */
+static double
+measure_gain (LadderVCFMode mode, double freq, double cutoff, double reso, double mix)
+{
+  const double mix_freq = 48000;
+  const size_t n_samples = 24000;
+  const float  amplitude = 0.1;
+
+  vector<float> in (n_samples + 256), out (n_samples + 256);
+  for (size_t i = 0; i < n_samples; i++)
+    in[i] = sin (i * freq * 2 * M_PI / mix_freq) * amplitude;
+
+  vector<float> freq_in (n_samples, cutoff), reso_in (n_samples, reso), mix_in (n_samples, mix);
+
+  LadderVCFNonLinear filter;
+  filter.set_mode (mode);
+  filter.set_mix_in (&mix_in[0]);
+
+  float junk[n_samples];
+  const float *inputs[2] = { &in[0], junk };
+  float *outputs[2] = { &out[0], junk };
+  filter.run_block (n_samples, 0, 0, inputs, outputs, true, false, &freq_in[0], &reso_in[0]);
+
+  /* skip transient response */
+  double energy = 0;
+  for (size_t i = n_samples / 2; i < n_samples; i++)
+    energy += out[i] * out[i];
+
+  return sqrt (2 * energy / (n_samples / 2)) / amplitude;
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  double max_delta_db = 0;
+  for (auto mode : { LadderVCFMode::LP1, LadderVCFMode::LP2, LadderVCFMode::LP4 })
+    {
+      for (double reso : { 0.0, 0.5, 0.8 })
+        {
+          for (double mix : { 1.0, 0.6 })
+            {
+              SpectralFilter spectral_filter;
+              spectral_filter.set_mode (mode);
+              spectral_filter.set_mix_freq (48000);
+              spectral_filter.set_params (1000, reso, mix);
+
+              for (double freq : { 100, 440, 900, 1000, 1200, 2000, 5000 })
+                {
+                  const double measured = measure_gain (mode, freq, 1000, reso, mix);
+                  const double computed = spectral_filter.gain (freq);
+
+                  /* ignore strongly attenuated frequencies */
+                  if (measured > 0.01)
+                    max_delta_db = std::max (max_delta_db, fabs (db_from_factor (measured, -200) - db_from_factor (computed, -200)));
+                }
+            }
+        }
+    }
+  printf ("testspectralfilter: max_delta_db=%f\n", max_delta_db);
+  assert (max_delta_db < 0.5);
+
+  printf ("testspectralfilter: OK\n");
+}
@@ -0,0 +1,291 @@
+// Licensed GNU LGPL v2.1 or later: http://www.gnu.org/licenses/lgpl-2.1.html
+
+#include "smmain.hh"
+#include "smwavset.hh"
+#include "smwavsetrepo.hh"
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include <algorithm>
+#include <thread>
+
+using namespace SpectMorph;
+
+using std::vector;
+using std::string;
+
+static void
+create_wav_set (const string& filename)
+{
+  WavSet wav_set;
+
+  for (int note = 36; note < 96; note += 12)
+    {
+      WavSetWave wave;
+
+      wave.midi_note = note;
+      wave.audio = new Audio();
+      wave.audio->fundamental_freq = 440 * pow (2, (note - 69) / 12.);
+      wave.audio->mix_freq = 48000;
+      wave.audio->frame_step_ms = 10;
+      wave.audio->contents.resize (10 + note);
+      for (auto& block : wave.audio->contents)
+        block.noise.resize (32);
+
+      wav_set.waves.push_back (wave);
+    }
+  wav_set.save (filename);
+}
+
+/* check if file is open or memory mapped (always false if /proc is not available) */
+static bool
+file_in_use (const string& filename)
+{
+  char *path = realpath (filename.c_str(), nullptr);
+  assert (path);
+
+  bool in_use = false;
+  if (DIR *dir = opendir ("/proc/self/fd"))
+    {
+      while (struct dirent *entry = readdir (dir))
+        {
+          char link[PATH_MAX + 1];
+          ssize_t len = readlink ((string ("/proc/self/fd/") + entry->d_name).c_str(), link, PATH_MAX);
+          if (len > 0 && string (link, len) == path)
+            in_use = true;
+        }
+      closedir (dir);
+    }
+  if (FILE *maps = fopen ("/proc/self/maps", "r"))
+    {
+      char line[PATH_MAX + 256];
+      while (fgets (line, sizeof (line), maps))
+        if (strstr (line, path))
+          in_use = true;
+      fclose (maps);
+    }
+  free (path);
+  return in_use;
+}
+
+static void
+test_demand_load (const string& filename)
+{
+  WavSet wav_set;
+  Error error = wav_set.load (filename, AUDIO_SKIP_FRAMES);
+  assert (!error);
+  assert (wav_set.waves.size() == 5);
+
+  /* the file is not kept open for loading the frames later */
+  assert (!file_in_use (filename));
+
+  for (auto& wave : wav_set.waves)
+    {
+      assert (wave.audio->contents.empty());
+      assert (wave.audio->fundamental_freq > 0);
+      assert (!wav_set.audio_loaded (wave.audio));
+    }
+
+  /* nothing is loaded: no audio available, but load is requested */
+  const float freq = 440 * pow (2, (60 - 69) / 12.);
+  assert (wav_set.find_audio (0, freq, 100) == nullptr);
+
+  wav_set.load_requested();
+
+  Audio *audio = wav_set.find_audio (0, freq, 100);
+  assert (audio == wav_set.waves[2].audio);
+  assert (audio->contents.size() == 70);
+
+  /* best match not loaded: fall back to nearest loaded audio */
+  const float freq_high = 440 * pow (2, (72 - 69) / 12.);
+  assert (wav_set.find_audio (0, freq_high, 100) == audio);
+
+  wav_set.load_requested();
+  assert (wav_set.find_audio (0, freq_high, 100) == wav_set.waves[3].audio);
+
+  /* prefetch */
+  wav_set.prefetch (0, 40);
+  wav_set.load_requested();
+  assert (wav_set.audio_loaded (wav_set.waves[0].audio));
+  assert (!wav_set.audio_loaded (wav_set.waves[1].audio));
+  assert (wav_set.waves[0].audio->contents.size() == 46);
+}
+
+/* demand loading with the background loader thread of the repo */
+static void
+test_repo_demand_load (const string& filename)
+{
+  WavSetRepo repo;
+  repo.set_demand_load (true);
+
+  std::shared_ptr<WavSet> wav_set = repo.get (filename);
+  const size_t header_bytes = repo.stats().resident_bytes;
+
+  const float freq = 440 * pow (2, (60 - 69) / 12.);
+  assert (wav_set->find_audio (0, freq, 100) == nullptr);
+
+  /* the request wakes up the loader thread */
+  Audio *audio = nullptr;
+  for (int i = 0; i < 10000 && !audio; i++)
+    {
+      usleep (1000);
+      audio = wav_set->find_audio (0, freq, 100);
+    }
+  assert (audio == wav_set->waves[2].audio);
+  assert (audio->contents.size() == 70);
+
+  /* the memory usage of the wav set is updated after loading */
+  for (int i = 0; i < 10000 && repo.stats().resident_bytes != wav_set->memory_usage(); i++)
+    usleep (1000);
+  assert (repo.stats().resident_bytes == wav_set->memory_usage());
+  assert (repo.stats().resident_bytes > header_bytes);
+}
+
+static void
+test_repo (const string& filename_a, const string& filename_b, const string& filename_c)
+{
+  WavSetRepo repo;
+
+  /* no budget: everything stays in the repo */
+  std::shared_ptr<WavSet> a = repo.get (filename_a);
+  assert (a->waves.size() == 5);
+  assert (repo.get (filename_a) == a);
+
+  WavSetRepo::Stats stats = repo.stats();
+  assert (stats.wav_sets == 1);
+  assert (stats.misses == 1 && stats.hits == 1 && stats.evictions == 0);
+  assert (stats.resident_bytes == a->memory_usage());
+
+  const size_t a_bytes = stats.resident_bytes;
+
+  /* budget exceeded: b can not be evicted while it is referenced, unreferenced a is evicted */
+  repo.set_memory_budget (a_bytes + 1);
+  a.reset();
+
+  std::shared_ptr<WavSet> b = repo.get (filename_b);
+
+  stats = repo.stats();
+  assert (stats.wav_sets == 1);
+  assert (stats.evictions == 1);
+  assert (stats.resident_bytes == b->memory_usage());
+
+  /* a referenced: loading a again must not evict b */
+  a = repo.get (filename_a);
+
+  stats = repo.stats();
+  assert (stats.wav_sets == 2);
+  assert (stats.misses == 3 && stats.hits == 1 && stats.evictions == 1);
+
+  /* least recently used unreferenced set is evicted first (all sets have the same size) */
+  repo.set_memory_budget (a_bytes * 2 + 1);
+  b.reset();
+  a.reset();
+  repo.get (filename_a);
+  repo.get (filename_c);
+
+  stats = repo.stats();
+  assert (stats.wav_sets == 2);
+  assert (stats.evictions == 2);
+
+  repo.get (filename_a);
+  assert (repo.stats().hits == 3);
+}
+
+static void
+test_preload (const string& filename_a, const string& filename_b, const string& filename_c)
+{
+  WavSetRepo repo;
+
+  auto wav_sets = repo.preload ({ filename_a, filename_b, filename_c, filename_a });
+  assert (wav_sets.size() == 3);
+
+  WavSetRepo::Stats stats = repo.stats();
+  assert (stats.wav_sets == 3);
+  assert (stats.misses == 3 && stats.hits == 0);
+
+  for (auto f : { filename_a, filename_b, filename_c })
+    {
+      auto wav_set = repo.get (f);
+      assert (wav_set->waves.size() == 5);
+      assert (std::find (wav_sets.begin(), wav_sets.end(), wav_set) != wav_sets.end());
+    }
+  assert (repo.stats().hits == 3);
+
+  /* concurrent get() for the same file: only loaded once */
+  WavSetRepo repo2;
+  vector<std::thread> threads;
+  vector<std::shared_ptr<WavSet>> results (8);
+  for (size_t i = 0; i < results.size(); i++)
+    threads.emplace_back ([&, i]() { results[i] = repo2.get (filename_a); });
+  for (auto& t : threads)
+    t.join();
+
+  for (auto r : results)
+    assert (r && r == results[0]);
+  assert (repo2.stats().misses == 1 && repo2.stats().hits == 7);
+}
+
+static void
+test_repo_threads (const string& filename_a, const string& filename_b, const string& filename_c)
+{
+  /* tiny budget: every miss evicts all unreferenced wav sets */
+  WavSetRepo repo;
+  repo.set_memory_budget (1);
+
+  const int n_threads = 4;
+  const int n_runs = 200;
+
+  vector<std::thread> threads;
+  for (int t = 0; t < n_threads; t++)
+    threads.emplace_back ([&]() {
+      for (int i = 0; i < n_runs; i++)
+        {
+          for (auto f : { filename_a, filename_b, filename_c })
+            {
+              /* a wav set returned by get() must not be evicted, so get() must return it again */
+              std::shared_ptr<WavSet> wav_set = repo.get (f);
+              assert (repo.get (f) == wav_set);
+            }
+        }
+    });
+  for (auto& t : threads)
+    t.join();
+
+  WavSetRepo::Stats stats = repo.stats();
+  assert (stats.hits + stats.misses == n_threads * n_runs * 3 * 2);
+  assert (stats.misses == stats.evictions + stats.wav_sets);
+}
+
+int
+main (int argc, char **argv)
+{
+  Main main (&argc, &argv);
+
+  const string filename = "testwavsetload.smset";
+  const string filename_b = "testwavsetload_b.smset";
+  const string filename_c = "testwavsetload_c.smset";
+
+  create_wav_set (filename);
+  create_wav_set (filename_b);
+  create_wav_set (filename_c);
+  test_demand_load (filename);
+  test_repo_demand_load (filename);
+  test_repo (filename, filename_b, filename_c);
+  test_preload (filename, filename_b, filename_c);
+  test_repo_threads (filename, filename_b, filename_c);
+
+  for (auto f : { filename, filename_b, filename_c })
+    {
+      if (unlink (f.c_str()) != 0)
+        {
+          perror (("unlink " + f + " failed").c_str());
+          return 1;
+        }
+    }
+  printf ("testwavsetload: OK\n");
+}
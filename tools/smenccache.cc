@@ -14,6 +14,7 @@ struct Options
 {
   string	 program_name; /* FIXME: what to do with that */
   string         config_filename;
+  string         profile_filename;
   vector<string> args;
 
   Options ();
@@ -110,6 +111,11 @@ Options::parse (int   *argc_p,
           args.push_back (string_printf ("--config %s", opt_arg));
           config_filename = opt_arg;
         }
+      else if (check_arg (argc, argv, &i, "--profile", &opt_arg))
+        {
+          /* not part of args: the profile doesn't affect the encoder result */
+          profile_filename = opt_arg;
+        }
      }
 
   /* resort argc/argv */
@@ -140,6 +146,7 @@ Options::print_usage ()
   printf (" --no-sines                  skip partial tracking\n");
   printf (" --loop-start                set timeloop start\n");
   printf (" --loop-end                  set timeloop end\n");
+  printf (" --profile <file>            write encoder profile to file (JSON, empty list if cached)\n");
   printf ("\n");
 }
 
@@ -166,6 +173,8 @@ main (int argc, char **argv)
       for (vector<string>::iterator ai = options.args.begin(); ai != options.args.end(); ai++)
         cmdargs += " " + *ai;
       cmdline += cmdargs;
+      if (options.profile_filename != "")
+        cmdline += string_printf (" --profile \"%s\"", options.profile_filename.c_str());
 
       /* hash commandline args */
       vector<unsigned char> data;
@@ -202,6 +211,15 @@ main (int argc, char **argv)
       FILE *cache_file = fopen (cache_filename.c_str(), "r");
       if (cache_file)
         {
+          if (options.profile_filename != "")
+            {
+              /* nothing was encoded */
+              FILE *profile_file = fopen (options.profile_filename.c_str(), "w");
+              if (!profile_file)
+                die ("can't write profile");
+              fprintf (profile_file, "[]\n");
+              fclose (profile_file);
+            }
           string cpcmd = string_printf ("cp %s %s", cache_filename.c_str(), argv[2]);
           int cret = system (cpcmd.c_str());
           int cxstatus = WEXITSTATUS (cret);
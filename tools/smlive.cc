@@ -36,6 +36,9 @@ struct Options
   bool        noise_enabled = true;
   bool        sines_enabled = true;
   bool        deterministic_random = false;
+  bool        low_latency = false;
+  bool        interpolated_sines = false;
+  int         interp_hop = 0;
 
   Options ();
   void parse (int *argc_p, char **argv_p[]);
@@ -143,6 +146,18 @@ Options::parse (int   *argc_p,
         {
           deterministic_random = true;
         }
+      else if (check_arg (argc, argv, &i, "--low-latency"))
+        {
+          low_latency = true;
+        }
+      else if (check_arg (argc, argv, &i, "--interp-sines"))
+        {
+          interpolated_sines = true;
+        }
+      else if (check_arg (argc, argv, &i, "--interp-hop", &opt_arg))
+        {
+          interp_hop = atoi (opt_arg);
+        }
     }
 
   /* resort argc/argv */
@@ -176,6 +191,9 @@ Options::print_usage ()
   printf (" --no-noise                    disable noise decoder\n");
   printf (" --no-sines                    disable sine decoder\n");
   printf (" --det-random                  use deterministic/reproducable random generator\n");
+  printf (" --low-latency                 use low latency decoding (shorter synthesis window)\n");
+  printf (" --interp-sines                interpolate sines between frames (no overlap-add)\n");
+  printf (" --interp-hop <samples>        synthesis hop for interpolated sines (without noise)\n");
   printf (" --rate <sampling rate>        set replay rate manually\n");
   printf ("\n");
 }
@@ -262,6 +280,8 @@ main (int argc, char **argv)
   decoder.enable_original_samples (options.enable_original_samples);
   decoder.enable_sines (options.sines_enabled);
   decoder.enable_noise (options.noise_enabled);
+  decoder.enable_low_latency (options.low_latency);
+  decoder.enable_interpolated_sines (options.interpolated_sines, options.interp_hop);
 
   if (options.deterministic_random)
     decoder.set_noise_seed (0x123456);
@@ -218,6 +218,8 @@ Player::load_plan (const string& filename)
   synth.apply_update (update);
   assert (voice->output());
 
+  fprintf (stderr, "SUCCESS: %zd instruments loaded in %.2f ms.\n", update->wav_sets.size(), update->wav_set_load_time * 1000);
+
   /* search operators for --fade, --fade-env */
   vector<MorphOperator *> ops = plan->operators();
   for (vector<MorphOperator *>::iterator oi = ops.begin(); oi != ops.end(); oi++)
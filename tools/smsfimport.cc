@@ -15,6 +15,7 @@
 #include "smgenericin.hh"
 #include "smmain.hh"
 #include "smjobqueue.hh"
+#include "smbatchencoder.hh"
 #include "smwavset.hh"
 #include "smutils.hh"
 #include "smwavdata.hh"
@@ -33,6 +34,7 @@ debug (const char *fmt, ...)
 /* avoid problems with SpectMorph::Instrument and SpectMorph::Sample */
 using SpectMorph::GenericIn;
 using SpectMorph::JobQueue;
+using SpectMorph::BatchEncoder;
 using SpectMorph::WavSet;
 using SpectMorph::WavSetWave;
 using SpectMorph::WavData;
@@ -959,6 +961,7 @@ run_all (vector<string>& commands, const string& name, size_t max_jobs)
   if (!job_queue.wait_for_all())
     {
       fprintf (stderr, "error executing %s commands\n", name.c_str());
+      exit (1);
     }
 }
 
@@ -1035,7 +1038,11 @@ import_preset (const string& import_name)
 
           WavSet wav_set;
 
+          /* the default encoder runs in this process (no process startup cost per sample) */
+          const bool in_process = (options.smenc == "smenc");
+
           vector<string> enc_commands, strip_commands;
+          BatchEncoder   batch_encoder;
           for (vector<Zone>::iterator preset_zi = pi->zones.begin(); preset_zi != pi->zones.end(); preset_zi++)
             {
               Zone& zone = *preset_zi;
@@ -1155,13 +1162,23 @@ import_preset (const string& import_name)
                                   if (options.config_filename != "")
                                     import_args += " --config " + options.config_filename;
 
-                                  enc_commands.push_back (
-                                    string_printf ("%s -m %d %s %s %s %s", options.smenc.c_str(),
-                                                   midi_note, import_args.c_str(),
-                                                   filename.c_str(), smname.c_str(), loop_args.c_str()));
-                                  if (!options.debug)
-                                    strip_commands.push_back (
-                                      string_printf ("smstrip --keep-samples %s", smname.c_str()));
+                                  if (in_process)
+                                    {
+                                      // strip models while encoding
+                                      batch_encoder.add_job (filename, smname,
+                                        string_printf ("-m %d %s %s %s", midi_note, import_args.c_str(), loop_args.c_str(),
+                                                       options.debug ? "" : "-s --keep-samples"));
+                                    }
+                                  else
+                                    {
+                                      enc_commands.push_back (
+                                        string_printf ("%s -m %d %s %s %s %s", options.smenc.c_str(),
+                                                       midi_note, import_args.c_str(),
+                                                       filename.c_str(), smname.c_str(), loop_args.c_str()));
+                                      if (!options.debug)
+                                        strip_commands.push_back (
+                                          string_printf ("smstrip --keep-samples %s", smname.c_str()));
+                                    }
 
                                   is_encoded[smname] = true;
                                 }
@@ -1216,8 +1233,25 @@ import_preset (const string& import_name)
             }
           else
             {
-              run_all (enc_commands, "Encoder", options.max_jobs);
-              run_all (strip_commands, "Strip", options.max_jobs);
+              if (in_process)
+                {
+                  printf ("Running Encoder jobs...\n");
+                  batch_encoder.set_max_threads (options.max_jobs);
+                  batch_encoder.set_progress_function ([] (const BatchEncoder::Job& job, size_t n_done, size_t n_jobs)
+                    {
+                      printf (" - %s (%zd/%zd)\n", job.output_filename.c_str(), n_done, n_jobs);
+                    });
+                  if (!batch_encoder.run())
+                    {
+                      fprintf (stderr, "error executing Encoder jobs\n");
+                      exit (1);
+                    }
+                }
+              else
+                {
+                  run_all (enc_commands, "Encoder", options.max_jobs);
+                  run_all (strip_commands, "Strip", options.max_jobs);
+                }
 
               if (options.mono_flat)
                 make_mono_flat (wav_set);